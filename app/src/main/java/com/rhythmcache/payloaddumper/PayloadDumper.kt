@@ -27,6 +27,10 @@ object PayloadDumper {
       callback: ProgressCallback?
   )
 
+  external fun getStats(): String
+
+  external fun setLowMemoryMode(enabled: Boolean)
+
   interface ProgressCallback {
     fun onProgress(
         partitionName: String,
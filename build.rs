@@ -5,7 +5,7 @@ fn main() {
     if env::var_os("CARGO_FEATURE_CAPI").is_none() {
         return;
     }
-    println!("cargo:rerun-if-changed=src/capi.rs");
+    println!("cargo:rerun-if-changed=lib/capi.rs");
     let version = env::var("CARGO_PKG_VERSION").expect("CARGO_PKG_VERSION not set");
 
     let mut iter = version.split('.');
@@ -0,0 +1,300 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use crate::profile;
+use anyhow::{Result, anyhow};
+use once_cell::sync::Lazy;
+use payload_dumper_core::payload::payload_dumper::AsyncPayloadRead;
+use payload_dumper_core::structs::PartitionUpdate;
+use payload_dumper_core::structs::install_operation::Type;
+use std::collections::HashMap;
+use std::sync::Mutex;
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use tokio::sync::Notify;
+use tokio::task::JoinSet;
+
+pub static BUDGET: Lazy<MemoryBudget> = Lazy::new(MemoryBudget::new);
+
+/// budget set by default in the low-memory profile
+pub const LOW_MEMORY_BUDGET: u64 = 128 * 1024 * 1024;
+
+/// the budget of the active profile, 0 (unlimited) outside low-memory mode
+pub fn default_budget() -> u64 {
+    if profile::low_memory() {
+        LOW_MEMORY_BUDGET
+    } else {
+        0
+    }
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum Kind {
+    /// buffers an operation cannot make progress without
+    Hard,
+    /// speculative buffers (read-ahead), never waited for
+    Soft,
+}
+
+#[derive(Debug, Default)]
+struct Usage {
+    hard: u64,
+    soft: u64,
+}
+
+/// process-wide cap on the buffers held by extraction jobs
+///
+/// hard reservations wait until enough memory is released. a reservation is
+/// always granted when no other hard reservation is held, so one operation
+/// larger than the whole budget still runs (alone) instead of deadlocking.
+/// soft reservations may only use half the budget and fail instead of waiting.
+pub struct MemoryBudget {
+    limit: AtomicU64,
+    /// set through set_limit(), a profile switch leaves it alone
+    explicit: AtomicBool,
+    usage: Mutex<Usage>,
+    released: Notify,
+    peak: AtomicU64,
+    waiting: AtomicU64,
+}
+
+impl MemoryBudget {
+    fn new() -> Self {
+        Self {
+            limit: AtomicU64::new(default_budget()),
+            explicit: AtomicBool::new(false),
+            usage: Mutex::new(Usage::default()),
+            released: Notify::new(),
+            peak: AtomicU64::new(0),
+            waiting: AtomicU64::new(0),
+        }
+    }
+
+    /// set the limit in bytes, 0 disables it
+    pub fn set_limit(&self, bytes: u64) {
+        self.explicit.store(true, Ordering::Relaxed);
+        self.store_limit(bytes);
+    }
+
+    /// go back to the limit of the active profile
+    pub(crate) fn set_default_limit(&self) {
+        self.explicit.store(false, Ordering::Relaxed);
+        self.store_limit(default_budget());
+    }
+
+    /// take the limit of a newly switched profile, unless one was set
+    pub(crate) fn apply_profile(&self) {
+        if !self.explicit.load(Ordering::Relaxed) {
+            self.store_limit(default_budget());
+        }
+    }
+
+    fn store_limit(&self, bytes: u64) {
+        self.limit.store(bytes, Ordering::Relaxed);
+        self.released.notify_waiters();
+    }
+
+    pub fn limit(&self) -> u64 {
+        self.limit.load(Ordering::Relaxed)
+    }
+
+    pub fn in_use(&self) -> u64 {
+        let usage = self.usage.lock().unwrap();
+        usage.hard + usage.soft
+    }
+
+    pub fn peak(&self) -> u64 {
+        self.peak.load(Ordering::Relaxed)
+    }
+
+    pub fn waiting(&self) -> u64 {
+        self.waiting.load(Ordering::Relaxed)
+    }
+
+    fn try_reserve(&self, bytes: u64, kind: Kind) -> bool {
+        let limit = self.limit();
+        let mut usage = self.usage.lock().unwrap();
+        let total = usage.hard + usage.soft;
+
+        let granted = match kind {
+            _ if limit == 0 => true,
+            Kind::Hard => usage.hard == 0 || total + bytes <= limit,
+            Kind::Soft => total + bytes <= limit && usage.soft + bytes <= limit / 2,
+        };
+        if !granted {
+            return false;
+        }
+
+        match kind {
+            Kind::Hard => usage.hard += bytes,
+            Kind::Soft => usage.soft += bytes,
+        }
+        self.peak
+            .fetch_max(usage.hard + usage.soft, Ordering::Relaxed);
+        true
+    }
+
+    fn release(&self, bytes: u64, kind: Kind) {
+        {
+            let mut usage = self.usage.lock().unwrap();
+            match kind {
+                Kind::Hard => usage.hard -= bytes,
+                Kind::Soft => usage.soft -= bytes,
+            }
+        }
+        self.released.notify_waiters();
+    }
+
+    /// reserve `bytes`, waiting for other jobs to release memory if needed
+    pub async fn acquire(&'static self, bytes: u64) -> BudgetPermit {
+        let mut waiter: Option<WaitGuard> = None;
+        loop {
+            let notified = self.released.notified();
+            tokio::pin!(notified);
+            notified.as_mut().enable();
+
+            if self.try_reserve(bytes, Kind::Hard) {
+                drop(waiter);
+                return BudgetPermit {
+                    budget: self,
+                    bytes,
+                    kind: Kind::Hard,
+                };
+            }
+
+            if waiter.is_none() {
+                waiter = Some(WaitGuard::new(&self.waiting));
+            }
+            notified.await;
+        }
+    }
+
+    /// acquire() for a job with decode tasks of its own in flight
+    ///
+    /// finished tasks still hold the memory of their operations until they
+    /// are joined, so a job that only waited here would wait on itself once
+    /// its own operations filled the budget. tasks that finish meanwhile are
+    /// handed to `reap`, which releases what they hold.
+    pub async fn acquire_reaping<T: 'static>(
+        &'static self,
+        bytes: u64,
+        tasks: &mut JoinSet<T>,
+        mut reap: impl FnMut(T) -> Result<()>,
+    ) -> Result<BudgetPermit> {
+        let acquire = self.acquire(bytes);
+        tokio::pin!(acquire);
+        loop {
+            tokio::select! {
+                permit = &mut acquire => return Ok(permit),
+                Some(joined) = tasks.join_next(), if !tasks.is_empty() => {
+                    reap(joined.map_err(|e| anyhow!("Decode task failed: {}", e))?)?;
+                }
+            }
+        }
+    }
+
+    /// reserve `bytes` for speculative work, or return None right away
+    pub fn try_acquire_soft(&'static self, bytes: u64) -> Option<BudgetPermit> {
+        self.try_reserve(bytes, Kind::Soft).then_some(BudgetPermit {
+            budget: self,
+            bytes,
+            kind: Kind::Soft,
+        })
+    }
+}
+
+/// counts a task as waiting for as long as it is alive, so a waiter that is
+/// cancelled mid-wait is not left in the count
+pub(crate) struct WaitGuard<'a>(&'a AtomicU64);
+
+impl<'a> WaitGuard<'a> {
+    pub(crate) fn new(counter: &'a AtomicU64) -> Self {
+        counter.fetch_add(1, Ordering::Relaxed);
+        Self(counter)
+    }
+}
+
+impl Drop for WaitGuard<'_> {
+    fn drop(&mut self) {
+        self.0.fetch_sub(1, Ordering::Relaxed);
+    }
+}
+
+/// memory reserved from the budget, released on drop
+pub struct BudgetPermit {
+    budget: &'static MemoryBudget,
+    bytes: u64,
+    kind: Kind,
+}
+
+impl Drop for BudgetPermit {
+    fn drop(&mut self) {
+        self.budget.release(self.bytes, self.kind);
+    }
+}
+
+/// estimated peak memory of one operation: its blob plus, for compressed
+/// operations, the decompressed output
+pub(crate) fn operation_footprint(
+    op: &payload_dumper_core::structs::InstallOperation,
+    block_size: u64,
+) -> u64 {
+    let input = op.data_length();
+    match op.r#type() {
+        Type::ReplaceXz | Type::ReplaceBz | Type::Zstd => {
+            let blocks: u64 = op.dst_extents.iter().map(|e| e.num_blocks()).sum();
+            input + blocks * block_size
+        }
+        _ => input,
+    }
+}
+
+/// charges every operation read through it against the global budget
+///
+/// dump_partition handles one operation at a time, so the reservation for an
+/// operation is held until the next blob is requested (or the reader is dropped)
+pub struct BudgetedReader<'a, R> {
+    inner: &'a R,
+    footprint: HashMap<u64, u64>,
+    held: Mutex<Option<BudgetPermit>>,
+}
+
+impl<'a, R: AsyncPayloadRead> BudgetedReader<'a, R> {
+    pub fn new(
+        inner: &'a R,
+        partition: &PartitionUpdate,
+        data_offset: u64,
+        block_size: u64,
+    ) -> Self {
+        let footprint = partition
+            .operations
+            .iter()
+            .filter(|op| op.data_length() > 0)
+            .map(|op| {
+                (
+                    data_offset + op.data_offset(),
+                    operation_footprint(op, block_size),
+                )
+            })
+            .collect();
+
+        Self {
+            inner,
+            footprint,
+            held: Mutex::new(None),
+        }
+    }
+}
+
+impl<R: AsyncPayloadRead> AsyncPayloadRead for BudgetedReader<'_, R> {
+    async fn read_bytes(&self, offset: u64, length: u64) -> Result<Vec<u8>> {
+        let previous = self.held.lock().unwrap().take();
+        drop(previous);
+
+        let bytes = self.footprint.get(&offset).copied().unwrap_or(length);
+        let permit = BUDGET.acquire(bytes).await;
+        let data = self.inner.read_bytes(offset, length).await?;
+
+        *self.held.lock().unwrap() = Some(permit);
+        Ok(data)
+    }
+}
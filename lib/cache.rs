@@ -0,0 +1,345 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use crate::pool::POOL;
+use crate::stats::{self, STATS};
+use anyhow::{Result, anyhow};
+use once_cell::sync::Lazy;
+use sha2::{Digest, Sha256};
+use std::collections::{HashMap, HashSet};
+use std::fs::{self, File};
+use std::io::{self, Read};
+use std::path::{Path, PathBuf};
+use std::sync::Mutex;
+use std::time::{SystemTime, UNIX_EPOCH};
+
+pub static CACHE: Lazy<OutputCache> = Lazy::new(OutputCache::new);
+
+const INDEX_FILE: &str = "index.json";
+
+#[derive(Debug, Clone, serde::Serialize, serde::Deserialize)]
+struct Entry {
+    size: u64,
+    /// mtime of the stored image when it was added, in nanoseconds. an image
+    /// modified in the store behind our back changes it, which is how such an
+    /// entry is detected and dropped
+    modified: u128,
+    /// seconds since the epoch, drives eviction
+    last_used: u64,
+}
+
+struct Store {
+    dir: PathBuf,
+    max_bytes: u64,
+    entries: HashMap<String, Entry>,
+    total: u64,
+    /// entries being copied out right now, never evicted
+    pinned: HashMap<String, usize>,
+    /// keys being copied in right now, by one job only
+    inserting: HashSet<String>,
+}
+
+/// content-addressed store of extracted images keyed by their manifest SHA-256
+///
+/// consecutive builds ship many byte-identical partitions; a partition whose
+/// hash is already stored is cloned into place instead of being decoded.
+/// the store is capped in size and evicts the least recently used images.
+pub struct OutputCache {
+    store: Mutex<Option<Store>>,
+}
+
+impl OutputCache {
+    fn new() -> Self {
+        Self {
+            store: Mutex::new(None),
+        }
+    }
+
+    /// use `dir` as the store (None disables the cache), evicting down to
+    /// `max_bytes` right away (0 = no cap)
+    pub fn configure(&self, dir: Option<PathBuf>, max_bytes: u64) -> Result<()> {
+        let Some(dir) = dir else {
+            *self.store.lock().unwrap() = None;
+            return Ok(());
+        };
+
+        fs::create_dir_all(&dir)?;
+        let mut entries: HashMap<String, Entry> = fs::read(dir.join(INDEX_FILE))
+            .ok()
+            .and_then(|data| serde_json::from_slice(&data).ok())
+            .unwrap_or_default();
+
+        // drop entries whose image vanished or changed behind our back
+        entries.retain(|key, entry| {
+            let valid = file_stamp(&dir.join(key))
+                .map(|(size, modified)| size == entry.size && modified == entry.modified)
+                .unwrap_or(false);
+            if !valid {
+                let _ = fs::remove_file(dir.join(key));
+            }
+            valid
+        });
+
+        let total = entries.values().map(|e| e.size).sum();
+        let mut store = Store {
+            dir,
+            max_bytes,
+            entries,
+            total,
+            pinned: HashMap::new(),
+            inserting: HashSet::new(),
+        };
+        store.evict(0);
+        store.save();
+
+        *self.store.lock().unwrap() = Some(store);
+        Ok(())
+    }
+
+    pub fn is_enabled(&self) -> bool {
+        self.store.lock().unwrap().is_some()
+    }
+
+    /// materialize the image for `hash` at `output`
+    ///
+    /// returns false when the hash is not stored; the output is then untouched
+    pub fn restore(&self, hash: &[u8], size: u64, output: &Path) -> Result<bool> {
+        let key = to_hex(hash);
+        let source = {
+            let mut guard = self.store.lock().unwrap();
+            let Some(store) = guard.as_mut() else {
+                return Ok(false);
+            };
+            match store.lookup(&key, size) {
+                Some(path) => {
+                    *store.pinned.entry(key.clone()).or_default() += 1;
+                    path
+                }
+                None => {
+                    stats::add(&STATS.cache_misses, 1);
+                    return Ok(false);
+                }
+            }
+        };
+
+        let result = clone_file(&source, output);
+
+        let mut guard = self.store.lock().unwrap();
+        if let Some(store) = guard.as_mut() {
+            store.unpin(&key);
+        }
+        result?;
+
+        stats::add(&STATS.cache_hits, 1);
+        stats::add(&STATS.cache_bytes_saved, size);
+        Ok(true)
+    }
+
+    /// add a freshly extracted image under `hash`; returns whether the image
+    /// is known to match `hash`
+    ///
+    /// images that were not checked against the manifest hash during
+    /// extraction are hashed here first; a mismatch is never stored. an
+    /// image another job is storing under the same hash right now is skipped.
+    pub fn insert(&self, hash: &[u8], image: &Path, verified: bool) -> Result<bool> {
+        if !self.is_enabled() {
+            return Ok(verified);
+        }
+        if !verified && hash_file(image)? != hash {
+            return Err(anyhow!("Image does not match manifest hash, not cached"));
+        }
+
+        let key = to_hex(hash);
+        let size = fs::metadata(image)?.len();
+        let dir = {
+            let mut guard = self.store.lock().unwrap();
+            match guard.as_mut() {
+                Some(store)
+                    if (store.max_bytes == 0 || size <= store.max_bytes)
+                        && !store.entries.contains_key(&key)
+                        && store.inserting.insert(key.clone()) =>
+                {
+                    store.dir.clone()
+                }
+                _ => return Ok(true),
+            }
+        };
+
+        let result = self.store_image(&dir, &key, image, size);
+        if let Some(store) = self.store.lock().unwrap().as_mut() {
+            store.inserting.remove(&key);
+        }
+        result.map(|_| true)
+    }
+
+    fn store_image(&self, dir: &Path, key: &str, image: &Path, size: u64) -> Result<()> {
+        let temp = dir.join(format!("{}.tmp{}", key, std::process::id()));
+        let _ = fs::remove_file(&temp);
+        clone_file(image, &temp)?;
+        let target = dir.join(key);
+        fs::rename(&temp, &target)?;
+        let (_, modified) = file_stamp(&target)?;
+
+        let mut guard = self.store.lock().unwrap();
+        if let Some(store) = guard.as_mut() {
+            store.evict(size);
+            // images being restored cannot be evicted and may leave no room
+            if store.max_bytes != 0 && store.total + size > store.max_bytes {
+                let _ = fs::remove_file(&target);
+                return Ok(());
+            }
+            if let Some(old) = store.entries.insert(
+                key.to_string(),
+                Entry {
+                    size,
+                    modified,
+                    last_used: now_secs(),
+                },
+            ) {
+                store.total -= old.size;
+            }
+            store.total += size;
+            store.save();
+        }
+        Ok(())
+    }
+}
+
+impl Store {
+    fn lookup(&mut self, key: &str, size: u64) -> Option<PathBuf> {
+        let path = self.dir.join(key);
+        let entry = self.entries.get_mut(key)?;
+
+        let valid = file_stamp(&path)
+            .map(|(s, m)| s == entry.size && s == size && m == entry.modified)
+            .unwrap_or(false);
+        if !valid {
+            let removed = self.entries.remove(key).map(|e| e.size).unwrap_or(0);
+            self.total -= removed;
+            let _ = fs::remove_file(&path);
+            self.save();
+            return None;
+        }
+
+        entry.last_used = now_secs();
+        self.save();
+        Some(path)
+    }
+
+    fn unpin(&mut self, key: &str) {
+        if let Some(count) = self.pinned.get_mut(key) {
+            *count -= 1;
+            if *count == 0 {
+                self.pinned.remove(key);
+            }
+        }
+    }
+
+    /// make room for `incoming` bytes, least recently used first
+    fn evict(&mut self, incoming: u64) {
+        if self.max_bytes == 0 {
+            return;
+        }
+
+        let mut order: Vec<(u64, String)> = self
+            .entries
+            .iter()
+            .filter(|(key, _)| !self.pinned.contains_key(*key))
+            .map(|(key, entry)| (entry.last_used, key.clone()))
+            .collect();
+        order.sort();
+
+        for (_, key) in order {
+            if self.total + incoming <= self.max_bytes {
+                break;
+            }
+            if let Some(entry) = self.entries.remove(&key) {
+                self.total -= entry.size;
+                let _ = fs::remove_file(self.dir.join(&key));
+            }
+        }
+    }
+
+    fn save(&self) {
+        if let Ok(data) = serde_json::to_vec(&self.entries) {
+            let temp = self.dir.join(format!("{}.tmp", INDEX_FILE));
+            if fs::write(&temp, data).is_ok() {
+                let _ = fs::rename(&temp, self.dir.join(INDEX_FILE));
+            }
+        }
+    }
+}
+
+fn file_stamp(path: &Path) -> io::Result<(u64, u128)> {
+    let meta = fs::metadata(path)?;
+    let modified = meta
+        .modified()?
+        .duration_since(UNIX_EPOCH)
+        .map(|d| d.as_nanos())
+        .unwrap_or(0);
+    Ok((meta.len(), modified))
+}
+
+fn now_secs() -> u64 {
+    SystemTime::now()
+        .duration_since(UNIX_EPOCH)
+        .map(|d| d.as_secs())
+        .unwrap_or(0)
+}
+
+pub(crate) fn to_hex(bytes: &[u8]) -> String {
+    bytes.iter().map(|b| format!("{:02x}", b)).collect()
+}
+
+fn hash_file(path: &Path) -> Result<Vec<u8>> {
+    let mut file = File::open(path)?;
+    let mut buf = POOL.get(4 * 1024 * 1024);
+    let mut hasher = Sha256::new();
+    loop {
+        let n = match file.read(&mut buf) {
+            Ok(0) => break,
+            Ok(n) => n,
+            Err(e) if e.kind() == io::ErrorKind::Interrupted => continue,
+            Err(e) => return Err(e.into()),
+        };
+        hasher.update(&buf[..n]);
+    }
+    Ok(hasher.finalize().to_vec())
+}
+
+/// independent copy of `src` at `dst`: a reflink where the filesystem
+/// supports it, else a plain copy. never a hard link, which would let a
+/// restored output modified in place corrupt the stored image with it.
+fn clone_file(src: &Path, dst: &Path) -> io::Result<()> {
+    match fs::remove_file(dst) {
+        Err(e) if e.kind() != io::ErrorKind::NotFound => return Err(e),
+        _ => {}
+    }
+
+    #[cfg(target_os = "linux")]
+    if reflink(src, dst).is_ok() {
+        return Ok(());
+    }
+
+    fs::copy(src, dst).map(|_| ())
+}
+
+#[cfg(target_os = "linux")]
+fn reflink(src: &Path, dst: &Path) -> io::Result<()> {
+    use std::os::unix::io::AsRawFd;
+
+    // _IOW(0x94, 9, int)
+    const FICLONE: u64 = 0x4004_9409;
+
+    let src_file = File::open(src)?;
+    let dst_file = File::create(dst)?;
+    let ret = unsafe { libc::ioctl(dst_file.as_raw_fd(), FICLONE as _, src_file.as_raw_fd()) };
+    if ret == 0 {
+        Ok(())
+    } else {
+        let err = io::Error::last_os_error();
+        drop(dst_file);
+        let _ = fs::remove_file(dst);
+        Err(err)
+    }
+}
@@ -0,0 +1,221 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use crate::stats::{self, STATS};
+use std::future::Future;
+use std::sync::Mutex;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::time::Instant;
+use tokio::sync::Notify;
+
+/// cancellation shared between the caller and one extraction
+///
+/// async work races against `cancelled()` and is dropped the moment the token
+/// fires, which aborts in-flight HTTP requests and read-ahead. blocking
+/// decoders cannot be dropped, they poll `is_cancelled()` between buffers.
+#[derive(Default)]
+pub struct CancelToken {
+    cancelled: AtomicBool,
+    notify: Notify,
+    requested_at: Mutex<Option<Instant>>,
+}
+
+impl CancelToken {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    pub fn cancel(&self) {
+        if !self.cancelled.swap(true, Ordering::SeqCst) {
+            *self.requested_at.lock().unwrap() = Some(Instant::now());
+            stats::add(&STATS.cancel_requests, 1);
+        }
+        self.notify.notify_waiters();
+    }
+
+    #[inline]
+    pub fn is_cancelled(&self) -> bool {
+        self.cancelled.load(Ordering::Relaxed)
+    }
+
+    /// resolves once the token is cancelled
+    pub async fn cancelled(&self) {
+        loop {
+            let notified = self.notify.notified();
+            tokio::pin!(notified);
+            notified.as_mut().enable();
+            if self.is_cancelled() {
+                return;
+            }
+            notified.await;
+        }
+    }
+
+    /// run `fut` unless the token fires first; the future is dropped then
+    pub async fn run<T, F>(&self, fut: F) -> anyhow::Result<T>
+    where
+        F: Future<Output = anyhow::Result<T>>,
+    {
+        tokio::select! {
+            biased;
+            _ = self.cancelled() => Err(anyhow::anyhow!("Extraction cancelled")),
+            result = fut => result,
+        }
+    }
+
+    /// record how long the extraction took to stop after cancel()
+    pub(crate) fn record_stopped(&self) {
+        if let Some(at) = *self.requested_at.lock().unwrap() {
+            let us = at.elapsed().as_micros() as u64;
+            stats::set(&STATS.cancel_latency_us_last, us);
+            STATS.cancel_latency_us_max.fetch_max(us, Ordering::Relaxed);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::CancelToken;
+    use crate::extractor::{
+        ExtractionProgress, ExtractionStatus, ProgressCallback, extract_local_partition,
+    };
+    use crate::sidecar;
+    use payload_dumper_core::structs::install_operation::Type;
+    use payload_dumper_core::structs::{
+        DeltaArchiveManifest, Extent, InstallOperation, PartitionInfo, PartitionUpdate,
+    };
+    use prost::Message;
+    use std::io::Write;
+    use std::sync::{Arc, Mutex};
+    use std::time::{Duration, Instant};
+
+    const BLOCK: usize = 4096;
+    /// blocks written by each operation of xz_payload()
+    const OP_BLOCKS: usize = 4096;
+
+    /// a version 2 payload.bin with one partition of `ops` REPLACE_XZ
+    /// operations of OP_BLOCKS zeroed blocks each
+    fn xz_payload(ops: usize) -> Vec<u8> {
+        let mut encoder = xz2::write::XzEncoder::new(Vec::new(), 1);
+        encoder.write_all(&vec![0; OP_BLOCKS * BLOCK]).unwrap();
+        let blob = encoder.finish().unwrap();
+
+        let operations = (0..ops)
+            .map(|i| {
+                let mut op = InstallOperation {
+                    data_offset: Some((i * blob.len()) as u64),
+                    data_length: Some(blob.len() as u64),
+                    dst_extents: vec![Extent {
+                        start_block: Some((i * OP_BLOCKS) as u64),
+                        num_blocks: Some(OP_BLOCKS as u64),
+                    }],
+                    ..Default::default()
+                };
+                op.set_type(Type::ReplaceXz);
+                op
+            })
+            .collect();
+        let manifest = DeltaArchiveManifest {
+            block_size: Some(BLOCK as u32),
+            partitions: vec![PartitionUpdate {
+                partition_name: "system".to_string(),
+                new_partition_info: Some(PartitionInfo {
+                    size: Some((ops * OP_BLOCKS * BLOCK) as u64),
+                    hash: None,
+                }),
+                operations,
+                ..Default::default()
+            }],
+            ..Default::default()
+        }
+        .encode_to_vec();
+
+        let mut payload = b"CrAU".to_vec();
+        payload.extend_from_slice(&2u64.to_be_bytes());
+        payload.extend_from_slice(&(manifest.len() as u64).to_be_bytes());
+        payload.extend_from_slice(&0u32.to_be_bytes());
+        payload.extend_from_slice(&manifest);
+        for _ in 0..ops {
+            payload.extend_from_slice(&blob);
+        }
+        payload
+    }
+
+    #[tokio::test]
+    async fn run_stops_as_soon_as_the_token_fires() {
+        let cancel = Arc::new(CancelToken::new());
+        let canceller = {
+            let cancel = Arc::clone(&cancel);
+            tokio::spawn(async move {
+                tokio::time::sleep(Duration::from_millis(20)).await;
+                cancel.cancel();
+            })
+        };
+
+        let started = Instant::now();
+        let result = cancel
+            .run(async {
+                tokio::time::sleep(Duration::from_secs(60)).await;
+                Ok(())
+            })
+            .await;
+        canceller.await.unwrap();
+
+        assert!(result.is_err());
+        assert!(started.elapsed() < Duration::from_secs(5));
+    }
+
+    #[tokio::test]
+    async fn run_of_a_cancelled_token_does_not_start() {
+        let cancel = CancelToken::new();
+        cancel.cancel();
+        let result = cancel.run(async { Ok(()) }).await;
+        assert!(result.is_err());
+    }
+
+    #[test]
+    fn extraction_cancelled_mid_xz_leaves_nothing_behind() {
+        let dir = std::env::temp_dir().join(format!("payload-cancel-test-{}", std::process::id()));
+        std::fs::create_dir_all(&dir).unwrap();
+        let source = dir.join("payload.bin");
+        let output = dir.join("system.img");
+        std::fs::write(&source, xz_payload(16)).unwrap();
+        // an image and sidecar left by an earlier run
+        std::fs::write(&output, b"stale").unwrap();
+        sidecar::write(&output, &[0; 32]).unwrap();
+
+        // the first finished operation cancels the run while the rest of
+        // the XZ operations are still being decoded
+        let cancelled_at = Arc::new(Mutex::new(None));
+        let callback: ProgressCallback = {
+            let cancelled_at = Arc::clone(&cancelled_at);
+            Box::new(move |progress: ExtractionProgress| {
+                if !matches!(progress.status, ExtractionStatus::InProgress) {
+                    return true;
+                }
+                cancelled_at
+                    .lock()
+                    .unwrap()
+                    .get_or_insert_with(Instant::now);
+                false
+            })
+        };
+        let cancel = Arc::new(CancelToken::new());
+        let result = extract_local_partition(
+            &source,
+            "system",
+            &output,
+            None,
+            Some(callback),
+            Some(Arc::clone(&cancel)),
+        );
+        let cancelled_at = cancelled_at.lock().unwrap().expect("no operation finished");
+
+        assert!(cancel.is_cancelled());
+        assert_eq!(result.unwrap_err().to_string(), "Extraction cancelled");
+        assert!(cancelled_at.elapsed() < Duration::from_secs(2));
+        assert!(!output.exists());
+        assert!(!sidecar::sidecar_path(&output).exists());
+        std::fs::remove_dir_all(&dir).unwrap();
+    }
+}
@@ -2,14 +2,40 @@
 // Copyright (c) 2025 rhythmcache
 
 use std::ffi::{CStr, CString, c_char, c_void};
-use std::panic;
+use std::io;
+use std::panic::{self, AssertUnwindSafe};
+use std::path::{Path, PathBuf};
 use std::ptr;
 use std::sync::Arc;
+use std::time::Duration;
 
+use crate::budget::BUDGET;
+use crate::cache::CACHE;
+use crate::cancel::CancelToken;
+use crate::diff::diff_payloads;
 use crate::extractor::{
     ExtractionProgress, ExtractionStatus, ProgressCallback, extract_local_partition,
-    extract_remote_partition, list_local_partitions, list_remote_partitions,
+    extract_local_partition_to_sink, extract_local_partitions, extract_remote_partition,
+    extract_remote_partition_to_sink, extract_remote_partitions, list_local_partitions,
+    list_remote_partitions,
 };
+use crate::follow;
+use crate::fs::FileSystem;
+use crate::http::HTTP;
+use crate::image::VirtualImage;
+use crate::local;
+use crate::onepass;
+use crate::output;
+use crate::pool::POOL;
+use crate::prefetch::PrefetchConfig;
+use crate::profile;
+use crate::runtime::{RUNTIME, RuntimeConfig};
+use crate::scheduler::SCHEDULER;
+use crate::sidecar;
+use crate::stats::stats_json;
+use crate::stream::{BorrowedFd, Sink};
+use crate::throttle::THROTTLE;
+use crate::warm::prefetch_source;
 
 /* Error Handling */
 
@@ -88,6 +114,22 @@ fn optional_c_str_to_rust<'a>(
     }
 }
 
+/// Convert an array of `count` C strings to Vec<&str>
+fn c_str_array_to_rust<'a>(
+    ptr: *const *const c_char,
+    count: usize,
+    param_name: &str,
+) -> Result<Vec<&'a str>, String> {
+    if ptr.is_null() || count == 0 {
+        return Err(format!("{} is empty", param_name));
+    }
+    let items = unsafe { std::slice::from_raw_parts(ptr, count) };
+    items
+        .iter()
+        .map(|&item| c_str_to_rust(item, param_name))
+        .collect()
+}
+
 /// Wrap function in panic handler and error management
 fn with_error_handling<F>(f: F) -> i32
 where
@@ -138,6 +180,26 @@ where
     }
 }
 
+/// Wrap function that returns a boxed object in panic handler
+fn with_ptr_error_handling<T, F>(f: F) -> *mut T
+where
+    F: FnOnce() -> Result<T, String> + panic::UnwindSafe,
+{
+    clear_last_error();
+
+    match panic::catch_unwind(f) {
+        Ok(Ok(value)) => Box::into_raw(Box::new(value)),
+        Ok(Err(e)) => {
+            set_last_error(e);
+            ptr::null_mut()
+        }
+        Err(_) => {
+            set_last_error("Panic occurred".to_string());
+            ptr::null_mut()
+        }
+    }
+}
+
 /* Partition List API */
 
 /// list all partitions in a local file (payload.bin or ZIP)
@@ -193,6 +255,93 @@ pub extern "C" fn payload_list_remote_partitions(
     })
 }
 
+/// compare the manifests of two payloads and report what changed
+/// returns a JSON string on success, NULL on failure
+/// the caller must free the returned string with payload_free_string()
+///
+/// @param old_source Previous build: payload.bin, ZIP path or http(s) URL
+/// @param new_source New build: payload.bin, ZIP path or http(s) URL
+/// @param user_agent Optional user agent string for URLs (pass NULL for default)
+/// @param cookies Optional cookie string for URLs (pass NULL for default)
+/// @return JSON string on success, NULL on failure
+///
+/// only the two manifests are fetched, concurrently; no partition data is
+/// read. the changed bytes of a partition are estimated from its operations:
+/// blocks both builds write from the same blob count as unchanged.
+///
+/// JSON format:
+/// {
+///   "changed": [
+///     {
+///       "name": "system",
+///       "old_size_bytes": 1073741824,
+///       "new_size_bytes": 1077936128,
+///       "old_hash": "abc123...",
+///       "new_hash": "def456...",
+///       "changed_bytes": 52428800,     // null for differential partitions
+///       "changed_readable": "50.00 MB",
+///       "changed_percent": 4.9
+///     }
+///   ],
+///   "added": [{"name": "init_boot", "size_bytes": 8388608, "hash": "..."}],
+///   "removed": [],
+///   "unchanged": ["dtbo", "vbmeta"],
+///   "changed_bytes": 60817408,
+///   "changed_readable": "58.00 MB"
+/// }
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_diff_payloads(
+    old_source: *const c_char,
+    new_source: *const c_char,
+    user_agent: *const c_char,
+    cookies: *const c_char,
+) -> *mut c_char {
+    with_string_error_handling(|| {
+        let old_str = c_str_to_rust(old_source, "old_source")?;
+        let new_str = c_str_to_rust(new_source, "new_source")?;
+        let user_agent_str = optional_c_str_to_rust(user_agent, "user_agent")?;
+        let cookies_str = optional_c_str_to_rust(cookies, "cookies")?;
+
+        diff_payloads(old_str, new_str, user_agent_str, cookies_str)
+            .map_err(|e| format!("Failed to compare payloads: {}", e))
+    })
+}
+
+/// list a payload as soon as its path or URL is known and warm what is
+/// usually extracted first
+/// returns a JSON string on success, NULL on failure
+/// the caller must free the returned string with payload_free_string()
+///
+/// @param source payload.bin, ZIP path or http(s) URL
+/// @param user_agent Optional user agent string for URLs (pass NULL for default)
+/// @param cookies Optional cookie string for URLs (pass NULL for default)
+/// @param cancel_token Token from payload_cancel_token_new() (can be NULL)
+/// @return JSON string on success, NULL on failure
+///
+/// the returned JSON format is the same as payload_list_local_partitions().
+/// for a URL the manifest is remembered for a few minutes, so listing or
+/// extracting the same URL right after skips fetching it again, and the first
+/// blobs of boot, init_boot and vendor_boot keep downloading in the
+/// background after this returns. cancel the token when the source is no
+/// longer wanted; that stops the listing or the background download.
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_prefetch_source(
+    source: *const c_char,
+    user_agent: *const c_char,
+    cookies: *const c_char,
+    cancel_token: *const PayloadCancelToken,
+) -> *mut c_char {
+    let cancel = token_from_ptr(cancel_token);
+    with_string_error_handling(AssertUnwindSafe(move || {
+        let source_str = c_str_to_rust(source, "source")?;
+        let user_agent_str = optional_c_str_to_rust(user_agent, "user_agent")?;
+        let cookies_str = optional_c_str_to_rust(cookies, "cookies")?;
+
+        prefetch_source(source_str, user_agent_str, cookies_str, cancel)
+            .map_err(|e| format!("Failed to prefetch source: {}", e))
+    }))
+}
+
 /* Progress Callback */
 
 /// progress callback function type
@@ -323,7 +472,7 @@ fn create_progress_callback(
 ///
 /// - Return 0 from the callback to cancel extraction
 /// - Return non-zero to continue
-/// - cancellation may not be immediate
+/// - a cancelled extraction stops at once and deletes the partial image
 #[unsafe(no_mangle)]
 pub extern "C" fn payload_extract_local_partition(
     path: *const c_char,
@@ -333,7 +482,37 @@ pub extern "C" fn payload_extract_local_partition(
     callback: CProgressCallback,
     user_data: *mut c_void,
 ) -> i32 {
-    with_error_handling(|| {
+    payload_extract_local_partition_cancellable(
+        path,
+        partition_name,
+        output_path,
+        source_dir,
+        callback,
+        user_data,
+        ptr::null(),
+    )
+}
+
+/// same as payload_extract_local_partition(), cancellable through a token
+///
+/// @param cancel_token Token from payload_cancel_token_new() (can be NULL)
+///
+/// payload_cancel_token_cancel() stops the extraction from any thread without
+/// waiting for the next progress callback: in-flight downloads are dropped and
+/// decompression stops at the next buffer boundary. the partial image is deleted
+/// and the call fails with "Extraction cancelled".
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_extract_local_partition_cancellable(
+    path: *const c_char,
+    partition_name: *const c_char,
+    output_path: *const c_char,
+    source_dir: *const c_char,
+    callback: CProgressCallback,
+    user_data: *mut c_void,
+    cancel_token: *const PayloadCancelToken,
+) -> i32 {
+    let cancel = token_from_ptr(cancel_token);
+    with_error_handling(AssertUnwindSafe(move || {
         let path_str = c_str_to_rust(path, "path")?;
         let partition_str = c_str_to_rust(partition_name, "partition_name")?;
         let output_str = c_str_to_rust(output_path, "output_path")?;
@@ -346,9 +525,10 @@ pub extern "C" fn payload_extract_local_partition(
             output_str,
             source_str.map(|s| s.to_string()),
             progress_cb,
+            cancel,
         )
         .map_err(|e| format!("Extraction failed: {}", e))
-    })
+    }))
 }
 
 /// extract a single partition from a remote file (payload.bin or ZIP)
@@ -379,7 +559,7 @@ pub extern "C" fn payload_extract_local_partition(
 ///
 /// - Return 0 from the callback to cancel extraction
 /// - Return non-zero to continue
-/// - Cancellation may not be immediate
+/// - a cancelled extraction stops at once and deletes the partial image
 #[unsafe(no_mangle)]
 pub extern "C" fn payload_extract_remote_partition(
     url: *const c_char,
@@ -391,7 +571,38 @@ pub extern "C" fn payload_extract_remote_partition(
     callback: CProgressCallback,
     user_data: *mut c_void,
 ) -> i32 {
-    with_error_handling(|| {
+    payload_extract_remote_partition_cancellable(
+        url,
+        partition_name,
+        output_path,
+        user_agent,
+        cookies,
+        source_dir,
+        callback,
+        user_data,
+        ptr::null(),
+    )
+}
+
+/// same as payload_extract_remote_partition(), cancellable through a token
+///
+/// @param cancel_token Token from payload_cancel_token_new() (can be NULL)
+///
+/// see payload_extract_local_partition_cancellable()
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_extract_remote_partition_cancellable(
+    url: *const c_char,
+    partition_name: *const c_char,
+    output_path: *const c_char,
+    user_agent: *const c_char,
+    cookies: *const c_char,
+    source_dir: *const c_char,
+    callback: CProgressCallback,
+    user_data: *mut c_void,
+    cancel_token: *const PayloadCancelToken,
+) -> i32 {
+    let cancel = token_from_ptr(cancel_token);
+    with_error_handling(AssertUnwindSafe(move || {
         let url_str = c_str_to_rust(url, "url")?;
         let partition_str = c_str_to_rust(partition_name, "partition_name")?;
         let output_str = c_str_to_rust(output_path, "output_path")?;
@@ -408,34 +619,1096 @@ pub extern "C" fn payload_extract_remote_partition(
             cookies_str,
             source_str.map(|s| s.to_string()),
             progress_cb,
+            cancel,
         )
         .map_err(|e| format!("Remote extraction failed: {}", e))
-    })
+    }))
 }
 
-/* Utility Functions */
+/* One-Pass Extraction */
 
-/// get library version
-/// returns a static string, do not free
+/// extract several partitions from a local file in a single sequential pass
+///
+/// @param path Path to the local file (payload.bin or ZIP)
+/// @param partition_names Array of partition names to extract
+/// @param partition_count Number of entries in partition_names
+/// @param output_dir Directory where <partition_name>.img files will be written
+/// @param source_dir Optional path to directory containing source partition images for incremental updates (pass NULL if not incremental)
+/// @param callback Optional progress callback (pass NULL for no callback)
+/// @param user_data User data passed to callback (can be NULL)
+/// @param cancel_token Token from payload_cancel_token_new() (can be NULL)
+/// @return 0 on success, -1 on failure (check payload_get_last_error())
+///
+/// instead of one extraction per partition seeking around its own part of the
+/// payload, the data of all selected full partitions is read once, front to
+/// back, in large reads, and every blob is handed to the partition it belongs
+/// to. this is much faster on HDDs, USB sticks, network shares and HTTP.
+/// differential partitions are extracted after the pass, one at a time.
+///
+/// - the callback receives every partition by name, interleaved
+/// - returning 0 from the callback cancels the whole pass, as does the token
+/// - a cancelled pass deletes every image that was not complete yet
+/// - a failing partition does not stop the others; the error message lists
+///   each failed partition as "<name>: <reason>", separated by "; "
 #[unsafe(no_mangle)]
-pub extern "C" fn payload_get_version() -> *const c_char {
-    static C_VERSION: &[u8] = concat!(env!("CARGO_PKG_VERSION"), "\0").as_bytes();
-    C_VERSION.as_ptr() as *const c_char
+pub extern "C" fn payload_extract_local_partitions(
+    path: *const c_char,
+    partition_names: *const *const c_char,
+    partition_count: usize,
+    output_dir: *const c_char,
+    source_dir: *const c_char,
+    callback: CProgressCallback,
+    user_data: *mut c_void,
+    cancel_token: *const PayloadCancelToken,
+) -> i32 {
+    let cancel = token_from_ptr(cancel_token);
+    with_error_handling(AssertUnwindSafe(move || {
+        let path_str = c_str_to_rust(path, "path")?;
+        let names = c_str_array_to_rust(partition_names, partition_count, "partition_names")?;
+        let output_str = c_str_to_rust(output_dir, "output_dir")?;
+        let source_str = optional_c_str_to_rust(source_dir, "source_dir")?;
+        let progress_cb = create_progress_callback(callback, user_data);
+
+        extract_local_partitions(
+            path_str,
+            &names,
+            output_str,
+            source_str.map(|s| s.to_string()),
+            progress_cb,
+            cancel,
+        )
+        .map_err(|e| format!("Extraction failed: {}", e))
+    }))
 }
 
-/// initialize the library (optional, but recommended for thread safety)
-/// should be called once before any other library functions
-/// @return 0 on success, -1 on failure
+/// extract several partitions from a remote file in a single sequential pass
+///
+/// @param url URL to the remote file
+/// @param partition_names Array of partition names to extract
+/// @param partition_count Number of entries in partition_names
+/// @param output_dir Directory where <partition_name>.img files will be written
+/// @param user_agent Optional user agent string (pass NULL for default)
+/// @param cookies Optional cookie string (pass NULL for default)
+/// @param source_dir Optional path to directory containing source partition images for incremental updates (pass NULL if not incremental)
+/// @param callback Optional progress callback (pass NULL for no callback)
+/// @param user_data User data passed to callback (can be NULL)
+/// @param cancel_token Token from payload_cancel_token_new() (can be NULL)
+/// @return 0 on success, -1 on failure (check payload_get_last_error())
+///
+/// see payload_extract_local_partitions(); the pass is fetched as a few large
+/// ranged requests with read-ahead instead of one request per operation
 #[unsafe(no_mangle)]
-pub extern "C" fn payload_init() -> i32 {
-    // not yet implemented
-    0
+pub extern "C" fn payload_extract_remote_partitions(
+    url: *const c_char,
+    partition_names: *const *const c_char,
+    partition_count: usize,
+    output_dir: *const c_char,
+    user_agent: *const c_char,
+    cookies: *const c_char,
+    source_dir: *const c_char,
+    callback: CProgressCallback,
+    user_data: *mut c_void,
+    cancel_token: *const PayloadCancelToken,
+) -> i32 {
+    let cancel = token_from_ptr(cancel_token);
+    with_error_handling(AssertUnwindSafe(move || {
+        let url_str = c_str_to_rust(url, "url")?;
+        let names = c_str_array_to_rust(partition_names, partition_count, "partition_names")?;
+        let output_str = c_str_to_rust(output_dir, "output_dir")?;
+        let user_agent_str = optional_c_str_to_rust(user_agent, "user_agent")?;
+        let cookies_str = optional_c_str_to_rust(cookies, "cookies")?;
+        let source_str = optional_c_str_to_rust(source_dir, "source_dir")?;
+        let progress_cb = create_progress_callback(callback, user_data);
+
+        extract_remote_partitions(
+            url_str.to_string(),
+            &names,
+            output_str,
+            user_agent_str,
+            cookies_str,
+            source_str.map(|s| s.to_string()),
+            progress_cb,
+            cancel,
+        )
+        .map_err(|e| format!("Remote extraction failed: {}", e))
+    }))
 }
 
-/// cleanup library resources
-/// should be called once when done using the library
-/// no library functions should be called after this
+/* Streamed Extraction */
+
+/// write callback for streamed extraction
+///
+/// @param user_data User-provided data pointer
+/// @param data Bytes to write (temporary pointer, valid during the call only)
+/// @param length Number of bytes in data
+/// @return 0 on success, non-zero to abort the extraction
+pub type CWriteCallback =
+    Option<extern "C" fn(user_data: *mut c_void, data: *const u8, length: usize) -> i32>;
+
+struct CWriteSink {
+    callback: extern "C" fn(*mut c_void, *const u8, usize) -> i32,
+    user_data: *mut c_void,
+}
+
+// the caller's writer is only ever used from one thread at a time
+unsafe impl Send for CWriteSink {}
+
+impl io::Write for CWriteSink {
+    fn write(&mut self, buf: &[u8]) -> io::Result<usize> {
+        // catch panics to prevent unwinding through C
+        let result = panic::catch_unwind(AssertUnwindSafe(|| {
+            (self.callback)(self.user_data, buf.as_ptr(), buf.len())
+        }));
+        match result {
+            Ok(0) => Ok(buf.len()),
+            _ => Err(io::Error::other("Write callback failed")),
+        }
+    }
+
+    fn flush(&mut self) -> io::Result<()> {
+        Ok(())
+    }
+}
+
+fn fd_sink(fd: isize) -> Result<Sink, String> {
+    if fd < 0 {
+        return Err("fd is invalid".to_string());
+    }
+    Ok(Box::new(unsafe { BorrowedFd::new(fd) }))
+}
+
+fn writer_sink(write: CWriteCallback, write_user_data: *mut c_void) -> Result<Sink, String> {
+    let callback = write.ok_or_else(|| "write is NULL".to_string())?;
+    Ok(Box::new(CWriteSink {
+        callback,
+        user_data: write_user_data,
+    }))
+}
+
+/// extract a full partition from a local file into an open file descriptor
+///
+/// @param path Path to the local file (payload.bin or ZIP)
+/// @param partition_name Name of the partition to extract
+/// @param fd Writable file descriptor (POSIX) or HANDLE cast to intptr_t (Windows), e.g. stdout or a named pipe
+/// @param callback Optional progress callback (pass NULL for no callback)
+/// @param user_data User data passed to callback (can be NULL)
+/// @param cancel_token Token from payload_cancel_token_new() (can be NULL)
+/// @return 0 on success, -1 on failure (check payload_get_last_error())
+///
+/// the image is written strictly front to back, byte-identical to the file
+/// payload_extract_local_partition() would produce, so it can be piped into a
+/// flashing tool or a hasher without staging it on disk. the SHA-256 is checked
+/// on the way; a mismatch is reported after the last byte has been written.
+///
+/// - fd is not closed, it stays owned by the caller
+/// - only full (non-differential) partitions can be streamed
+/// - a write blocked on a full pipe holds up cancellation until it returns
 #[unsafe(no_mangle)]
-pub extern "C" fn payload_cleanup() {
-    // not yet implemented
+pub extern "C" fn payload_extract_local_partition_to_fd(
+    path: *const c_char,
+    partition_name: *const c_char,
+    fd: isize,
+    callback: CProgressCallback,
+    user_data: *mut c_void,
+    cancel_token: *const PayloadCancelToken,
+) -> i32 {
+    let cancel = token_from_ptr(cancel_token);
+    with_error_handling(AssertUnwindSafe(move || {
+        let path_str = c_str_to_rust(path, "path")?;
+        let partition_str = c_str_to_rust(partition_name, "partition_name")?;
+        let sink = fd_sink(fd)?;
+        let progress_cb = create_progress_callback(callback, user_data);
+
+        extract_local_partition_to_sink(path_str, partition_str, sink, progress_cb, cancel)
+            .map_err(|e| format!("Extraction failed: {}", e))
+    }))
+}
+
+/// extract a full partition from a local file through a write callback
+///
+/// @param path Path to the local file (payload.bin or ZIP)
+/// @param partition_name Name of the partition to extract
+/// @param write Callback receiving the image in order
+/// @param write_user_data User data passed to write (can be NULL)
+/// @param callback Optional progress callback (pass NULL for no callback)
+/// @param user_data User data passed to callback (can be NULL)
+/// @param cancel_token Token from payload_cancel_token_new() (can be NULL)
+/// @return 0 on success, -1 on failure (check payload_get_last_error())
+///
+/// see payload_extract_local_partition_to_fd(). write is called from the
+/// extracting thread only, never after this function has returned.
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_extract_local_partition_to_writer(
+    path: *const c_char,
+    partition_name: *const c_char,
+    write: CWriteCallback,
+    write_user_data: *mut c_void,
+    callback: CProgressCallback,
+    user_data: *mut c_void,
+    cancel_token: *const PayloadCancelToken,
+) -> i32 {
+    let cancel = token_from_ptr(cancel_token);
+    with_error_handling(AssertUnwindSafe(move || {
+        let path_str = c_str_to_rust(path, "path")?;
+        let partition_str = c_str_to_rust(partition_name, "partition_name")?;
+        let sink = writer_sink(write, write_user_data)?;
+        let progress_cb = create_progress_callback(callback, user_data);
+
+        extract_local_partition_to_sink(path_str, partition_str, sink, progress_cb, cancel)
+            .map_err(|e| format!("Extraction failed: {}", e))
+    }))
+}
+
+/// extract a full partition from a remote file into an open file descriptor
+///
+/// @param url URL to the remote file
+/// @param partition_name Name of the partition to extract
+/// @param fd Writable file descriptor (POSIX) or HANDLE cast to intptr_t (Windows)
+/// @param user_agent Optional user agent string (pass NULL for default)
+/// @param cookies Optional cookie string (pass NULL for default)
+/// @param callback Optional progress callback (pass NULL for no callback)
+/// @param user_data User data passed to callback (can be NULL)
+/// @param cancel_token Token from payload_cancel_token_new() (can be NULL)
+/// @return 0 on success, -1 on failure (check payload_get_last_error())
+///
+/// see payload_extract_local_partition_to_fd()
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_extract_remote_partition_to_fd(
+    url: *const c_char,
+    partition_name: *const c_char,
+    fd: isize,
+    user_agent: *const c_char,
+    cookies: *const c_char,
+    callback: CProgressCallback,
+    user_data: *mut c_void,
+    cancel_token: *const PayloadCancelToken,
+) -> i32 {
+    let cancel = token_from_ptr(cancel_token);
+    with_error_handling(AssertUnwindSafe(move || {
+        let url_str = c_str_to_rust(url, "url")?;
+        let partition_str = c_str_to_rust(partition_name, "partition_name")?;
+        let sink = fd_sink(fd)?;
+        let user_agent_str = optional_c_str_to_rust(user_agent, "user_agent")?;
+        let cookies_str = optional_c_str_to_rust(cookies, "cookies")?;
+        let progress_cb = create_progress_callback(callback, user_data);
+
+        extract_remote_partition_to_sink(
+            url_str.to_string(),
+            partition_str,
+            sink,
+            user_agent_str,
+            cookies_str,
+            progress_cb,
+            cancel,
+        )
+        .map_err(|e| format!("Remote extraction failed: {}", e))
+    }))
+}
+
+/// extract a full partition from a remote file through a write callback
+///
+/// @param url URL to the remote file
+/// @param partition_name Name of the partition to extract
+/// @param write Callback receiving the image in order
+/// @param write_user_data User data passed to write (can be NULL)
+/// @param user_agent Optional user agent string (pass NULL for default)
+/// @param cookies Optional cookie string (pass NULL for default)
+/// @param callback Optional progress callback (pass NULL for no callback)
+/// @param user_data User data passed to callback (can be NULL)
+/// @param cancel_token Token from payload_cancel_token_new() (can be NULL)
+/// @return 0 on success, -1 on failure (check payload_get_last_error())
+///
+/// see payload_extract_local_partition_to_writer()
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_extract_remote_partition_to_writer(
+    url: *const c_char,
+    partition_name: *const c_char,
+    write: CWriteCallback,
+    write_user_data: *mut c_void,
+    user_agent: *const c_char,
+    cookies: *const c_char,
+    callback: CProgressCallback,
+    user_data: *mut c_void,
+    cancel_token: *const PayloadCancelToken,
+) -> i32 {
+    let cancel = token_from_ptr(cancel_token);
+    with_error_handling(AssertUnwindSafe(move || {
+        let url_str = c_str_to_rust(url, "url")?;
+        let partition_str = c_str_to_rust(partition_name, "partition_name")?;
+        let sink = writer_sink(write, write_user_data)?;
+        let user_agent_str = optional_c_str_to_rust(user_agent, "user_agent")?;
+        let cookies_str = optional_c_str_to_rust(cookies, "cookies")?;
+        let progress_cb = create_progress_callback(callback, user_data);
+
+        extract_remote_partition_to_sink(
+            url_str.to_string(),
+            partition_str,
+            sink,
+            user_agent_str,
+            cookies_str,
+            progress_cb,
+            cancel,
+        )
+        .map_err(|e| format!("Remote extraction failed: {}", e))
+    }))
+}
+
+/* Cancellation */
+
+/// opaque cancellation token, see payload_cancel_token_new()
+pub struct PayloadCancelToken {
+    token: Arc<CancelToken>,
+}
+
+fn token_from_ptr(ptr: *const PayloadCancelToken) -> Option<Arc<CancelToken>> {
+    if ptr.is_null() {
+        None
+    } else {
+        Some(Arc::clone(unsafe { &(*ptr).token }))
+    }
+}
+
+/// create a cancellation token for one extraction
+/// the caller must free it with payload_cancel_token_free()
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_cancel_token_new() -> *mut PayloadCancelToken {
+    Box::into_raw(Box::new(PayloadCancelToken {
+        token: Arc::new(CancelToken::new()),
+    }))
+}
+
+/// cancel the extraction using this token
+/// safe to call from any thread, any number of times
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_cancel_token_cancel(token: *const PayloadCancelToken) {
+    if !token.is_null() {
+        unsafe { (*token).token.cancel() };
+    }
+}
+
+/// free a token created by payload_cancel_token_new()
+/// an extraction still running with it keeps its own reference
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_cancel_token_free(token: *mut PayloadCancelToken) {
+    if !token.is_null() {
+        unsafe { drop(Box::from_raw(token)) };
+    }
+}
+
+/* Random Access */
+
+/// opaque handle to one partition opened for random reads, see
+/// payload_partition_open_local()
+pub struct PayloadPartition {
+    image: Arc<VirtualImage>,
+}
+
+/// open a partition of a local file (payload.bin or ZIP) for random reads
+///
+/// @param path Path to payload.bin or ZIP file
+/// @param partition_name Name of the partition to open
+/// @param cache_bytes Decoded operations kept for later reads (0 = 64 MiB)
+/// @return handle on success, NULL on failure (check payload_get_last_error())
+///
+/// nothing is extracted: every read decodes only the operations that cover
+/// the requested range. the caller must close the handle with
+/// payload_partition_close(). differential partitions cannot be opened.
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_partition_open_local(
+    path: *const c_char,
+    partition_name: *const c_char,
+    cache_bytes: u64,
+) -> *mut PayloadPartition {
+    with_ptr_error_handling(|| {
+        let path_str = c_str_to_rust(path, "path")?;
+        let partition_str = c_str_to_rust(partition_name, "partition_name")?;
+
+        VirtualImage::open_local(Path::new(path_str), partition_str, cache_bytes)
+            .map(|image| PayloadPartition {
+                image: Arc::new(image),
+            })
+            .map_err(|e| format!("Failed to open partition: {}", e))
+    })
+}
+
+/// open a partition of a remote URL for random reads
+///
+/// @param url URL to payload.bin or ZIP file
+/// @param partition_name Name of the partition to open
+/// @param user_agent Optional user agent string (pass NULL for default)
+/// @param cookies Optional cookie string (pass NULL for default)
+/// @param cache_bytes Decoded operations kept for later reads (0 = 64 MiB)
+/// @return handle on success, NULL on failure (check payload_get_last_error())
+///
+/// only the blobs of the operations covering a read are downloaded; reading
+/// a few KiB of a large partition transfers at most a few MiB
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_partition_open_remote(
+    url: *const c_char,
+    partition_name: *const c_char,
+    user_agent: *const c_char,
+    cookies: *const c_char,
+    cache_bytes: u64,
+) -> *mut PayloadPartition {
+    with_ptr_error_handling(|| {
+        let url_str = c_str_to_rust(url, "url")?;
+        let partition_str = c_str_to_rust(partition_name, "partition_name")?;
+        let user_agent_str = optional_c_str_to_rust(user_agent, "user_agent")?;
+        let cookies_str = optional_c_str_to_rust(cookies, "cookies")?;
+
+        VirtualImage::open_remote(
+            url_str,
+            partition_str,
+            user_agent_str,
+            cookies_str,
+            cache_bytes,
+        )
+        .map(|image| PayloadPartition {
+            image: Arc::new(image),
+        })
+        .map_err(|e| format!("Failed to open partition: {}", e))
+    })
+}
+
+/// size of the opened partition image in bytes
+/// returns 0 for a NULL handle
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_partition_size(partition: *const PayloadPartition) -> u64 {
+    if partition.is_null() {
+        return 0;
+    }
+    unsafe { (*partition).image.size() }
+}
+
+/// read up to `length` bytes of the image starting at `offset`
+///
+/// @param partition Handle from payload_partition_open_*()
+/// @param offset Byte offset in the image
+/// @param buffer Destination of at least `length` bytes
+/// @param length Number of bytes to read
+/// @return bytes read (short only at the end of the image, 0 past it), -1 on failure
+///
+/// a handle may be read from several threads at once
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_partition_read_at(
+    partition: *const PayloadPartition,
+    offset: u64,
+    buffer: *mut u8,
+    length: usize,
+) -> i64 {
+    clear_last_error();
+    if partition.is_null() || (buffer.is_null() && length > 0) {
+        set_last_error("partition or buffer is NULL".to_string());
+        return -1;
+    }
+
+    let result = panic::catch_unwind(AssertUnwindSafe(|| {
+        let image = unsafe { &(*partition).image };
+        let buf: &mut [u8] = if length == 0 {
+            &mut []
+        } else {
+            unsafe { std::slice::from_raw_parts_mut(buffer, length) }
+        };
+        image.read_at(offset, buf)
+    }));
+
+    match result {
+        Ok(Ok(n)) => n as i64,
+        Ok(Err(e)) => {
+            set_last_error(format!("Failed to read partition: {}", e));
+            -1
+        }
+        Err(_) => {
+            set_last_error("Panic occurred".to_string());
+            -1
+        }
+    }
+}
+
+/// close a handle from payload_partition_open_*()
+/// no read may be running on it
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_partition_close(partition: *mut PayloadPartition) {
+    if !partition.is_null() {
+        unsafe { drop(Box::from_raw(partition)) };
+    }
+}
+
+/* Filesystem Browsing */
+
+/// opaque handle to the filesystem inside a partition, see payload_fs_open()
+pub struct PayloadFs {
+    fs: FileSystem,
+}
+
+/// open the EROFS or ext4 filesystem of a partition opened for random reads
+///
+/// @param partition Handle from payload_partition_open_*()
+/// @return handle on success, NULL on failure (check payload_get_last_error())
+///
+/// the filesystem shares the partition's reads and cache and keeps them
+/// alive, so the partition handle may be closed right away. listing a
+/// directory or extracting a file decodes only the operations that hold the
+/// blocks it needs. the caller must close the handle with payload_fs_close().
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_fs_open(partition: *const PayloadPartition) -> *mut PayloadFs {
+    with_ptr_error_handling(AssertUnwindSafe(|| {
+        if partition.is_null() {
+            return Err("partition is NULL".to_string());
+        }
+        let image = unsafe { Arc::clone(&(*partition).image) };
+        FileSystem::open(image)
+            .map(|fs| PayloadFs { fs })
+            .map_err(|e| format!("Failed to open filesystem: {}", e))
+    }))
+}
+
+/// list a directory of the filesystem as JSON
+///
+/// @param fs Handle from payload_fs_open()
+/// @param path Absolute path of the directory, "/" for the root
+/// @return JSON string on success, NULL on failure
+///
+/// the caller must free the returned string with payload_free_string()
+///
+/// JSON format:
+/// {
+///   "filesystem": "ext4",
+///   "path": "/system/etc",
+///   "entries": [
+///     {"name": "init", "type": "dir", "size": 4096, "mode": 493},
+///     {"name": "hosts", "type": "file", "size": 56, "mode": 420},
+///     {"name": "ld.config.txt", "type": "symlink", "size": 27, "mode": 511,
+///      "target": "/system/etc/ld.config.29.txt"}
+///   ]
+/// }
+/// "type" is "file", "dir", "symlink" or "other"; directories come first
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_fs_list(fs: *const PayloadFs, path: *const c_char) -> *mut c_char {
+    with_string_error_handling(AssertUnwindSafe(|| {
+        if fs.is_null() {
+            return Err("fs is NULL".to_string());
+        }
+        let path_str = c_str_to_rust(path, "path")?;
+        let fs = unsafe { &(*fs).fs };
+
+        let listing = fs
+            .list(path_str)
+            .map_err(|e| format!("Failed to list directory: {}", e))?;
+        serde_json::to_string(&listing).map_err(|e| format!("Serialization failed: {}", e))
+    }))
+}
+
+/// extract one regular file of the filesystem
+///
+/// @param fs Handle from payload_fs_open()
+/// @param path Absolute path of the file inside the filesystem
+/// @param output_path Where to write the file
+/// @return 0 on success, -1 on failure
+///
+/// symlinks are not followed; list the directory to read their target
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_fs_extract(
+    fs: *const PayloadFs,
+    path: *const c_char,
+    output_path: *const c_char,
+) -> i32 {
+    with_error_handling(AssertUnwindSafe(|| {
+        if fs.is_null() {
+            return Err("fs is NULL".to_string());
+        }
+        let path_str = c_str_to_rust(path, "path")?;
+        let output_str = c_str_to_rust(output_path, "output_path")?;
+        let fs = unsafe { &(*fs).fs };
+
+        fs.extract(path_str, Path::new(output_str))
+            .map(|_| ())
+            .map_err(|e| format!("Failed to extract {}: {}", path_str, e))
+    }))
+}
+
+/// close a handle from payload_fs_open()
+/// no call may be running on it
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_fs_close(fs: *mut PayloadFs) {
+    if !fs.is_null() {
+        unsafe { drop(Box::from_raw(fs)) };
+    }
+}
+
+/* Statistics */
+
+/// get a snapshot of the process-wide engine counters as JSON
+/// returns NULL on failure
+/// the caller must free the returned string with payload_free_string()
+///
+/// the returned JSON structure:
+/// {
+///   "prefetch_hits": 120,          // remote reads served by a finished read-ahead request
+///   "prefetch_stalls": 4,          // remote reads that had to wait for an in-flight read-ahead
+///   "prefetch_misses": 2,          // remote reads that were not prefetched at all
+///   "prefetch_bytes": 52428800,    // bytes requested ahead of time
+///   "prefetch_window_bytes": 4194304, // current read-ahead window
+///   "remote_rtt_ms": 182.5,        // measured round-trip time
+///   "remote_throughput_bps": 12500000, // measured throughput in bytes per second
+///   "memory_limit_bytes": 2147483648, // 0 when no memory budget is set
+///   "memory_in_use_bytes": 104857600, // buffers currently reserved by all jobs
+///   "memory_peak_bytes": 536870912,  // highest reservation seen so far
+///   "memory_waiting_jobs": 3,        // jobs blocked until memory is released
+///   "pool_allocations": 14,          // buffers the pool had to allocate
+///   "pool_reuses": 48210,            // buffer requests served from the pool
+///   "pool_retained_bytes": 16777216, // idle memory kept for reuse
+///   "cache_hits": 9,                 // partitions cloned from the output cache
+///   "cache_misses": 3,               // partitions with a hash that was not cached
+///   "cache_bytes_saved": 8589934592, // image bytes not decoded thanks to the cache
+///   "cancel_requests": 2,            // extractions cancelled
+///   "cancel_latency_ms_last": 12.4,  // time from cancel to stopped, last cancellation
+///   "cancel_latency_ms_max": 48.0,   // same, worst case seen
+///   "sequential_reads": 310,         // reads issued by one-pass extractions
+///   "sequential_read_bytes": 5200000000, // bytes read by one-pass extractions
+///   "streamed_bytes": 4294967296,   // image bytes written to streams instead of files
+///   "remote_opens": 5,               // remote payloads whose manifest was fetched
+///   "remote_open_ms_last": 410.2,    // time to locate payload.bin and fetch the manifest, last open
+///   "remote_open_requests_last": 3,  // HTTP requests that took, last open
+///   "remote_list_ms_last": 415.9,    // whole remote listing, last one
+///   "remote_summary_ms_last": 5.7,   // part of it spent building the partition list
+///   "image_reads": 40,               // payload_partition_read_at() calls
+///   "image_read_bytes": 163840,      // bytes returned by them
+///   "image_fetched_bytes": 2097152,  // payload bytes read to serve them
+///   "image_ops_decoded": 3,          // operations decoded to serve them
+///   "image_cache_hits": 37,          // operations served from the decoded cache
+///   "fs_dirs_listed": 5,             // directories listed inside partitions
+///   "fs_files_extracted": 2,         // single files extracted from partitions
+///   "warm_manifest_hits": 1,         // remote opens served by a remembered manifest
+///   "warm_blob_hits": 12,            // remote reads served by payload_prefetch_source()
+///   "warm_blob_bytes": 4194304,      // bytes they returned
+///   "warm_fetched_bytes": 12582912,  // bytes downloaded ahead by payload_prefetch_source()
+///   "throttle_network_wait_ms": 850.0, // time jobs waited on the network rate limits
+///   "throttle_disk_wait_ms": 0.0,    // time jobs waited on the disk rate limits
+///   "output_writes": 2210,           // writes issued to extracted images
+///   "output_write_bytes": 9663676416, // bytes they wrote
+///   "output_write_mbs": 1480.2,      // MiB/s of a single write, averaged over all of them
+///   "output_merged_writes": 5120,    // short writes merged into the write before them
+///   "output_direct_files": 3,        // images written bypassing the page cache
+///   "local_reads": 640,              // reads issued to local payload files
+///   "local_read_bytes": 2684354560,  // bytes they read
+///   "local_window_hits": 51200,      // blob reads served by an earlier, merged read
+///   "local_mapped_sources": 0,       // local payloads read through a memory mapping
+///   "http_hosts": 1,                 // origins with requests in flight
+///   "http_requests": 1840,           // range requests answered
+///   "http2_requests": 1840,          // those answered over HTTP/2
+///   "http_retries": 0,               // requests repeated after a failure or a 5xx
+///   "http_ttfb_ms_avg": 38.2,        // time to first byte, averaged over all requests
+///   "http_ttfb_ms_last": 35.9,       // time to first byte of the last request
+///   "follow_waits": 12,              // reads that waited for a download to catch up
+///   "follow_wait_ms": 48000.0,       // time they waited
+///   "follow_stalls": 0,              // reads failed because the download stopped growing
+///   "disk_jobs_active": 4,           // partitions being written
+///   "disk_jobs_waiting": 0,          // partitions queued for a disk slot
+///   "network_jobs_active": 2,        // remote partitions being downloaded
+///   "network_jobs_waiting": 6,       // remote partitions queued for a network slot
+///   "decode_active": 8,              // operations being decoded
+///   "decode_limit": 8                // decode slots
+/// }
+///
+/// counters are cumulative for the lifetime of the process
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_get_stats() -> *mut c_char {
+    with_string_error_handling(|| stats_json().map_err(|e| format!("Failed to get stats: {}", e)))
+}
+
+/* Memory Budget */
+
+/// set the process-wide memory budget for extraction buffers
+///
+/// @param limit_bytes Maximum bytes all running extractions may reserve together (0 = unlimited)
+///
+/// When the budget is exhausted, extractions wait for memory to be released
+/// instead of allocating more. A single operation larger than the whole budget
+/// is still allowed to run on its own.
+/// Can be changed at any time, waiting extractions re-check the new limit immediately.
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_set_memory_budget(limit_bytes: u64) {
+    BUDGET.set_limit(limit_bytes);
+}
+
+/* Scheduler */
+
+/// set the global limits shared by all extractions, across payloads
+///
+/// @param disk_jobs Maximum partitions written at the same time (0 = unlimited)
+/// @param network_jobs Maximum remote partitions downloaded at the same time (0 = unlimited)
+/// @param decode_threads Maximum operations decoded at the same time (0 = one per CPU core)
+///
+/// Extractions started beyond these limits wait for a slot instead of failing,
+/// so a caller can start every partition of every queued payload at once.
+/// Can be changed at any time, waiting extractions re-check the new limits immediately.
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_set_scheduler_limits(
+    disk_jobs: u32,
+    network_jobs: u32,
+    decode_threads: u32,
+) {
+    SCHEDULER.set_limits(disk_jobs as u64, network_jobs as u64, decode_threads as u64);
+}
+
+/* Rate Limits */
+
+/// set bandwidth limits for remote reads and image writes, in bytes per second
+///
+/// @param network_bps Download rate of all remote jobs together (0 = unlimited)
+/// @param disk_bps Write rate of all extractions together (0 = unlimited)
+/// @param job_network_bps Download rate of each remote job (0 = unlimited)
+/// @param job_disk_bps Write rate of each extraction (0 = unlimited)
+///
+/// Jobs are paced in slices of about a tenth of a second, handed out in the
+/// order they ask, so concurrent partitions share a limit evenly.
+/// Can be changed at any time, running extractions follow the new limits
+/// from their next slice. With every limit at 0 the limiter costs nothing.
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_set_rate_limits(
+    network_bps: u64,
+    disk_bps: u64,
+    job_network_bps: u64,
+    job_disk_bps: u64,
+) {
+    THROTTLE.set_limits(network_bps, disk_bps, job_network_bps, job_disk_bps);
+}
+
+/* Memory Profile */
+
+/// switch the low-memory profile on or off
+///
+/// @param enabled Non-zero for the low-memory profile
+/// @return 0 on success, -1 on failure (check payload_get_last_error())
+///
+/// The profile is on by default in 32-bit builds. It runs fewer threads,
+/// decodes two operations at a time with two in flight per partition, uses
+/// short reads and read-ahead, keeps a small buffer pool under a 128 MiB
+/// budget, and decodes large compressed operations to disk in chunks.
+/// Call it before payload_init_ex(): it rebuilds the runtime, so it fails
+/// while an extraction is running. The decode limit, buffer pool and memory
+/// budget take the defaults of the profile unless they were set explicitly,
+/// through payload_set_memory_budget(), payload_configure_buffer_pool() or
+/// a non-zero value in payload_init_ex() or payload_set_scheduler_limits().
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_set_low_memory(enabled: i32) -> i32 {
+    with_error_handling(|| {
+        profile::set_low_memory(enabled != 0)
+            .map_err(|e| format!("Failed to switch memory profile: {}", e))
+    })
+}
+
+/* HTTP Connections */
+
+/// tune the connection pool shared by every remote source
+///
+/// @param max_requests_per_host Concurrent requests to one origin, across all jobs (0 = unlimited)
+/// @param idle_connections_per_host Idle connections kept open per origin (0 = 8)
+/// @return 0 on success, -1 on failure (check payload_get_last_error())
+///
+/// Connections are kept alive and reused by every call that reads the same
+/// server, so listing a payload and extracting its partitions one call after
+/// another pays the TCP and TLS handshakes once. Servers that speak HTTP/2
+/// carry all concurrent range requests over a single connection. The request
+/// cap applies at once; a new idle setting starts a fresh pool, so call this
+/// before opening any remote payload.
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_configure_http(
+    max_requests_per_host: u32,
+    idle_connections_per_host: u32,
+) -> i32 {
+    with_error_handling(|| {
+        HTTP.configure(
+            max_requests_per_host as u64,
+            idle_connections_per_host as u64,
+        )
+        .map_err(|e| format!("Failed to configure HTTP connections: {}", e))
+    })
+}
+
+/* Following Downloads */
+
+/// read local payloads that are still being downloaded
+///
+/// @param stall_timeout_ms Fail once the file has not grown for this long (0 = off)
+///
+/// Off by default. While on, reads past the current end of a local payload
+/// or OTA zip wait for the data instead of failing, so partitions can be
+/// listed and extracted while the download is still running. A zip is
+/// searched from the front, since its central directory is written last.
+/// The downloader must append to the file in order; one that preallocates
+/// the file or fetches pieces out of order cannot be followed. Applies to
+/// payloads opened afterwards.
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_set_follow(stall_timeout_ms: u64) {
+    follow::set_follow(Duration::from_millis(stall_timeout_ms));
+}
+
+/* Local Reads */
+
+/// read local payloads through a memory mapping
+///
+/// @param enabled Non-zero to map payloads opened afterwards (64-bit Linux and Android only)
+///
+/// Off by default. Mapping saves a read call per blob on fast local storage;
+/// leave it off for payloads on removable or network storage, where a page
+/// fault that stalls is worse than a read that fails. Either way short reads
+/// that continue each other are merged into large sequential ones and the
+/// kernel is told the access pattern.
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_set_local_mmap(enabled: i32) {
+    local::set_mmap(enabled != 0);
+}
+
+/* Output Writes */
+
+/// write large images bypassing the page cache
+///
+/// @param min_image_bytes Images at least this large are written unbuffered (0 = never)
+///
+/// Uses O_DIRECT on Linux and Android and FILE_FLAG_NO_BUFFERING on Windows;
+/// other systems and filesystems that refuse it keep writing buffered.
+/// Writing a multi-GB image unbuffered keeps it from pushing everything else
+/// out of the page cache. Either way short writes to neighbouring blocks are
+/// merged into large aligned ones. Applies to extractions started afterwards.
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_set_direct_io(min_image_bytes: u64) {
+    output::set_direct_threshold(min_image_bytes);
+}
+
+/// merge short writes to neighbouring blocks of buffered images
+///
+/// @param enabled Non-zero to merge them (the default), 0 to write each as it is decoded
+///
+/// Only meant for comparing runs: with merging off, output_merged_writes stays
+/// at 0 and output_writes counts every write the decoders made. Images written
+/// unbuffered (see payload_set_direct_io()) are merged either way. Applies to
+/// extractions started afterwards.
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_set_write_merging(enabled: i32) {
+    output::set_merging(enabled != 0);
+}
+
+/* Output Cache */
+
+/// enable the content-addressed output cache
+///
+/// @param dir Directory holding the cached images (NULL or empty = disable the cache)
+/// @param max_bytes Size cap of the cache, least recently used images are evicted first (0 = no cap)
+/// @return 0 on success, -1 on failure (check payload_get_last_error())
+///
+/// Partitions are keyed by the SHA-256 from the manifest. When a partition's hash
+/// is already cached, extraction clones the cached image into place (reflink where
+/// supported, else a copy) instead of decoding it. Freshly extracted images whose
+/// hash matches the manifest are added to the cache; an image larger than the cap
+/// is not.
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_configure_output_cache(dir: *const c_char, max_bytes: u64) -> i32 {
+    with_error_handling(|| {
+        let dir = optional_c_str_to_rust(dir, "dir")?
+            .filter(|d| !d.is_empty())
+            .map(PathBuf::from);
+        CACHE
+            .configure(dir, max_bytes)
+            .map_err(|e| format!("Failed to configure output cache: {}", e))
+    })
+}
+
+/* Output Digests */
+
+/// check whether an extracted image is already up to date
+///
+/// @param image_path Path of the extracted image
+/// @param sha256_hex Expected SHA-256 as hex, as reported in the partition list
+/// @return 1 if the image is up to date, 0 if it must be extracted again, -1 on error
+///
+/// Extraction writes a small `<image>.digest.json` sidecar next to every image
+/// that was checked against the manifest hash, recording its size, mtime and
+/// SHA-256. An image is up to date when the sidecar matches the expected hash
+/// and the image still has the recorded size and mtime; it is not read.
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_is_output_up_to_date(
+    image_path: *const c_char,
+    sha256_hex: *const c_char,
+) -> i32 {
+    clear_last_error();
+    let result = panic::catch_unwind(|| -> Result<bool, String> {
+        let path = c_str_to_rust(image_path, "image_path")?;
+        let hex = c_str_to_rust(sha256_hex, "sha256_hex")?;
+        let hash = sidecar::parse_hex(hex).ok_or("Invalid sha256_hex")?;
+        Ok(sidecar::is_up_to_date(Path::new(path), &hash))
+    });
+
+    match result {
+        Ok(Ok(true)) => 1,
+        Ok(Ok(false)) => 0,
+        Ok(Err(e)) => {
+            set_last_error(e);
+            -1
+        }
+        Err(_) => {
+            set_last_error("Panic occurred".to_string());
+            -1
+        }
+    }
+}
+
+/// record that an image was verified against the given SHA-256
+///
+/// @param image_path Path of the extracted image
+/// @param sha256_hex SHA-256 the image was verified to have, as hex
+/// @return 0 on success, -1 on failure (check payload_get_last_error())
+///
+/// for callers that verify images themselves; later calls to
+/// payload_is_output_up_to_date() then skip the image while it is unchanged
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_record_output_digest(
+    image_path: *const c_char,
+    sha256_hex: *const c_char,
+) -> i32 {
+    with_error_handling(|| {
+        let path = c_str_to_rust(image_path, "image_path")?;
+        let hex = c_str_to_rust(sha256_hex, "sha256_hex")?;
+        let hash = sidecar::parse_hex(hex).ok_or("Invalid sha256_hex")?;
+        sidecar::write(Path::new(path), &hash).map_err(|e| format!("Failed to write digest: {}", e))
+    })
+}
+
+/* Buffer Pool */
+
+/// configure the shared pool of decode and I/O buffers
+///
+/// @param retain_bytes Maximum idle memory kept for reuse between operations and partitions (0 = keep nothing and free idle buffers now)
+/// @param huge_pages Non-zero to back buffers of 2 MiB and more with transparent huge pages (Linux only, ignored elsewhere)
+///
+/// The default keeps up to 256 MiB of idle buffers without huge pages,
+/// 16 MiB in the low-memory profile.
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_configure_buffer_pool(retain_bytes: u64, huge_pages: i32) {
+    POOL.set_huge_pages(huge_pages != 0);
+    POOL.set_retain_limit(retain_bytes);
+}
+
+/* Utility Functions */
+
+/// get library version
+/// returns a static string, do not free
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_get_version() -> *const c_char {
+    static C_VERSION: &[u8] = concat!(env!("CARGO_PKG_VERSION"), "\0").as_bytes();
+    C_VERSION.as_ptr() as *const c_char
+}
+
+/// tuning applied by payload_init_ex()
+///
+/// every field left at 0 keeps its default, so a zero-initialized struct is
+/// the default configuration
+///
+/// the defaults listed below are those of the normal profile; the
+/// low-memory profile has smaller ones, see payload_set_low_memory()
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct PayloadConfig {
+    /// async I/O worker threads (0 = one per CPU core, at least 2)
+    pub worker_threads: u32,
+    /// upper bound on the blocking pool running decoders and writes (0 = 512)
+    pub blocking_threads: u32,
+    /// operations decoded at the same time (0 = one per CPU core)
+    pub decode_threads: u32,
+    /// partitions written at the same time (0 = unlimited)
+    pub disk_jobs: u32,
+    /// remote partitions downloaded at the same time (0 = unlimited)
+    pub network_jobs: u32,
+    /// concurrent ranged HTTP requests per remote partition (0 = 16)
+    pub http_requests_per_job: u32,
+    /// read-ahead held per remote partition, in bytes (0 = 64 MiB)
+    pub prefetch_bytes: u64,
+    /// size of the sequential reads of one-pass extractions, in bytes (0 = 16 MiB)
+    pub sequential_read_bytes: u64,
+    /// idle decode and I/O buffers kept for reuse, in bytes (0 = 256 MiB)
+    pub buffer_pool_bytes: u64,
+    /// memory budget of all running extractions, in bytes (0 = unlimited)
+    pub memory_budget_bytes: u64,
+}
+
+/// initialize the library with the default configuration
+/// should be called once before any other library functions
+/// @return 0 on success, -1 on failure
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_init() -> i32 {
+    with_error_handling(|| {
+        RUNTIME.block_on(async {});
+        Ok(())
+    })
+}
+
+/// initialize the library with explicit threading, I/O and memory settings
+///
+/// @param config Settings to apply (NULL = defaults, see PayloadConfig)
+/// @return 0 on success, -1 on failure (check payload_get_last_error())
+///
+/// the runtime is rebuilt with the new thread counts, so this fails while an
+/// extraction is running. it may be called again later, e.g. after the user
+/// changed the settings; the limits apply to extractions started afterwards.
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_init_ex(config: *const PayloadConfig) -> i32 {
+    with_error_handling(|| {
+        let config = if config.is_null() {
+            PayloadConfig::default()
+        } else {
+            unsafe { *config }
+        };
+
+        RUNTIME
+            .configure(RuntimeConfig {
+                worker_threads: config.worker_threads as usize,
+                max_blocking_threads: config.blocking_threads as usize,
+            })
+            .map_err(|e| format!("Failed to configure runtime: {}", e))?;
+
+        let defaults = PrefetchConfig::default();
+        PrefetchConfig::set_configured(PrefetchConfig {
+            memory_cap: match config.prefetch_bytes {
+                0 => defaults.memory_cap,
+                n => n,
+            },
+            max_requests: match config.http_requests_per_job {
+                0 => defaults.max_requests,
+                n => n as usize,
+            },
+            ..defaults
+        });
+        onepass::set_read_size(config.sequential_read_bytes);
+        SCHEDULER.set_limits(
+            config.disk_jobs as u64,
+            config.network_jobs as u64,
+            config.decode_threads as u64,
+        );
+        match config.buffer_pool_bytes {
+            0 => POOL.set_default_retain_limit(),
+            n => POOL.set_retain_limit(n),
+        }
+        match config.memory_budget_bytes {
+            0 => BUDGET.set_default_limit(),
+            n => BUDGET.set_limit(n),
+        }
+
+        RUNTIME.block_on(async {});
+        Ok(())
+    })
+}
+
+/// cleanup library resources
+/// should be called once when done using the library
+///
+/// stops the runtime and joins its threads, waiting up to 5 seconds for
+/// decoders that are still finishing a buffer, and frees idle buffers.
+/// a later call into the library starts a fresh runtime.
+#[unsafe(no_mangle)]
+pub extern "C" fn payload_cleanup() {
+    let _ = panic::catch_unwind(|| {
+        RUNTIME.shutdown(Duration::from_secs(5));
+        POOL.trim();
+    });
 }
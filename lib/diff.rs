@@ -0,0 +1,294 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use crate::cache::to_hex;
+use crate::extractor::{is_partition_differential, open_manifest};
+use crate::runtime::RUNTIME;
+use anyhow::{Result, anyhow};
+use payload_dumper_core::structs::install_operation::Type;
+use payload_dumper_core::structs::{DeltaArchiveManifest, PartitionUpdate};
+use payload_dumper_core::utils::format_size;
+use std::collections::HashMap;
+
+#[derive(Debug, Clone, serde::Serialize)]
+pub struct ChangedPartition {
+    pub name: String,
+    pub old_size_bytes: u64,
+    pub new_size_bytes: u64,
+    pub old_hash: Option<String>,
+    pub new_hash: Option<String>,
+    /// bytes whose operation differs between the builds, None when either
+    /// side is differential and operations cannot be compared
+    pub changed_bytes: Option<u64>,
+    pub changed_readable: Option<String>,
+    pub changed_percent: Option<f64>,
+}
+
+#[derive(Debug, Clone, serde::Serialize)]
+pub struct PartitionRef {
+    pub name: String,
+    pub size_bytes: u64,
+    pub hash: Option<String>,
+}
+
+#[derive(Debug, Clone, serde::Serialize)]
+pub struct PayloadDiff {
+    pub changed: Vec<ChangedPartition>,
+    pub added: Vec<PartitionRef>,
+    pub removed: Vec<PartitionRef>,
+    pub unchanged: Vec<String>,
+    /// sum of the estimates of every changed partition plus added ones
+    pub changed_bytes: u64,
+    pub changed_readable: String,
+}
+
+/// what a block of the image is made of: the blob of the operation that
+/// writes it and its position in that operation's output. two blocks with the
+/// same origin hold the same bytes.
+#[derive(Clone, Copy, PartialEq, Eq)]
+enum Origin<'a> {
+    Zero,
+    Blob {
+        kind: i32,
+        hash: &'a [u8],
+        block: u64,
+    },
+    /// no hash to compare by, never equal to anything
+    Unknown,
+}
+
+struct Run<'a> {
+    start: u64,
+    len: u64,
+    origin: Origin<'a>,
+}
+
+fn partition_size(partition: &PartitionUpdate) -> u64 {
+    partition
+        .new_partition_info
+        .as_ref()
+        .and_then(|i| i.size)
+        .unwrap_or(0)
+}
+
+fn partition_hash(partition: &PartitionUpdate) -> Option<String> {
+    partition
+        .new_partition_info
+        .as_ref()
+        .and_then(|i| i.hash.as_deref())
+        .filter(|h| !h.is_empty())
+        .map(to_hex)
+}
+
+/// destination runs of every operation, sorted by start block
+fn runs(partition: &PartitionUpdate) -> Vec<Run<'_>> {
+    let mut runs = Vec::new();
+    for op in &partition.operations {
+        let mut block = 0;
+        for extent in &op.dst_extents {
+            let origin = match (op.r#type(), op.data_sha256_hash.as_deref()) {
+                (Type::Zero | Type::Discard, _) => Origin::Zero,
+                (_, Some(hash)) if !hash.is_empty() => Origin::Blob {
+                    kind: op.r#type() as i32,
+                    hash,
+                    block,
+                },
+                _ => Origin::Unknown,
+            };
+            runs.push(Run {
+                start: extent.start_block(),
+                len: extent.num_blocks(),
+                origin,
+            });
+            block += extent.num_blocks();
+        }
+    }
+    runs.sort_by_key(|r| r.start);
+    runs
+}
+
+/// origin of `block` as written by `run`; blocks no operation writes are
+/// zeros in the extracted image
+fn origin_at<'a>(run: Option<&Run<'a>>, block: u64) -> Origin<'a> {
+    match run.map(|r| (r, r.origin)) {
+        None => Origin::Zero,
+        Some((
+            r,
+            Origin::Blob {
+                kind,
+                hash,
+                block: first,
+            },
+        )) => Origin::Blob {
+            kind,
+            hash,
+            block: first + (block - r.start),
+        },
+        Some((_, origin)) => origin,
+    }
+}
+
+/// blocks written differently in `new` than in `old`, walking both sorted
+/// run lists once
+fn changed_blocks(old: &[Run<'_>], new: &[Run<'_>]) -> u64 {
+    let (mut i, mut j) = (0, 0);
+    let mut position = 0u64;
+    let mut changed = 0u64;
+
+    loop {
+        // skip runs that end before the current position
+        while i < old.len() && old[i].start + old[i].len <= position {
+            i += 1;
+        }
+        while j < new.len() && new[j].start + new[j].len <= position {
+            j += 1;
+        }
+        if i >= old.len() && j >= new.len() {
+            break;
+        }
+
+        let a = old.get(i).filter(|r| r.start <= position);
+        let b = new.get(j).filter(|r| r.start <= position);
+
+        // the next boundary of either side
+        let mut end = u64::MAX;
+        for (run, list, k) in [(a, old, i), (b, new, j)] {
+            end = end.min(match run {
+                Some(r) => r.start + r.len,
+                None => list.get(k).map(|r| r.start).unwrap_or(u64::MAX),
+            });
+        }
+        if a.is_none() && b.is_none() {
+            position = end;
+            continue;
+        }
+
+        let same = match (origin_at(a, position), origin_at(b, position)) {
+            (Origin::Unknown, _) | (_, Origin::Unknown) => false,
+            (x, y) => x == y,
+        };
+        if !same {
+            changed += end - position;
+        }
+        position = end;
+    }
+    changed
+}
+
+/// compare the manifests of two builds without reading any partition data
+///
+/// a partition is unchanged when its size and image hash match. for changed
+/// ones the amount of changed data is estimated from the operation lists:
+/// a block counts as unchanged when both builds write it from a blob with the
+/// same SHA-256 at the same position, which is how identical content ends up
+/// after the payload generator compresses it the same way.
+pub fn diff_manifests(old: &DeltaArchiveManifest, new: &DeltaArchiveManifest) -> PayloadDiff {
+    let block_size = new.block_size.unwrap_or(4096) as u64;
+    let old_parts: HashMap<&str, &PartitionUpdate> = old
+        .partitions
+        .iter()
+        .map(|p| (p.partition_name.as_str(), p))
+        .collect();
+
+    let mut diff = PayloadDiff {
+        changed: Vec::new(),
+        added: Vec::new(),
+        removed: Vec::new(),
+        unchanged: Vec::new(),
+        changed_bytes: 0,
+        changed_readable: String::new(),
+    };
+
+    for part in &new.partitions {
+        let name = part.partition_name.as_str();
+        let new_size = partition_size(part);
+        let new_hash = partition_hash(part);
+
+        let Some(old_part) = old_parts.get(name) else {
+            diff.changed_bytes += new_size;
+            diff.added.push(PartitionRef {
+                name: name.to_string(),
+                size_bytes: new_size,
+                hash: new_hash,
+            });
+            continue;
+        };
+
+        let old_size = partition_size(old_part);
+        let old_hash = partition_hash(old_part);
+        if new_size == old_size && new_hash.is_some() && new_hash == old_hash {
+            diff.unchanged.push(name.to_string());
+            continue;
+        }
+
+        let estimate = if is_partition_differential(part) || is_partition_differential(old_part) {
+            None
+        } else {
+            Some(changed_blocks(&runs(old_part), &runs(part)) * block_size)
+        };
+        // without hashes, identical operation lists mean identical images
+        let hashed = new_hash.is_some() && old_hash.is_some();
+        if estimate == Some(0) && new_size == old_size && !hashed {
+            diff.unchanged.push(name.to_string());
+            continue;
+        }
+
+        let changed = estimate.map(|bytes| bytes.min(new_size.max(old_size)));
+        diff.changed_bytes += changed.unwrap_or(new_size);
+        diff.changed.push(ChangedPartition {
+            name: name.to_string(),
+            old_size_bytes: old_size,
+            new_size_bytes: new_size,
+            old_hash,
+            new_hash,
+            changed_bytes: changed,
+            changed_readable: changed.map(format_size),
+            changed_percent: changed.map(|bytes| {
+                let size = new_size.max(1) as f64;
+                (bytes as f64 * 1000.0 / size).round() / 10.0
+            }),
+        });
+    }
+
+    let new_names: Vec<&str> = new
+        .partitions
+        .iter()
+        .map(|p| p.partition_name.as_str())
+        .collect();
+    for part in &old.partitions {
+        if !new_names.contains(&part.partition_name.as_str()) {
+            diff.removed.push(PartitionRef {
+                name: part.partition_name.clone(),
+                size_bytes: partition_size(part),
+                hash: partition_hash(part),
+            });
+        }
+    }
+
+    diff.changed_readable = format_size(diff.changed_bytes);
+    diff
+}
+
+/// compare two payloads (payload.bin, OTA zip or http(s) URL each) as JSON
+///
+/// only the two manifests are fetched, concurrently, so this takes about as
+/// long as listing the slower of the two
+pub fn diff_payloads(
+    old_source: &str,
+    new_source: &str,
+    ua: Option<&str>,
+    ck: Option<&str>,
+) -> Result<String> {
+    if tokio::runtime::Handle::try_current().is_ok() {
+        panic!("Cannot be called from async context");
+    }
+
+    RUNTIME.block_on(async {
+        let (old, new) = tokio::try_join!(
+            open_manifest(old_source, ua, ck),
+            open_manifest(new_source, ua, ck)
+        )?;
+        let diff = diff_manifests(&old.0, &new.0);
+        serde_json::to_string_pretty(&diff).map_err(|e| anyhow!("Serialization failed: {}", e))
+    })
+}
@@ -0,0 +1,541 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use crate::budget::{BUDGET, BudgetPermit, operation_footprint};
+use crate::cache::to_hex;
+use crate::cancel::CancelToken;
+use crate::output::OutputFile;
+use crate::pool::{POOL, PooledBuf};
+use crate::profile;
+use crate::scheduler::SCHEDULER;
+use crate::throttle::JobPace;
+use anyhow::{Result, anyhow};
+use payload_dumper_core::payload::payload_dumper::{AsyncPayloadRead, ProgressReporter};
+use payload_dumper_core::structs::install_operation::Type;
+use payload_dumper_core::structs::{Extent, InstallOperation, PartitionUpdate};
+use sha2::{Digest, Sha256};
+use std::collections::BTreeMap;
+use std::fs::File;
+use std::io::{self, Read};
+use std::ops::Range;
+use std::path::Path;
+use std::sync::Arc;
+use tokio::task::JoinSet;
+
+/// true when every operation of the partition can be decoded in-tree
+///
+/// full OTAs only contain these; anything that needs source data goes through
+/// dump_partition from payload_dumper_core instead
+pub fn is_supported(partition: &PartitionUpdate) -> bool {
+    partition.operations.iter().all(|op| {
+        matches!(
+            op.r#type(),
+            Type::Replace
+                | Type::ReplaceXz
+                | Type::ReplaceBz
+                | Type::Zstd
+                | Type::Zero
+                | Type::Discard
+        )
+    })
+}
+
+/// bytes read once and shared by every operation whose blob they contain,
+/// together with the memory reserved for them
+pub(crate) struct SharedRead {
+    data: Vec<u8>,
+    _permit: BudgetPermit,
+}
+
+impl SharedRead {
+    pub(crate) fn new(data: Vec<u8>, permit: BudgetPermit) -> Self {
+        Self {
+            data,
+            _permit: permit,
+        }
+    }
+
+    pub(crate) fn len(&self) -> usize {
+        self.data.len()
+    }
+}
+
+/// blob of one operation: read on its own or a window into a larger read
+pub(crate) enum Input {
+    Owned(Vec<u8>),
+    Shared(Arc<SharedRead>, Range<usize>),
+}
+
+impl Input {
+    fn as_slice(&self) -> &[u8] {
+        match self {
+            Input::Owned(data) => data,
+            Input::Shared(read, range) => &read.data[range.clone()],
+        }
+    }
+}
+
+/// output of one operation, kept until it has been fed to the digest
+pub(crate) enum Decoded {
+    Raw(Input),
+    Pooled(PooledBuf),
+    Zero,
+    /// decoded straight to the output file, see stream_operation()
+    Written,
+}
+
+impl Decoded {
+    pub(crate) fn as_slice(&self) -> &[u8] {
+        match self {
+            Decoded::Raw(data) => data.as_slice(),
+            Decoded::Pooled(buf) => buf,
+            Decoded::Zero | Decoded::Written => &[],
+        }
+    }
+
+    /// what of a written operation to keep until the digest reaches it
+    ///
+    /// its reservation is released once it is written; under a budget the
+    /// buffer goes with it and the digest reads the data back from the image
+    pub(crate) fn park(self) -> Decoded {
+        match self {
+            Decoded::Raw(_) | Decoded::Pooled(_) if BUDGET.limit() != 0 => Decoded::Written,
+            decoded => decoded,
+        }
+    }
+}
+
+type TaskOutput = (usize, io::Result<Decoded>, BudgetPermit);
+
+/// SHA-256 of the image in destination order, computed from the decoded
+/// operations instead of re-reading the file
+///
+/// gaps between extents (and the tail up to the partition size) hash as
+/// zeros. if an operation writes below what was already hashed the digest
+/// cannot be streamed and is abandoned.
+pub(crate) struct StreamDigest {
+    hasher: Sha256,
+    position: u64,
+    block_size: u64,
+}
+
+impl StreamDigest {
+    pub(crate) fn new(block_size: u64) -> Self {
+        Self {
+            hasher: Sha256::new(),
+            position: 0,
+            block_size,
+        }
+    }
+
+    pub(crate) fn update(&mut self, extents: &[Extent], data: &[u8]) -> bool {
+        let mut pos = 0usize;
+        for extent in extents {
+            let start = extent.start_block() * self.block_size;
+            let len = extent.num_blocks() * self.block_size;
+            if start < self.position {
+                return false;
+            }
+            self.zeros(start - self.position);
+
+            let end = (pos + len as usize).min(data.len());
+            let chunk = if pos < end { &data[pos..end] } else { &[][..] };
+            self.hasher.update(chunk);
+            self.zeros(len - chunk.len() as u64);
+
+            self.position = start + len;
+            pos += len as usize;
+        }
+        true
+    }
+
+    fn zeros(&mut self, mut count: u64) {
+        static ZEROS: [u8; 64 * 1024] = [0; 64 * 1024];
+        while count > 0 {
+            let n = count.min(ZEROS.len() as u64) as usize;
+            self.hasher.update(&ZEROS[..n]);
+            count -= n as u64;
+        }
+    }
+
+    /// update() with a written operation, wherever its data is kept
+    pub(crate) fn update_written(
+        &mut self,
+        file: &OutputFile,
+        extents: &[Extent],
+        decoded: &Decoded,
+    ) -> io::Result<bool> {
+        match decoded {
+            Decoded::Written => self.update_from_file(file, extents),
+            _ => Ok(self.update(extents, decoded.as_slice())),
+        }
+    }
+
+    /// like update(), reading the data back from the extents of `file`
+    pub(crate) fn update_from_file(
+        &mut self,
+        file: &OutputFile,
+        extents: &[Extent],
+    ) -> io::Result<bool> {
+        let mut buf = POOL.get(STREAM_CHUNK);
+        for extent in extents {
+            let start = extent.start_block() * self.block_size;
+            let len = extent.num_blocks() * self.block_size;
+            if start < self.position {
+                return Ok(false);
+            }
+            self.zeros(start - self.position);
+
+            let mut at = 0u64;
+            while at < len {
+                let n = (len - at).min(STREAM_CHUNK as u64) as usize;
+                file.read_exact_at(&mut buf[..n], start + at)?;
+                self.hasher.update(&buf[..n]);
+                at += n as u64;
+            }
+            self.position = start + len;
+        }
+        Ok(true)
+    }
+
+    pub(crate) fn finish(mut self, size: Option<u64>) -> Vec<u8> {
+        if let Some(size) = size {
+            self.zeros(size.saturating_sub(self.position));
+        }
+        self.hasher.finalize().to_vec()
+    }
+}
+
+/// extract a full (non-differential) partition
+///
+/// operations of a full payload write disjoint destination extents, so they
+/// are read in order, decoded on the blocking pool in parallel and written by
+/// position under the global decode limit. completions are re-ordered before
+/// they reach the digest, which keeps the hash identical to a sequential pass.
+/// operations in flight are bounded by the decode slots, a per-job window and
+/// the memory budget; decode buffers come from the shared pool.
+///
+/// returns true when the image was checked against the manifest hash
+pub async fn extract_partition<R: AsyncPayloadRead>(
+    partition: &PartitionUpdate,
+    data_offset: u64,
+    block_size: u64,
+    output_path: &Path,
+    reader: &R,
+    reporter: &dyn ProgressReporter,
+    cancel: &Arc<CancelToken>,
+) -> Result<bool> {
+    let name = partition.partition_name.as_str();
+    let operations = &partition.operations;
+    let total_operations = operations.len() as u64;
+    let info = partition.new_partition_info.as_ref();
+    let size = info.and_then(|i| i.size);
+    let expected_hash = info.and_then(|i| i.hash.clone()).filter(|h| !h.is_empty());
+    let max_in_flight = profile::in_flight();
+    let pace = JobPace::new();
+
+    reporter.on_start(name, total_operations);
+
+    let file = Arc::new(OutputFile::create(output_path, size, block_size)?);
+
+    let mut digest = expected_hash
+        .as_ref()
+        .map(|_| StreamDigest::new(block_size));
+    let mut tasks: JoinSet<TaskOutput> = JoinSet::new();
+    // finished out of order, waiting for an earlier operation to reach the digest
+    let mut finished: BTreeMap<usize, Decoded> = BTreeMap::new();
+    let mut next_digest = 0usize;
+    let mut completed = 0u64;
+
+    let mut on_finished =
+        |output: TaskOutput, finished: &mut BTreeMap<usize, Decoded>| -> Result<()> {
+            let (index, result, permit) = output;
+            let decoded = result.map_err(|e| anyhow!("Operation {} failed: {}", index, e))?;
+            // the operation is in the image, its memory is not needed for that
+            drop(permit);
+            let decoded = match digest {
+                None => Decoded::Zero,
+                Some(_) if index != next_digest => decoded.park(),
+                Some(_) => decoded,
+            };
+            finished.insert(index, decoded);
+
+            completed += 1;
+            reporter.on_progress(name, completed, total_operations);
+
+            while let Some(decoded) = finished.remove(&next_digest) {
+                if let Some(d) = digest.as_mut() {
+                    let extents = &operations[next_digest].dst_extents;
+                    if !d.update_written(&file, extents, &decoded)? {
+                        digest = None;
+                    }
+                }
+                next_digest += 1;
+            }
+            Ok(())
+        };
+
+    for (index, op) in operations.iter().enumerate() {
+        if reporter.is_cancelled() {
+            tasks.abort_all();
+            return Err(anyhow!("Extraction cancelled"));
+        }
+
+        // the head of the reorder buffer is always still in `tasks`, so this
+        // never waits on an empty set
+        while tasks.len() + finished.len() >= max_in_flight {
+            let output = join_next(&mut tasks).await?;
+            on_finished(output, &mut finished)?;
+        }
+
+        let streamed = is_streamed(op, block_size);
+        let footprint = op.data_length() + decode_footprint(op, block_size);
+        let permit = BUDGET
+            .acquire_reaping(footprint, &mut tasks, |output| {
+                on_finished(output, &mut finished)
+            })
+            .await?;
+        let data = if op.data_length() > 0 {
+            reader
+                .read_bytes(data_offset + op.data_offset(), op.data_length())
+                .await?
+        } else {
+            Vec::new()
+        };
+
+        pace.disk(written_len(op, block_size)).await;
+        let slot = SCHEDULER.decode.acquire().await;
+        let file = Arc::clone(&file);
+        let cancel = Arc::clone(cancel);
+        let op = op.clone();
+
+        tasks.spawn_blocking(move || {
+            let input = Input::Owned(data);
+            let result = if streamed {
+                stream_operation(&op, input, block_size, &file, &cancel).map(|_| Decoded::Written)
+            } else {
+                apply_operation(&op, input, block_size, &file, &cancel)
+            };
+            drop(slot);
+            (index, result, permit)
+        });
+    }
+
+    while !tasks.is_empty() {
+        let output = join_next(&mut tasks).await?;
+        on_finished(output, &mut finished)?;
+    }
+    file.flush()?;
+
+    let verified = digest.is_some();
+    if let (Some(d), Some(expected)) = (digest, expected_hash) {
+        let actual = d.finish(size);
+        if actual != expected {
+            return Err(anyhow!(
+                "Hash mismatch for {}: expected {}, got {}",
+                name,
+                to_hex(&expected),
+                to_hex(&actual)
+            ));
+        }
+    }
+
+    reporter.on_complete(name, total_operations);
+    Ok(verified)
+}
+
+async fn join_next(tasks: &mut JoinSet<TaskOutput>) -> Result<TaskOutput> {
+    tasks
+        .join_next()
+        .await
+        .ok_or_else(|| anyhow!("No decode task in flight"))?
+        .map_err(|e| anyhow!("Decode task failed: {}", e))
+}
+
+pub(crate) fn extents_len(extents: &[Extent], block_size: u64) -> u64 {
+    extents.iter().map(|e| e.num_blocks() * block_size).sum()
+}
+
+/// compressed operations producing more than this are decoded straight to
+/// disk in the low-memory profile
+const LOW_MEMORY_STREAM_MIN: u64 = 4 * 1024 * 1024;
+
+/// output decoded and written at a time by stream_operation()
+const STREAM_CHUNK: usize = 1024 * 1024;
+
+pub(crate) fn is_streamed(op: &InstallOperation, block_size: u64) -> bool {
+    profile::low_memory()
+        && matches!(op.r#type(), Type::ReplaceXz | Type::ReplaceBz | Type::Zstd)
+        && extents_len(&op.dst_extents, block_size) > LOW_MEMORY_STREAM_MIN
+}
+
+/// memory an operation needs besides its blob: its decoded output, or one
+/// chunk of it when it is decoded straight to disk
+pub(crate) fn decode_footprint(op: &InstallOperation, block_size: u64) -> u64 {
+    if is_streamed(op, block_size) {
+        STREAM_CHUNK as u64
+    } else {
+        operation_footprint(op, block_size) - op.data_length()
+    }
+}
+
+/// decode a compressed operation chunk by chunk into its destination
+/// extents, so its output never sits in memory whole
+pub(crate) fn stream_operation(
+    op: &InstallOperation,
+    data: Input,
+    block_size: u64,
+    file: &OutputFile,
+    cancel: &CancelToken,
+) -> io::Result<()> {
+    let input = data.as_slice();
+    let mut decoder: Box<dyn Read + '_> = match op.r#type() {
+        Type::ReplaceXz => Box::new(xz2::read::XzDecoder::new(input)),
+        Type::ReplaceBz => Box::new(bzip2::read::BzDecoder::new(input)),
+        Type::Zstd => Box::new(zstd::stream::read::Decoder::new(input)?),
+        other => {
+            return Err(io::Error::new(
+                io::ErrorKind::InvalidInput,
+                format!("Unsupported operation type {:?}", other),
+            ));
+        }
+    };
+
+    let total = extents_len(&op.dst_extents, block_size);
+    let mut buf = POOL.get(STREAM_CHUNK);
+    let mut done = 0u64;
+    while done < total {
+        let want = (total - done).min(STREAM_CHUNK as u64) as usize;
+        let n = read_full(&mut decoder, &mut buf[..want], cancel)?;
+        // like decompress(), output the stream does not cover is zeros
+        buf[n..want].fill(0);
+        file.write_extents(&op.dst_extents, block_size, done, &buf[..want])?;
+        done += want as u64;
+    }
+    Ok(())
+}
+
+/// bytes apply_operation() writes for `op`; ZERO and DISCARD write nothing
+pub(crate) fn written_len(op: &InstallOperation, block_size: u64) -> u64 {
+    match op.r#type() {
+        Type::Zero | Type::Discard => 0,
+        _ => extents_len(&op.dst_extents, block_size),
+    }
+}
+
+pub(crate) fn apply_operation(
+    op: &InstallOperation,
+    data: Input,
+    block_size: u64,
+    file: &OutputFile,
+    cancel: &CancelToken,
+) -> io::Result<Decoded> {
+    let decoded = decode_operation(op, data, block_size, cancel)?;
+    if !matches!(decoded, Decoded::Zero) {
+        file.write_extents(&op.dst_extents, block_size, 0, decoded.as_slice())?;
+    }
+    Ok(decoded)
+}
+
+/// the bytes an operation writes to its destination extents, in extent order
+pub(crate) fn decode_operation(
+    op: &InstallOperation,
+    data: Input,
+    block_size: u64,
+    cancel: &CancelToken,
+) -> io::Result<Decoded> {
+    match op.r#type() {
+        Type::Replace => Ok(Decoded::Raw(data)),
+        Type::Zero | Type::Discard => Ok(Decoded::Zero),
+        kind => {
+            let mut out = POOL.get(extents_len(&op.dst_extents, block_size) as usize);
+            decompress(kind, data.as_slice(), &mut out, cancel)?;
+            Ok(Decoded::Pooled(out))
+        }
+    }
+}
+
+/// decode `input` into `out`, zero-filling whatever the stream does not cover
+///
+/// streaming decoders stop at the next buffer boundary once `cancel` fires;
+/// zstd blobs are decoded in one call, they are small enough not to matter
+pub(crate) fn decompress(
+    kind: Type,
+    input: &[u8],
+    out: &mut [u8],
+    cancel: &CancelToken,
+) -> io::Result<()> {
+    let filled = match kind {
+        Type::ReplaceXz => read_full(xz2::read::XzDecoder::new(input), out, cancel)?,
+        Type::ReplaceBz => read_full(bzip2::read::BzDecoder::new(input), out, cancel)?,
+        Type::Zstd => zstd::bulk::decompress_to_buffer(input, out)?,
+        other => {
+            return Err(io::Error::new(
+                io::ErrorKind::InvalidInput,
+                format!("Unsupported operation type {:?}", other),
+            ));
+        }
+    };
+    out[filled..].fill(0);
+    Ok(())
+}
+
+/// how much is decoded between two cancellation checks
+const DECODE_CHUNK: usize = 1024 * 1024;
+
+fn read_full<D: Read>(mut decoder: D, out: &mut [u8], cancel: &CancelToken) -> io::Result<usize> {
+    let mut filled = 0;
+    while filled < out.len() {
+        if cancel.is_cancelled() {
+            return Err(io::Error::other("Extraction cancelled"));
+        }
+        let end = (filled + DECODE_CHUNK).min(out.len());
+        match decoder.read(&mut out[filled..end]) {
+            Ok(0) => break,
+            Ok(n) => filled += n,
+            Err(e) if e.kind() == io::ErrorKind::Interrupted => continue,
+            Err(e) => return Err(e),
+        }
+    }
+    Ok(filled)
+}
+
+#[cfg(unix)]
+pub(crate) fn read_at(file: &File, buf: &mut [u8], offset: u64) -> io::Result<()> {
+    use std::os::unix::fs::FileExt;
+    file.read_exact_at(buf, offset)
+}
+
+#[cfg(windows)]
+pub(crate) fn read_at(file: &File, mut buf: &mut [u8], mut offset: u64) -> io::Result<()> {
+    use std::os::windows::fs::FileExt;
+    while !buf.is_empty() {
+        let n = file.seek_read(buf, offset)?;
+        if n == 0 {
+            return Err(io::ErrorKind::UnexpectedEof.into());
+        }
+        buf = &mut std::mem::take(&mut buf)[n..];
+        offset += n as u64;
+    }
+    Ok(())
+}
+
+#[cfg(unix)]
+pub(crate) fn write_at(file: &File, buf: &[u8], offset: u64) -> io::Result<()> {
+    use std::os::unix::fs::FileExt;
+    file.write_all_at(buf, offset)
+}
+
+#[cfg(windows)]
+pub(crate) fn write_at(file: &File, mut buf: &[u8], mut offset: u64) -> io::Result<()> {
+    use std::os::windows::fs::FileExt;
+    while !buf.is_empty() {
+        let n = file.seek_write(buf, offset)?;
+        if n == 0 {
+            return Err(io::ErrorKind::WriteZero.into());
+        }
+        buf = &buf[n..];
+        offset += n as u64;
+    }
+    Ok(())
+}
@@ -0,0 +1,212 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use crate::fs::{Format, Inode, Segment, le16, le32, le64, read_exact};
+use crate::image::VirtualImage;
+use anyhow::{Result, anyhow};
+
+const SUPERBLOCK_OFFSET: u64 = 1024;
+const MAGIC: u32 = 0xE0F5_E1E2;
+
+/// inodes are addressed in 32 byte slots from the metadata block
+const NID_SHIFT: u32 = 5;
+const COMPACT_INODE: u64 = 32;
+const EXTENDED_INODE: u64 = 64;
+
+const FLAT_PLAIN: u8 = 0;
+const COMPRESSED_FULL: u8 = 1;
+const FLAT_INLINE: u8 = 2;
+const COMPRESSED_COMPACT: u8 = 3;
+const CHUNK_BASED: u8 = 4;
+
+const CHUNK_FORMAT_BLKBITS_MASK: u32 = 0x1F;
+const CHUNK_FORMAT_INDEXES: u32 = 0x20;
+const NULL_ADDR: u32 = u32::MAX;
+
+const DIRENT_SIZE: usize = 12;
+
+/// EROFS with uncompressed layouts: plain, tail-packed inline and chunk
+/// based files. directories are never compressed, so compressed images can
+/// still be browsed; only extracting their compressed files fails.
+pub struct Erofs {
+    blkszbits: u32,
+    meta_blkaddr: u64,
+    root_nid: u64,
+}
+
+impl Erofs {
+    /// None when `image` holds no EROFS superblock
+    pub fn probe(image: &VirtualImage) -> Result<Option<Self>> {
+        if image.size() < SUPERBLOCK_OFFSET + 128 {
+            return Ok(None);
+        }
+        let sb = read_exact(image, SUPERBLOCK_OFFSET, 128)?;
+        if le32(&sb, 0) != MAGIC {
+            return Ok(None);
+        }
+        let blkszbits = sb[12] as u32;
+        if !(9..=16).contains(&blkszbits) {
+            return Err(anyhow!("Unsupported EROFS block size"));
+        }
+        Ok(Some(Self {
+            blkszbits,
+            meta_blkaddr: le32(&sb, 40) as u64,
+            root_nid: le16(&sb, 14) as u64,
+        }))
+    }
+
+    fn block_size(&self) -> u64 {
+        1 << self.blkszbits
+    }
+}
+
+/// layout and the byte offset right after the inode and its inline xattrs,
+/// where inline data and chunk indexes live
+fn geometry(inode: &Inode) -> (u8, u64) {
+    let format = le16(&inode.raw, 0);
+    let inode_size = if format & 1 != 0 {
+        EXTENDED_INODE
+    } else {
+        COMPACT_INODE
+    };
+    let xattr_count = le16(&inode.raw, 2) as u64;
+    let xattr_size = if xattr_count == 0 {
+        0
+    } else {
+        12 + (xattr_count - 1) * 4
+    };
+    (
+        ((format >> 1) & 0x7) as u8,
+        inode.offset + inode_size + xattr_size,
+    )
+}
+
+impl Format for Erofs {
+    fn name(&self) -> &'static str {
+        "erofs"
+    }
+
+    fn root(&self) -> u64 {
+        self.root_nid
+    }
+
+    fn inode(&self, image: &VirtualImage, id: u64) -> Result<Inode> {
+        let offset = (self.meta_blkaddr << self.blkszbits) + (id << NID_SHIFT);
+        let mut raw = read_exact(image, offset, COMPACT_INODE as usize)?;
+        let size = if le16(&raw, 0) & 1 != 0 {
+            raw = read_exact(image, offset, EXTENDED_INODE as usize)?;
+            le64(&raw, 8)
+        } else {
+            le32(&raw, 8) as u64
+        };
+        Ok(Inode {
+            id,
+            mode: le16(&raw, 4),
+            size,
+            offset,
+            raw,
+        })
+    }
+
+    fn segments(&self, image: &VirtualImage, inode: &Inode) -> Result<Vec<Segment>> {
+        let (layout, tail) = geometry(inode);
+        let raw_blkaddr = le32(&inode.raw, 16) as u64;
+        let block_size = self.block_size();
+
+        match layout {
+            FLAT_PLAIN => Ok(vec![Segment {
+                file_offset: 0,
+                len: inode.size,
+                source: Some(raw_blkaddr << self.blkszbits),
+            }]),
+            FLAT_INLINE => {
+                // every block but the last is stored at raw_blkaddr, the last
+                // one right after the inode
+                let full = inode.size.div_ceil(block_size).saturating_sub(1) * block_size;
+                let mut out = Vec::new();
+                if full > 0 {
+                    out.push(Segment {
+                        file_offset: 0,
+                        len: full,
+                        source: Some(raw_blkaddr << self.blkszbits),
+                    });
+                }
+                out.push(Segment {
+                    file_offset: full,
+                    len: inode.size - full,
+                    source: Some(tail),
+                });
+                Ok(out)
+            }
+            CHUNK_BASED => {
+                let format = le32(&inode.raw, 16);
+                let chunk_bits = self.blkszbits + (format & CHUNK_FORMAT_BLKBITS_MASK);
+                let chunk_size = 1u64 << chunk_bits;
+                let chunks = inode.size.div_ceil(chunk_size) as usize;
+                let (unit, at) = if format & CHUNK_FORMAT_INDEXES != 0 {
+                    (8, tail.next_multiple_of(8))
+                } else {
+                    (4, tail.next_multiple_of(4))
+                };
+
+                let table = read_exact(image, at, chunks * unit)?;
+                let mut out = Vec::with_capacity(chunks);
+                for i in 0..chunks {
+                    // an index is { advise: u16, device_id: u16, blkaddr: u32 }
+                    let blkaddr = le32(&table, i * unit + unit - 4);
+                    if blkaddr == NULL_ADDR {
+                        continue;
+                    }
+                    out.push(Segment {
+                        file_offset: i as u64 * chunk_size,
+                        len: chunk_size,
+                        source: Some((blkaddr as u64) << self.blkszbits),
+                    });
+                }
+                Ok(out)
+            }
+            COMPRESSED_FULL | COMPRESSED_COMPACT => Err(anyhow!(
+                "Inode {} is compressed, extracting compressed EROFS files is not supported",
+                inode.id
+            )),
+            other => Err(anyhow!(
+                "Inode {} has unknown EROFS layout {}",
+                inode.id,
+                other
+            )),
+        }
+    }
+
+    fn dir_entries(&self, data: &[u8]) -> Result<Vec<(String, u64)>> {
+        let mut entries = Vec::new();
+        for block in data.chunks(self.block_size() as usize) {
+            if block.len() < DIRENT_SIZE {
+                break;
+            }
+            // the name of the first entry follows the last dirent
+            let count = le16(block, 8) as usize / DIRENT_SIZE;
+            if count == 0 || count * DIRENT_SIZE > block.len() {
+                return Err(anyhow!("Corrupt EROFS directory block"));
+            }
+            for i in 0..count {
+                let dirent = &block[i * DIRENT_SIZE..(i + 1) * DIRENT_SIZE];
+                let start = le16(dirent, 8) as usize;
+                let end = if i + 1 < count {
+                    le16(block, (i + 1) * DIRENT_SIZE + 8) as usize
+                } else {
+                    block.len()
+                };
+                if start > end || end > block.len() {
+                    return Err(anyhow!("Corrupt EROFS directory block"));
+                }
+                // the last name of a block may be padded with zeros
+                let name = &block[start..end];
+                let name = name.split(|&b| b == 0).next().unwrap_or(name);
+                if name != b"." && name != b".." {
+                    entries.push((String::from_utf8_lossy(name).into_owned(), le64(dirent, 0)));
+                }
+            }
+        }
+        Ok(entries)
+    }
+}
@@ -0,0 +1,303 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use crate::fs::{Format, Inode, Segment, le16, le32, read_exact};
+use crate::image::VirtualImage;
+use anyhow::{Result, anyhow};
+
+const SUPERBLOCK_OFFSET: u64 = 1024;
+const MAGIC: u16 = 0xEF53;
+
+const INCOMPAT_META_BG: u32 = 0x10;
+const INCOMPAT_64BIT: u32 = 0x80;
+
+const EXTENTS_FL: u32 = 0x80000;
+const INLINE_DATA_FL: u32 = 0x1000_0000;
+
+const EXTENT_MAGIC: u16 = 0xF30A;
+/// i_block, the 60 bytes holding the extent root or the block map
+const I_BLOCK: usize = 0x28;
+const I_BLOCK_LEN: usize = 60;
+/// leaf extents longer than this are uninitialized and read as zeros
+const MAX_INIT_LEN: u16 = 32768;
+
+/// ext4 as written by the Android build: extent or block mapped files,
+/// linear or hashed directories (hash blocks look like empty entries to a
+/// linear scan) and fast symlinks
+pub struct Ext4 {
+    block_size: u64,
+    inodes_per_group: u64,
+    inode_size: u64,
+    desc_size: u64,
+    /// byte offset of the group descriptor table
+    gdt_offset: u64,
+}
+
+impl Ext4 {
+    /// None when `image` does not start with an ext4 superblock
+    pub fn probe(image: &VirtualImage) -> Result<Option<Self>> {
+        if image.size() < SUPERBLOCK_OFFSET + 1024 {
+            return Ok(None);
+        }
+        let sb = read_exact(image, SUPERBLOCK_OFFSET, 1024)?;
+        if le16(&sb, 0x38) != MAGIC {
+            return Ok(None);
+        }
+
+        let log_block_size = le32(&sb, 0x18);
+        if log_block_size > 6 {
+            return Err(anyhow!("Unsupported ext4 block size"));
+        }
+        let block_size = 1024u64 << log_block_size;
+        let first_data_block = le32(&sb, 0x14) as u64;
+        let inode_size = if le32(&sb, 0x4C) == 0 {
+            128
+        } else {
+            le16(&sb, 0x58) as u64
+        };
+        let incompat = le32(&sb, 0x60);
+        if incompat & INCOMPAT_META_BG != 0 {
+            return Err(anyhow!("ext4 meta_bg layout is not supported"));
+        }
+        let desc_size = if incompat & INCOMPAT_64BIT != 0 {
+            (le16(&sb, 0xFE) as u64).max(32)
+        } else {
+            32
+        };
+
+        Ok(Some(Self {
+            block_size,
+            inodes_per_group: le32(&sb, 0x28) as u64,
+            inode_size,
+            desc_size,
+            gdt_offset: (first_data_block + 1) * block_size,
+        }))
+    }
+
+    fn block(&self, image: &VirtualImage, block: u64) -> Result<Vec<u8>> {
+        read_exact(image, block * self.block_size, self.block_size as usize)
+    }
+
+    /// leaf extents under the node in `node` (i_block or a tree block)
+    fn extents(
+        &self,
+        image: &VirtualImage,
+        node: &[u8],
+        depth_left: u32,
+        out: &mut Vec<Segment>,
+    ) -> Result<()> {
+        if le16(node, 0) != EXTENT_MAGIC {
+            return Err(anyhow!("Corrupt ext4 extent header"));
+        }
+        let entries = le16(node, 2) as usize;
+        let depth = le16(node, 6);
+        if 12 + entries * 12 > node.len() || depth as u32 > depth_left {
+            return Err(anyhow!("Corrupt ext4 extent tree"));
+        }
+
+        for i in 0..entries {
+            let e = &node[12 + i * 12..24 + i * 12];
+            let logical = le32(e, 0) as u64;
+            if depth == 0 {
+                let raw_len = le16(e, 4);
+                let (len, initialized) = if raw_len > MAX_INIT_LEN {
+                    (raw_len - MAX_INIT_LEN, false)
+                } else {
+                    (raw_len, true)
+                };
+                let physical = (le16(e, 6) as u64) << 32 | le32(e, 8) as u64;
+                out.push(Segment {
+                    file_offset: logical * self.block_size,
+                    len: len as u64 * self.block_size,
+                    source: initialized.then_some(physical * self.block_size),
+                });
+            } else {
+                let child = (le16(e, 8) as u64) << 32 | le32(e, 4) as u64;
+                let block = self.block(image, child)?;
+                self.extents(image, &block, depth as u32 - 1, out)?;
+            }
+        }
+        Ok(())
+    }
+
+    /// segments of a file mapped by the old direct/indirect block scheme
+    fn block_map(&self, image: &VirtualImage, i_block: &[u8], size: u64) -> Result<Vec<Segment>> {
+        let blocks = size.div_ceil(self.block_size);
+        let per_block = self.block_size / 4;
+        let mut out: Vec<Segment> = Vec::new();
+        let mut logical = 0u64;
+
+        for i in 0..12 {
+            push_block(
+                &mut out,
+                logical,
+                le32(i_block, i * 4) as u64,
+                self.block_size,
+            );
+            logical += 1;
+        }
+        for level in 1..=3u32 {
+            if logical >= blocks {
+                break;
+            }
+            let root = le32(i_block, (11 + level as usize) * 4) as u64;
+            self.indirect(
+                image,
+                root,
+                level,
+                per_block,
+                blocks,
+                &mut logical,
+                &mut out,
+            )?;
+        }
+        Ok(out)
+    }
+
+    #[allow(clippy::too_many_arguments)]
+    fn indirect(
+        &self,
+        image: &VirtualImage,
+        block: u64,
+        level: u32,
+        per_block: u64,
+        blocks: u64,
+        logical: &mut u64,
+        out: &mut Vec<Segment>,
+    ) -> Result<()> {
+        if block == 0 {
+            // a hole over the whole subtree
+            *logical += per_block.pow(level);
+            return Ok(());
+        }
+        let data = self.block(image, block)?;
+        for i in 0..per_block as usize {
+            if *logical >= blocks {
+                break;
+            }
+            let child = le32(&data, i * 4) as u64;
+            if level == 1 {
+                push_block(out, *logical, child, self.block_size);
+                *logical += 1;
+            } else {
+                self.indirect(image, child, level - 1, per_block, blocks, logical, out)?;
+            }
+        }
+        Ok(())
+    }
+}
+
+/// add one mapped block, merged into the previous segment when contiguous
+fn push_block(out: &mut Vec<Segment>, logical: u64, physical: u64, block_size: u64) {
+    if physical == 0 {
+        return;
+    }
+    let (file_offset, source) = (logical * block_size, physical * block_size);
+    if let Some(last) = out.last_mut() {
+        if last.file_offset + last.len == file_offset
+            && last.source.map(|s| s + last.len) == Some(source)
+        {
+            last.len += block_size;
+            return;
+        }
+    }
+    out.push(Segment {
+        file_offset,
+        len: block_size,
+        source: Some(source),
+    });
+}
+
+impl Format for Ext4 {
+    fn name(&self) -> &'static str {
+        "ext4"
+    }
+
+    fn root(&self) -> u64 {
+        2
+    }
+
+    fn inode(&self, image: &VirtualImage, id: u64) -> Result<Inode> {
+        if id == 0 || self.inodes_per_group == 0 {
+            return Err(anyhow!("Invalid ext4 inode {}", id));
+        }
+        let group = (id - 1) / self.inodes_per_group;
+        let index = (id - 1) % self.inodes_per_group;
+
+        let desc = read_exact(
+            image,
+            self.gdt_offset + group * self.desc_size,
+            self.desc_size as usize,
+        )?;
+        let mut table = le32(&desc, 0x08) as u64;
+        if self.desc_size >= 64 {
+            table |= (le32(&desc, 0x28) as u64) << 32;
+        }
+
+        let offset = table * self.block_size + index * self.inode_size;
+        let raw = read_exact(image, offset, self.inode_size.max(128) as usize)?;
+        Ok(Inode {
+            id,
+            mode: le16(&raw, 0),
+            size: (le32(&raw, 0x6C) as u64) << 32 | le32(&raw, 0x04) as u64,
+            offset,
+            raw,
+        })
+    }
+
+    fn segments(&self, image: &VirtualImage, inode: &Inode) -> Result<Vec<Segment>> {
+        let flags = le32(&inode.raw, 0x20);
+        let i_block = &inode.raw[I_BLOCK..I_BLOCK + I_BLOCK_LEN];
+        let in_inode = Segment {
+            file_offset: 0,
+            len: inode.size,
+            source: Some(inode.offset + I_BLOCK as u64),
+        };
+
+        if flags & INLINE_DATA_FL != 0 {
+            // inline directories and anything past i_block live in the
+            // system.data extended attribute
+            if inode.size > I_BLOCK_LEN as u64 || inode.is_dir() {
+                return Err(anyhow!(
+                    "Inode {} keeps data in extended attributes, not supported",
+                    inode.id
+                ));
+            }
+            return Ok(vec![in_inode]);
+        }
+        if flags & EXTENTS_FL != 0 {
+            let mut out = Vec::new();
+            self.extents(image, i_block, 5, &mut out)?;
+            out.sort_by_key(|s| s.file_offset);
+            return Ok(out);
+        }
+        // fast symlinks keep the target in i_block
+        if inode.mode & 0o170000 == 0o120000 && inode.size < I_BLOCK_LEN as u64 {
+            return Ok(vec![in_inode]);
+        }
+        self.block_map(image, i_block, inode.size)
+    }
+
+    fn dir_entries(&self, data: &[u8]) -> Result<Vec<(String, u64)>> {
+        let mut entries = Vec::new();
+        for block in data.chunks(self.block_size as usize) {
+            let mut at = 0usize;
+            while at + 8 <= block.len() {
+                let ino = le32(block, at) as u64;
+                let rec_len = le16(block, at + 4) as usize;
+                let name_len = block[at + 6] as usize;
+                if rec_len < 8 || at + rec_len > block.len() {
+                    break;
+                }
+                if ino != 0 && 8 + name_len <= rec_len {
+                    let name = String::from_utf8_lossy(&block[at + 8..at + 8 + name_len]);
+                    if name != "." && name != ".." {
+                        entries.push((name.into_owned(), ino));
+                    }
+                }
+                at += rec_len;
+            }
+        }
+        Ok(entries)
+    }
+}
@@ -1,34 +1,40 @@
 // SPDX-License-Identifier: Apache-2.0
 // Copyright (c) 2026 rhythmcache
 
+use crate::budget::BudgetedReader;
+use crate::cache::CACHE;
+use crate::cancel::CancelToken;
+use crate::engine;
+use crate::follow;
+use crate::http::{HttpSource, Probe};
+use crate::local::{Access, LocalPayload};
+use crate::manifest;
+use crate::onepass::OnePass;
+use crate::prefetch::{PrefetchConfig, PrefetchReader, operation_plan};
+use crate::scheduler::SCHEDULER;
+use crate::sidecar;
+use crate::source::{RangeSource, SharedSource};
+use crate::stats::{self, STATS};
+use crate::stream::{self, Sink};
+use crate::throttle::Throttled;
+use crate::warm::{self, Warmed};
+use crate::zip;
 use anyhow::{Result, anyhow};
-use once_cell::sync::Lazy;
 use payload_dumper_core::constants::{PAYLOAD_MAGIC, ZIP_MAGIC};
-use payload_dumper_core::http::HttpReader;
 use payload_dumper_core::metadata::get_metadata;
-use payload_dumper_core::payload::payload_dumper::{ProgressReporter, dump_partition};
-use payload_dumper_core::payload::payload_parser::{
-    parse_local_payload, parse_local_zip_payload, parse_remote_bin_payload, parse_remote_payload,
-};
-use payload_dumper_core::readers::{
-    local_reader::LocalAsyncPayloadReader, local_zip_reader::LocalAsyncZipPayloadReader,
-    remote_bin_reader::RemoteAsyncBinPayloadReader, remote_zip_reader::RemoteAsyncZipPayloadReader,
+use payload_dumper_core::payload::payload_dumper::{
+    AsyncPayloadRead, ProgressReporter, dump_partition,
 };
+use payload_dumper_core::payload::payload_parser::{parse_local_payload, parse_local_zip_payload};
+use payload_dumper_core::structs::{DeltaArchiveManifest, PartitionUpdate};
 use payload_dumper_core::utils::{format_size, is_diff_operation};
 use std::path::{Path, PathBuf};
-use std::sync::Arc;
-use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::{Arc, Mutex};
+use std::time::Instant;
 use tokio::fs::File;
 use tokio::io::AsyncReadExt;
-use tokio::runtime::Runtime;
 
-pub static RUNTIME: Lazy<Runtime> = Lazy::new(|| {
-    tokio::runtime::Builder::new_multi_thread()
-        .worker_threads(num_cpus::get().max(2))
-        .enable_all()
-        .build()
-        .expect("Failed to create tokio runtime")
-});
+pub use crate::runtime::RUNTIME;
 
 #[derive(Debug, Clone)]
 pub struct ExtractionProgress {
@@ -75,13 +81,16 @@ pub struct PayloadSummary {
     pub is_incremental: bool,
 }
 
-#[derive(Debug, Clone, Copy)]
-enum FileType {
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub(crate) enum FileType {
     Zip,
     Bin,
 }
 
 async fn detect_local_type(path: &Path) -> Result<FileType> {
+    if follow::enabled() {
+        follow::wait_for(path, 4).await?;
+    }
     let mut file = File::open(path).await?;
     let mut magic = [0u8; 4];
     file.read_exact(&mut magic).await?;
@@ -95,30 +104,115 @@ async fn detect_local_type(path: &Path) -> Result<FileType> {
     }
 }
 
-async fn detect_remote_type(url: &str, ua: Option<&str>, ck: Option<&str>) -> Result<FileType> {
-    let reader = HttpReader::new(url.to_string(), ua, ck).await?;
-    let mut magic = [0u8; 4];
-    reader.read_at(0, &mut magic).await?;
+/// offset of payload.bin in a remote file, its manifest and data offset
+///
+/// one suffix request tells a zip from a bare payload.bin and usually holds
+/// the central directory; the header and manifest are then read behind it,
+/// mostly in one more request, and decoded in memory. see http::Probe.
+///
+/// a URL opened in the last few minutes with the same headers is not fetched
+/// again, see warm::cached_manifest()
+async fn open_remote(
+    url: &str,
+    ua: Option<&str>,
+    ck: Option<&str>,
+) -> Result<(u64, DeltaArchiveManifest, u64)> {
+    if let Some(opened) = warm::cached_manifest(url, ua, ck) {
+        return Ok(opened);
+    }
 
-    if magic[0..2] == ZIP_MAGIC {
-        Ok(FileType::Zip)
-    } else if &magic == PAYLOAD_MAGIC {
-        Ok(FileType::Bin)
+    let started = Instant::now();
+    let probe = Probe::open(url, ua, ck).await?;
+    let read = |offset: u64, len: usize| probe.read(offset, len);
+    let base = if probe.is_zip() {
+        zip::locate_payload(probe.file_len(), read).await?.0
     } else {
-        Err(anyhow!("Unsupported file format"))
+        0
+    };
+    let (manifest, data_offset) = manifest::parse(base, read).await?;
+    let opened = (base, manifest, data_offset);
+
+    let us = started.elapsed().as_micros() as u64;
+    stats::set(&STATS.remote_open_us_last, us);
+    stats::set(&STATS.remote_open_requests_last, probe.requests());
+    stats::add(&STATS.remote_opens, 1);
+    warm::remember_manifest(url, ua, ck, &opened);
+    Ok(opened)
+}
+
+/// manifest and data offset of a payload.bin, OTA zip or http(s) URL
+pub(crate) async fn open_manifest(
+    source: &str,
+    ua: Option<&str>,
+    ck: Option<&str>,
+) -> Result<(DeltaArchiveManifest, u64)> {
+    if is_remote(source) {
+        let (_, manifest, data_offset) = open_remote(source, ua, ck).await?;
+        return Ok((manifest, data_offset));
     }
+    let path = Path::new(source);
+    parse_local(path, detect_local_type(path).await?).await
+}
+
+/// manifest and data offset of a local payload.bin or OTA zip
+async fn parse_local(path: &Path, file_type: FileType) -> Result<(DeltaArchiveManifest, u64)> {
+    if follow::enabled() {
+        return follow::parse_manifest(path, file_type).await;
+    }
+    Ok(match file_type {
+        FileType::Bin => parse_local_payload(path).await?,
+        FileType::Zip => parse_local_zip_payload(path.to_path_buf()).await?,
+    })
+}
+
+/// http(s) URLs are remote, anything else is a local path
+pub fn is_remote(source: &str) -> bool {
+    let lower = source.trim_start().to_ascii_lowercase();
+    lower.starts_with("http://") || lower.starts_with("https://")
+}
+
+/// manifest, data offset and a reader of a local payload, for callers that
+/// keep the source open
+pub(crate) async fn open_local_source(
+    path: &Path,
+    access: Access,
+) -> Result<(DeltaArchiveManifest, u64, Arc<dyn RangeSource>)> {
+    let file_type = detect_local_type(path).await?;
+    let (manifest, data_offset) = parse_local(path, file_type).await?;
+    let reader = LocalPayload::open(path, file_type, access).await?;
+    Ok((manifest, data_offset, Arc::new(reader)))
+}
+
+/// a remote reader as every job uses it: ranges warmed by prefetch_source()
+/// come from memory, everything else is paced by the network limits
+fn wrap_remote<R: RangeSource>(url: &str, reader: R) -> Warmed<Throttled<R>> {
+    Warmed::new(url, Throttled::new(reader))
+}
+
+/// manifest, data offset and a reader of a remote payload, for callers that
+/// keep the source open
+pub(crate) async fn open_remote_source(
+    url: &str,
+    ua: Option<&str>,
+    ck: Option<&str>,
+) -> Result<(DeltaArchiveManifest, u64, Arc<dyn RangeSource>)> {
+    let (base, manifest, data_offset) = open_remote(url, ua, ck).await?;
+    let reader = HttpSource::new(url, ua, ck, base);
+    Ok((manifest, data_offset, Arc::new(wrap_remote(url, reader))))
 }
 
 pub struct CallbackProgressReporter {
     callback: Arc<ProgressCallback>,
-    cancelled: Arc<AtomicBool>,
+    cancel: Arc<CancelToken>,
 }
 
 impl CallbackProgressReporter {
-    pub fn new(callback: ProgressCallback) -> Self {
+    /// a callback returning false cancels `cancel`, which stops the extraction
+    /// right away instead of at the next operation
+    pub fn new(callback: ProgressCallback, cancel: Arc<CancelToken>) -> Self {
         Self {
             callback: Arc::new(callback),
-            cancelled: Arc::new(AtomicBool::new(false)),
+            cancel,
         }
     }
 }
@@ -133,7 +227,7 @@ impl ProgressReporter for CallbackProgressReporter {
             status: ExtractionStatus::Started,
         };
         if !(self.callback)(progress) {
-            self.cancelled.store(true, Ordering::SeqCst);
+            self.cancel.cancel();
         }
     }
 
@@ -151,7 +245,7 @@ impl ProgressReporter for CallbackProgressReporter {
             status: ExtractionStatus::InProgress,
         };
         if !(self.callback)(progress) {
-            self.cancelled.store(true, Ordering::SeqCst);
+            self.cancel.cancel();
         }
     }
 
@@ -181,7 +275,7 @@ impl ProgressReporter for CallbackProgressReporter {
     }
 
     fn is_cancelled(&self) -> bool {
-        self.cancelled.load(Ordering::SeqCst)
+        self.cancel.is_cancelled()
     }
 }
 
@@ -193,13 +287,9 @@ pub fn list_local_partitions<P: AsRef<Path>>(path: P) -> Result<String> {
     RUNTIME.block_on(async {
         let file_type = detect_local_type(path.as_ref()).await?;
 
-        let (manifest, data_offset) = match file_type {
-            FileType::Bin => parse_local_payload(path.as_ref()).await?,
-            FileType::Zip => parse_local_zip_payload(path.as_ref().to_path_buf()).await?,
-        };
+        let (manifest, data_offset) = parse_local(path.as_ref(), file_type).await?;
 
-        let metadata = get_metadata(&manifest, data_offset, false, None).await?;
-        build_summary(&manifest, &metadata)
+        summarize(&manifest, data_offset).await
     })
 }
 
@@ -209,15 +299,20 @@ pub fn list_remote_partitions(url: String, ua: Option<&str>, ck: Option<&str>) -
     }
 
     RUNTIME.block_on(async {
-        let file_type = detect_remote_type(&url, ua, ck).await?;
-
-        let (manifest, data_offset, _) = match file_type {
-            FileType::Zip => parse_remote_payload(url, ua, ck).await?,
-            FileType::Bin => parse_remote_bin_payload(url, ua, ck).await?,
-        };
-
-        let metadata = get_metadata(&manifest, data_offset, false, None).await?;
-        build_summary(&manifest, &metadata)
+        let started = Instant::now();
+        let (_, manifest, data_offset) = open_remote(&url, ua, ck).await?;
+        let opened = Instant::now();
+
+        let summary = summarize(&manifest, data_offset).await;
+        stats::set(
+            &STATS.remote_list_us_last,
+            started.elapsed().as_micros() as u64,
+        );
+        stats::set(
+            &STATS.remote_summary_us_last,
+            opened.elapsed().as_micros() as u64,
+        );
+        summary
     })
 }
 
@@ -227,18 +322,17 @@ pub fn extract_local_partition<P1: AsRef<Path>, P2: AsRef<Path>>(
     output_path: P2,
     source_dir: Option<String>,
     callback: Option<ProgressCallback>,
+    cancel: Option<Arc<CancelToken>>,
 ) -> Result<()> {
     if tokio::runtime::Handle::try_current().is_ok() {
         panic!("Cannot be called from async context");
     }
 
-    RUNTIME.block_on(async {
+    let cancel = cancel.unwrap_or_default();
+    let result = RUNTIME.block_on(cancel.run(async {
         let file_type = detect_local_type(path.as_ref()).await?;
 
-        let (manifest, data_offset) = match file_type {
-            FileType::Bin => parse_local_payload(path.as_ref()).await?,
-            FileType::Zip => parse_local_zip_payload(path.as_ref().to_path_buf()).await?,
-        };
+        let (manifest, data_offset) = parse_local(path.as_ref(), file_type).await?;
 
         let partition = find_partition(&manifest, partition_name)?;
         let block_size = manifest.block_size.unwrap_or(4096) as u64;
@@ -247,39 +341,31 @@ pub fn extract_local_partition<P1: AsRef<Path>, P2: AsRef<Path>>(
             tokio::fs::create_dir_all(parent).await?;
         }
 
-        let reporter = create_reporter(callback);
+        let reporter = create_reporter(callback, &cancel);
 
         let source_path = source_dir.map(PathBuf::from);
 
-        match file_type {
-            FileType::Bin => {
-                let reader = LocalAsyncPayloadReader::new(path.as_ref().to_path_buf()).await?;
-                dump_partition(
-                    partition,
-                    data_offset,
-                    block_size,
-                    output_path.as_ref().to_path_buf(),
-                    &reader,
-                    &*reporter,
-                    source_path,
-                )
-                .await
-            }
-            FileType::Zip => {
-                let reader = LocalAsyncZipPayloadReader::new(path.as_ref().to_path_buf()).await?;
-                dump_partition(
-                    partition,
-                    data_offset,
-                    block_size,
-                    output_path.as_ref().to_path_buf(),
-                    &reader,
-                    &*reporter,
-                    source_path,
-                )
-                .await
-            }
+        if restore_cached(partition, output_path.as_ref(), &*reporter).await? {
+            return Ok(());
         }
-    })
+
+        let _disk = SCHEDULER.disk.acquire().await;
+
+        let reader = LocalPayload::open(path.as_ref(), file_type, Access::Sequential).await?;
+        run_dump(
+            partition,
+            data_offset,
+            block_size,
+            output_path.as_ref().to_path_buf(),
+            &reader,
+            &*reporter,
+            source_path,
+            &cancel,
+        )
+        .await
+    }));
+
+    settle(&cancel, output_path.as_ref(), result)
 }
 
 pub fn extract_remote_partition<P: AsRef<Path>>(
@@ -290,18 +376,15 @@ pub fn extract_remote_partition<P: AsRef<Path>>(
     ck: Option<&str>,
     source_dir: Option<String>,
     callback: Option<ProgressCallback>,
+    cancel: Option<Arc<CancelToken>>,
 ) -> Result<()> {
     if tokio::runtime::Handle::try_current().is_ok() {
         panic!("Cannot be called from async context");
     }
 
-    RUNTIME.block_on(async {
-        let file_type = detect_remote_type(&url, ua, ck).await?;
-
-        let (manifest, data_offset, _) = match file_type {
-            FileType::Zip => parse_remote_payload(url.clone(), ua, ck).await?,
-            FileType::Bin => parse_remote_bin_payload(url.clone(), ua, ck).await?,
-        };
+    let cancel = cancel.unwrap_or_default();
+    let result = RUNTIME.block_on(cancel.run(async {
+        let (base, manifest, data_offset) = open_remote(&url, ua, ck).await?;
 
         let partition = find_partition(&manifest, partition_name)?;
         let block_size = manifest.block_size.unwrap_or(4096) as u64;
@@ -310,48 +393,493 @@ pub fn extract_remote_partition<P: AsRef<Path>>(
             tokio::fs::create_dir_all(parent).await?;
         }
 
-        let reporter = create_reporter(callback);
+        let reporter = create_reporter(callback, &cancel);
 
         let source_path = source_dir.map(PathBuf::from);
 
-        match file_type {
-            FileType::Zip => {
-                let reader = RemoteAsyncZipPayloadReader::new(url, ua, ck).await?;
-                dump_partition(
-                    partition,
-                    data_offset,
-                    block_size,
-                    output_path.as_ref().to_path_buf(),
-                    &reader,
-                    &*reporter,
-                    source_path,
-                )
-                .await
-            }
-            FileType::Bin => {
-                let reader = RemoteAsyncBinPayloadReader::new(url, ua, ck).await?;
-                dump_partition(
-                    partition,
-                    data_offset,
-                    block_size,
-                    output_path.as_ref().to_path_buf(),
-                    &reader,
-                    &*reporter,
-                    source_path,
-                )
-                .await
+        if restore_cached(partition, output_path.as_ref(), &*reporter).await? {
+            return Ok(());
+        }
+
+        let _network = SCHEDULER.network.acquire().await;
+        let _disk = SCHEDULER.disk.acquire().await;
+
+        let reader = PrefetchReader::new(
+            wrap_remote(&url, HttpSource::new(&url, ua, ck, base)),
+            partition,
+            data_offset,
+        );
+        run_dump(
+            partition,
+            data_offset,
+            block_size,
+            output_path.as_ref().to_path_buf(),
+            &reader,
+            &*reporter,
+            source_path,
+            &cancel,
+        )
+        .await
+    }));
+
+    settle(&cancel, output_path.as_ref(), result)
+}
+
+/// extract a full partition from a local file into `sink` instead of a file
+///
+/// the image is written strictly front to back and hashed on the way; see
+/// stream::stream_partition. nothing is written to disk.
+pub fn extract_local_partition_to_sink<P: AsRef<Path>>(
+    path: P,
+    partition_name: &str,
+    sink: Sink,
+    callback: Option<ProgressCallback>,
+    cancel: Option<Arc<CancelToken>>,
+) -> Result<()> {
+    if tokio::runtime::Handle::try_current().is_ok() {
+        panic!("Cannot be called from async context");
+    }
+
+    let cancel = cancel.unwrap_or_default();
+    let result = RUNTIME.block_on(cancel.run(async {
+        let file_type = detect_local_type(path.as_ref()).await?;
+
+        let (manifest, data_offset) = parse_local(path.as_ref(), file_type).await?;
+
+        let partition = find_partition(&manifest, partition_name)?;
+        let block_size = manifest.block_size.unwrap_or(4096) as u64;
+        let reporter = create_reporter(callback, &cancel);
+
+        let _disk = SCHEDULER.disk.acquire().await;
+
+        let reader = LocalPayload::open(path.as_ref(), file_type, Access::Sequential).await?;
+        stream::stream_partition(
+            partition,
+            data_offset,
+            block_size,
+            sink,
+            &reader,
+            &*reporter,
+            &cancel,
+        )
+        .await
+    }));
+
+    settle_stream(&cancel, result)
+}
+
+/// extract a full partition from a remote file into `sink` instead of a file
+///
+/// see extract_local_partition_to_sink()
+pub fn extract_remote_partition_to_sink(
+    url: String,
+    partition_name: &str,
+    sink: Sink,
+    ua: Option<&str>,
+    ck: Option<&str>,
+    callback: Option<ProgressCallback>,
+    cancel: Option<Arc<CancelToken>>,
+) -> Result<()> {
+    if tokio::runtime::Handle::try_current().is_ok() {
+        panic!("Cannot be called from async context");
+    }
+
+    let cancel = cancel.unwrap_or_default();
+    let result = RUNTIME.block_on(cancel.run(async {
+        let (base, manifest, data_offset) = open_remote(&url, ua, ck).await?;
+
+        let partition = find_partition(&manifest, partition_name)?;
+        let block_size = manifest.block_size.unwrap_or(4096) as u64;
+        let reporter = create_reporter(callback, &cancel);
+        let plan = stream::read_plan(partition, data_offset);
+
+        let _network = SCHEDULER.network.acquire().await;
+
+        let reader = PrefetchReader::with_plan(
+            Arc::new(wrap_remote(&url, HttpSource::new(&url, ua, ck, base))),
+            plan,
+            PrefetchConfig::configured(),
+        );
+        stream::stream_partition(
+            partition,
+            data_offset,
+            block_size,
+            sink,
+            &reader,
+            &*reporter,
+            &cancel,
+        )
+        .await
+    }));
+
+    settle_stream(&cancel, result)
+}
+
+/// output path of a partition extracted by the one-pass functions
+pub fn partition_output_path(output_dir: &Path, partition_name: &str) -> PathBuf {
+    output_dir.join(format!("{}.img", partition_name))
+}
+
+/// extract several partitions of a local file in a single sequential pass
+///
+/// every partition is written to `<output_dir>/<name>.img`. full partitions
+/// share one forward scan of the payload; differential ones follow it, one
+/// at a time. the progress callback receives each partition by name.
+pub fn extract_local_partitions<P1: AsRef<Path>, P2: AsRef<Path>>(
+    path: P1,
+    partition_names: &[&str],
+    output_dir: P2,
+    source_dir: Option<String>,
+    callback: Option<ProgressCallback>,
+    cancel: Option<Arc<CancelToken>>,
+) -> Result<()> {
+    if tokio::runtime::Handle::try_current().is_ok() {
+        panic!("Cannot be called from async context");
+    }
+
+    let cancel = cancel.unwrap_or_default();
+    let done = Mutex::new(Vec::new());
+    let result = RUNTIME.block_on(cancel.run(async {
+        let file_type = detect_local_type(path.as_ref()).await?;
+
+        let (manifest, data_offset) = parse_local(path.as_ref(), file_type).await?;
+
+        tokio::fs::create_dir_all(output_dir.as_ref()).await?;
+        let reporter = create_reporter(callback, &cancel);
+        let job = ManyJob {
+            targets: find_targets(&manifest, partition_names, output_dir.as_ref())?,
+            data_offset,
+            block_size: manifest.block_size.unwrap_or(4096) as u64,
+            reporter: &*reporter,
+            source_path: source_dir.map(PathBuf::from),
+            cancel: &cancel,
+            done: &done,
+        };
+
+        let _disk = SCHEDULER.disk.acquire().await;
+
+        let reader = LocalPayload::open(path.as_ref(), file_type, Access::Sequential).await?;
+        extract_many(reader, false, &job).await
+    }));
+
+    settle_many(&cancel, partition_names, output_dir.as_ref(), &done, result)
+}
+
+/// extract several partitions of a remote file in a single sequential pass
+///
+/// see extract_local_partitions(); the pass is fetched as a few large ranged
+/// requests with read-ahead instead of one request per operation
+pub fn extract_remote_partitions<P: AsRef<Path>>(
+    url: String,
+    partition_names: &[&str],
+    output_dir: P,
+    ua: Option<&str>,
+    ck: Option<&str>,
+    source_dir: Option<String>,
+    callback: Option<ProgressCallback>,
+    cancel: Option<Arc<CancelToken>>,
+) -> Result<()> {
+    if tokio::runtime::Handle::try_current().is_ok() {
+        panic!("Cannot be called from async context");
+    }
+
+    let cancel = cancel.unwrap_or_default();
+    let done = Mutex::new(Vec::new());
+    let result = RUNTIME.block_on(cancel.run(async {
+        let (base, manifest, data_offset) = open_remote(&url, ua, ck).await?;
+
+        tokio::fs::create_dir_all(output_dir.as_ref()).await?;
+        let reporter = create_reporter(callback, &cancel);
+        let job = ManyJob {
+            targets: find_targets(&manifest, partition_names, output_dir.as_ref())?,
+            data_offset,
+            block_size: manifest.block_size.unwrap_or(4096) as u64,
+            reporter: &*reporter,
+            source_path: source_dir.map(PathBuf::from),
+            cancel: &cancel,
+            done: &done,
+        };
+
+        let _network = SCHEDULER.network.acquire().await;
+        let _disk = SCHEDULER.disk.acquire().await;
+
+        let reader = HttpSource::new(&url, ua, ck, base);
+        extract_many(wrap_remote(&url, reader), true, &job).await
+    }));
+
+    settle_many(&cancel, partition_names, output_dir.as_ref(), &done, result)
+}
+
+struct ManyJob<'a> {
+    targets: Vec<(&'a PartitionUpdate, PathBuf)>,
+    data_offset: u64,
+    block_size: u64,
+    reporter: &'a dyn ProgressReporter,
+    source_path: Option<PathBuf>,
+    cancel: &'a Arc<CancelToken>,
+    /// outputs that are complete, kept when the job is cancelled
+    done: &'a Mutex<Vec<PathBuf>>,
+}
+
+/// cached partitions are restored, full ones share one pass over the payload
+/// and the rest go through run_dump. a failed partition does not stop the
+/// others; all failures are reported together at the end.
+async fn extract_many<R: RangeSource>(inner: R, remote: bool, job: &ManyJob<'_>) -> Result<()> {
+    let inner = Arc::new(inner);
+    let mut streamed = Vec::new();
+    let mut fallback = Vec::new();
+
+    for (partition, output) in &job.targets {
+        if restore_cached(partition, output, job.reporter).await? {
+            job.done.lock().unwrap().push(output.clone());
+        } else if engine::is_supported(partition) {
+            prepare_output(output).await?;
+            streamed.push((*partition, output.clone()));
+        } else {
+            fallback.push((*partition, output.clone()));
+        }
+    }
+
+    let mut errors = Vec::new();
+
+    if !streamed.is_empty() {
+        let pass = OnePass::new(
+            streamed.iter().map(|(p, _)| *p).collect(),
+            job.data_offset,
+            job.block_size,
+        );
+        let outputs: Vec<PathBuf> = streamed.iter().map(|(_, o)| o.clone()).collect();
+
+        let outcomes = if remote {
+            let reader = PrefetchReader::with_plan(
+                Arc::clone(&inner),
+                pass.reads(),
+                PrefetchConfig::configured(),
+            );
+            pass.run(&outputs, job.block_size, &reader, job.reporter, job.cancel)
+                .await?
+        } else {
+            let reader = SharedSource(Arc::clone(&inner));
+            pass.run(&outputs, job.block_size, &reader, job.reporter, job.cancel)
+                .await?
+        };
+
+        for ((partition, output), outcome) in streamed.into_iter().zip(outcomes) {
+            match outcome {
+                Ok(verified) => {
+                    finish_output(partition, output.clone(), verified).await?;
+                    job.done.lock().unwrap().push(output);
+                }
+                Err(e) => errors.push(format!("{}: {}", partition.partition_name, e)),
             }
         }
+    }
+
+    for (partition, output) in fallback {
+        let result = if remote {
+            let reader = PrefetchReader::with_plan(
+                Arc::clone(&inner),
+                operation_plan(partition, job.data_offset),
+                PrefetchConfig::configured(),
+            );
+            run_dump(
+                partition,
+                job.data_offset,
+                job.block_size,
+                output.clone(),
+                &reader,
+                job.reporter,
+                job.source_path.clone(),
+                job.cancel,
+            )
+            .await
+        } else {
+            let reader = SharedSource(Arc::clone(&inner));
+            run_dump(
+                partition,
+                job.data_offset,
+                job.block_size,
+                output.clone(),
+                &reader,
+                job.reporter,
+                job.source_path.clone(),
+                job.cancel,
+            )
+            .await
+        };
+
+        match result {
+            Ok(()) => job.done.lock().unwrap().push(output),
+            Err(e) if job.cancel.is_cancelled() => return Err(e),
+            Err(e) => errors.push(format!("{}: {}", partition.partition_name, e)),
+        }
+    }
+
+    if errors.is_empty() {
+        Ok(())
+    } else {
+        Err(anyhow!(errors.join("; ")))
+    }
+}
+
+fn find_targets<'a>(
+    manifest: &'a payload_dumper_core::structs::DeltaArchiveManifest,
+    partition_names: &[&str],
+    output_dir: &Path,
+) -> Result<Vec<(&'a PartitionUpdate, PathBuf)>> {
+    partition_names
+        .iter()
+        .map(|name| {
+            let partition = find_partition(manifest, name)?;
+            Ok((partition, partition_output_path(output_dir, name)))
+        })
+        .collect()
+}
+
+fn manifest_hash(partition: &payload_dumper_core::structs::PartitionUpdate) -> Option<Vec<u8>> {
+    partition
+        .new_partition_info
+        .as_ref()
+        .and_then(|i| i.hash.clone())
+        .filter(|h| !h.is_empty())
+}
+
+/// clone the image from the output cache when its hash is already stored
+async fn restore_cached(
+    partition: &payload_dumper_core::structs::PartitionUpdate,
+    output_path: &Path,
+    reporter: &dyn ProgressReporter,
+) -> Result<bool> {
+    let Some(hash) = manifest_hash(partition) else {
+        return Ok(false);
+    };
+    if !CACHE.is_enabled() {
+        return Ok(false);
+    }
+
+    let size = partition
+        .new_partition_info
+        .as_ref()
+        .and_then(|i| i.size)
+        .unwrap_or(0);
+    let output = output_path.to_path_buf();
+    let restored = tokio::task::spawn_blocking(move || {
+        sidecar::remove(&output);
+        let restored = CACHE.restore(&hash, size, &output)?;
+        if restored {
+            sidecar::write(&output, &hash)?;
+        }
+        anyhow::Ok(restored)
     })
+    .await??;
+
+    if restored {
+        let name = partition.partition_name.as_str();
+        let total_operations = partition.operations.len() as u64;
+        reporter.on_start(name, total_operations);
+        reporter.on_complete(name, total_operations);
+    }
+    Ok(restored)
 }
 
-fn is_partition_differential(partition: &payload_dumper_core::structs::PartitionUpdate) -> bool {
+/// full partitions are decoded in-tree, everything else by payload_dumper_core
+async fn run_dump<R: AsyncPayloadRead>(
+    partition: &payload_dumper_core::structs::PartitionUpdate,
+    data_offset: u64,
+    block_size: u64,
+    output_path: PathBuf,
+    reader: &R,
+    reporter: &dyn ProgressReporter,
+    source_path: Option<PathBuf>,
+    cancel: &Arc<CancelToken>,
+) -> Result<()> {
+    prepare_output(&output_path).await?;
+
+    let verified = if engine::is_supported(partition) {
+        engine::extract_partition(
+            partition,
+            data_offset,
+            block_size,
+            &output_path,
+            reader,
+            reporter,
+            cancel,
+        )
+        .await?
+    } else {
+        let reader = BudgetedReader::new(reader, partition, data_offset, block_size);
+        dump_partition(
+            partition,
+            data_offset,
+            block_size,
+            output_path.clone(),
+            &reader,
+            reporter,
+            source_path,
+        )
+        .await?;
+        false
+    };
+
+    finish_output(partition, output_path, verified).await
+}
+
+/// start from no image at all: removing the old one drops its sidecar, which
+/// would vouch for data about to be overwritten, and any extents it shares
+/// with a reflinked copy in the output cache
+async fn prepare_output(output_path: &Path) -> Result<()> {
+    match tokio::fs::remove_file(output_path).await {
+        Err(e) if e.kind() != std::io::ErrorKind::NotFound => return Err(e.into()),
+        _ => {}
+    }
+    sidecar::remove(output_path);
+    Ok(())
+}
+
+/// record a verified image and offer it to the output cache
+async fn finish_output(
+    partition: &PartitionUpdate,
+    output_path: PathBuf,
+    verified: bool,
+) -> Result<()> {
+    let Some(hash) = manifest_hash(partition) else {
+        return Ok(());
+    };
+
+    // an image the cache had to hash itself gets the sidecar too, instead of
+    // being hashed again by whoever verifies it next
+    let verified = if CACHE.is_enabled() {
+        let (image, expected) = (output_path.clone(), hash.clone());
+        // best effort, a full or unwritable store must not fail the extraction
+        match tokio::task::spawn_blocking(move || CACHE.insert(&expected, &image, verified)).await {
+            Ok(Ok(matched)) => matched,
+            _ => verified,
+        }
+    } else {
+        verified
+    };
+
+    if verified {
+        sidecar::write(&output_path, &hash)?;
+    }
+    Ok(())
+}
+
+pub(crate) fn is_partition_differential(
+    partition: &payload_dumper_core::structs::PartitionUpdate,
+) -> bool {
     partition
         .operations
         .iter()
         .any(|op| is_diff_operation(op.r#type()))
 }
 
+/// the partition list JSON of a parsed manifest
+pub(crate) async fn summarize(manifest: &DeltaArchiveManifest, data_offset: u64) -> Result<String> {
+    let metadata = get_metadata(manifest, data_offset, false, None).await?;
+    build_summary(manifest, &metadata)
+}
+
 fn build_summary(
     manifest: &payload_dumper_core::structs::DeltaArchiveManifest,
     metadata: &payload_dumper_core::structs::PayloadMetadata,
@@ -395,7 +923,7 @@ fn build_summary(
     serde_json::to_string_pretty(&summary).map_err(|e| anyhow!("Serialization failed: {}", e))
 }
 
-fn find_partition<'a>(
+pub(crate) fn find_partition<'a>(
     manifest: &'a payload_dumper_core::structs::DeltaArchiveManifest,
     partition_name: &str,
 ) -> Result<&'a payload_dumper_core::structs::PartitionUpdate> {
@@ -406,10 +934,52 @@ fn find_partition<'a>(
         .ok_or_else(|| anyhow!("Partition '{}' not found", partition_name))
 }
 
-fn create_reporter(callback: Option<ProgressCallback>) -> Box<dyn ProgressReporter> {
-    if let Some(cb) = callback {
-        Box::new(CallbackProgressReporter::new(cb))
-    } else {
-        Box::new(payload_dumper_core::payload::payload_dumper::NoOpReporter)
+fn create_reporter(
+    callback: Option<ProgressCallback>,
+    cancel: &Arc<CancelToken>,
+) -> Box<dyn ProgressReporter> {
+    let callback = callback.unwrap_or_else(|| Box::new(|_| true));
+    Box::new(CallbackProgressReporter::new(callback, Arc::clone(cancel)))
+}
+
+/// a cancelled pass deletes every image that was not complete yet
+fn settle_many(
+    cancel: &CancelToken,
+    partition_names: &[&str],
+    output_dir: &Path,
+    done: &Mutex<Vec<PathBuf>>,
+    result: Result<()>,
+) -> Result<()> {
+    if result.is_err() && cancel.is_cancelled() {
+        let done = done.lock().unwrap();
+        for name in partition_names {
+            let output = partition_output_path(output_dir, name);
+            if !done.contains(&output) {
+                let _ = std::fs::remove_file(&output);
+                sidecar::remove(&output);
+            }
+        }
+        cancel.record_stopped();
+        return Err(anyhow!("Extraction cancelled"));
+    }
+    result
+}
+
+fn settle_stream(cancel: &CancelToken, result: Result<bool>) -> Result<()> {
+    if result.is_err() && cancel.is_cancelled() {
+        cancel.record_stopped();
+        return Err(anyhow!("Extraction cancelled"));
+    }
+    result.map(|_| ())
+}
+
+/// a cancelled extraction leaves no partial image behind
+fn settle(cancel: &CancelToken, output_path: &Path, result: Result<()>) -> Result<()> {
+    if result.is_err() && cancel.is_cancelled() {
+        let _ = std::fs::remove_file(output_path);
+        sidecar::remove(output_path);
+        cancel.record_stopped();
+        return Err(anyhow!("Extraction cancelled"));
     }
+    result
 }
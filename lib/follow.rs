@@ -0,0 +1,239 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use crate::engine::read_at;
+use crate::extractor::FileType;
+use crate::manifest;
+use crate::stats::{self, STATS};
+use crate::zip;
+use anyhow::{Result, anyhow};
+use payload_dumper_core::structs::DeltaArchiveManifest;
+use std::fs::File;
+use std::io;
+use std::path::Path;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::time::{Duration, Instant};
+
+/// a growing file is checked again after POLL_MIN while it keeps growing;
+/// the wait doubles up to POLL_MAX while it does not
+const POLL_MIN: Duration = Duration::from_millis(10);
+const POLL_MAX: Duration = Duration::from_millis(500);
+
+/// stall timeout in milliseconds, 0 while follow mode is off
+static STALL_MS: AtomicU64 = AtomicU64::new(0);
+
+/// read local payloads opened afterwards as files that may still be
+/// downloading, Duration::ZERO turns it off
+///
+/// a read past the current end of the file waits for the data instead of
+/// failing, so the manifest can be listed and partitions whose data has
+/// arrived extracted while the rest is still coming in. a download that has
+/// not grown for `stall` fails the reads waiting on it. the downloader has to
+/// append to the file in order; one that preallocates the whole file or
+/// writes pieces out of order cannot be followed.
+pub fn set_follow(stall: Duration) {
+    STALL_MS.store(stall.as_millis() as u64, Ordering::Relaxed);
+}
+
+pub(crate) fn enabled() -> bool {
+    STALL_MS.load(Ordering::Relaxed) != 0
+}
+
+fn stall() -> Duration {
+    Duration::from_millis(STALL_MS.load(Ordering::Relaxed))
+}
+
+/// a local file that may still be growing
+pub(crate) struct Growing {
+    /// bytes known to be in the file
+    arrived: AtomicU64,
+    /// size at which everything needed has arrived, u64::MAX while unknown
+    complete_at: AtomicU64,
+}
+
+impl Growing {
+    pub(crate) fn new(file: &File) -> io::Result<Self> {
+        Ok(Self {
+            arrived: AtomicU64::new(file.metadata()?.len()),
+            complete_at: AtomicU64::new(u64::MAX),
+        })
+    }
+
+    pub(crate) fn arrived(&self) -> u64 {
+        self.arrived.load(Ordering::Relaxed)
+    }
+
+    /// nothing past `len` is ever read; a read past it fails right away
+    /// instead of waiting for a stall
+    pub(crate) fn complete_at(&self, len: u64) {
+        self.complete_at.store(len, Ordering::Relaxed);
+    }
+
+    /// wait until `file` holds at least `end` bytes
+    pub(crate) async fn wait(&self, file: &File, end: u64) -> Result<()> {
+        if end <= self.arrived() {
+            return Ok(());
+        }
+        stats::add(&STATS.follow_waits, 1);
+        let started = Instant::now();
+        let mut grew = started;
+        let mut poll = POLL_MIN;
+        let result = loop {
+            let len = file.metadata()?.len();
+            if len > self.arrived.fetch_max(len, Ordering::Relaxed) {
+                grew = Instant::now();
+                poll = POLL_MIN;
+            } else {
+                poll = (poll * 2).min(POLL_MAX);
+            }
+            if len >= end {
+                break Ok(());
+            }
+            if end > self.complete_at.load(Ordering::Relaxed) {
+                break Err(anyhow!(
+                    "Read past the end of the payload: {} bytes wanted, {} in the file",
+                    end,
+                    len
+                ));
+            }
+            if grew.elapsed() >= stall() {
+                stats::add(&STATS.follow_stalls, 1);
+                break Err(anyhow!(
+                    "Download stalled at {} bytes, nothing arrived for {:?}",
+                    len,
+                    stall()
+                ));
+            }
+            tokio::time::sleep(poll).await;
+        };
+        stats::add(&STATS.follow_wait_us, started.elapsed().as_micros() as u64);
+        result
+    }
+}
+
+/// wait until the file at `path` holds at least `len` bytes
+pub(crate) async fn wait_for(path: &Path, len: u64) -> Result<()> {
+    let file = File::open(path)?;
+    Growing::new(&file)?.wait(&file, len).await
+}
+
+/// manifest and data offset of a payload that may still be downloading
+///
+/// waits for the header and manifest of payload.bin and decodes the manifest
+/// in memory; a zip is searched from the front because its central directory
+/// only comes last.
+pub(crate) async fn parse_manifest(
+    path: &Path,
+    file_type: FileType,
+) -> Result<(DeltaArchiveManifest, u64)> {
+    let file = File::open(path)?;
+    let growing = Growing::new(&file)?;
+    let read = |offset: u64, len: usize| {
+        let (file, growing) = (&file, &growing);
+        async move {
+            growing.wait(file, offset + len as u64).await?;
+            let mut buf = vec![0u8; len];
+            read_at(file, &mut buf, offset)?;
+            Ok::<_, anyhow::Error>(buf)
+        }
+    };
+
+    let base = match file_type {
+        FileType::Bin => 0,
+        FileType::Zip => zip::locate_payload_forward(read).await?.0,
+    };
+    manifest::parse(base, read).await
+}
+
+#[cfg(test)]
+mod tests {
+    use super::set_follow;
+    use crate::extractor::extract_local_partition;
+    use payload_dumper_core::structs::install_operation::Type;
+    use payload_dumper_core::structs::{
+        DeltaArchiveManifest, Extent, InstallOperation, PartitionInfo, PartitionUpdate,
+    };
+    use prost::Message;
+    use sha2::{Digest, Sha256};
+    use std::io::Write;
+    use std::time::Duration;
+
+    const BLOCK: usize = 4096;
+
+    /// a version 2 payload.bin with one partition of `image`, stored in
+    /// REPLACE operations of four blocks each
+    fn build_payload(image: &[u8]) -> Vec<u8> {
+        let operations = image
+            .chunks(4 * BLOCK)
+            .enumerate()
+            .map(|(i, chunk)| {
+                let mut op = InstallOperation {
+                    data_offset: Some((i * 4 * BLOCK) as u64),
+                    data_length: Some(chunk.len() as u64),
+                    dst_extents: vec![Extent {
+                        start_block: Some(i as u64 * 4),
+                        num_blocks: Some((chunk.len() / BLOCK) as u64),
+                    }],
+                    ..Default::default()
+                };
+                op.set_type(Type::Replace);
+                op
+            })
+            .collect();
+        let manifest = DeltaArchiveManifest {
+            block_size: Some(BLOCK as u32),
+            partitions: vec![PartitionUpdate {
+                partition_name: "system".to_string(),
+                new_partition_info: Some(PartitionInfo {
+                    size: Some(image.len() as u64),
+                    hash: Some(Sha256::digest(image).to_vec()),
+                }),
+                operations,
+                ..Default::default()
+            }],
+            ..Default::default()
+        }
+        .encode_to_vec();
+
+        let mut payload = b"CrAU".to_vec();
+        payload.extend_from_slice(&2u64.to_be_bytes());
+        payload.extend_from_slice(&(manifest.len() as u64).to_be_bytes());
+        payload.extend_from_slice(&0u32.to_be_bytes());
+        payload.extend_from_slice(&manifest);
+        payload.extend_from_slice(image);
+        payload
+    }
+
+    #[test]
+    fn extracts_a_payload_while_it_is_appended() {
+        let image: Vec<u8> = (0..64 * BLOCK).map(|i| (i * 7 % 251) as u8).collect();
+        let payload = build_payload(&image);
+        let dir = std::env::temp_dir().join(format!("payload-follow-test-{}", std::process::id()));
+        std::fs::create_dir_all(&dir).unwrap();
+        let source = dir.join("payload.bin");
+        let output = dir.join("system.img");
+
+        // the extraction starts with only the magic and version in the
+        // file; header, manifest and data all arrive while it is waiting
+        let mut file = std::fs::File::create(&source).unwrap();
+        file.write_all(&payload[..12]).unwrap();
+        set_follow(Duration::from_secs(10));
+        let writer = std::thread::spawn({
+            let payload = payload.clone();
+            move || {
+                for chunk in payload[12..].chunks(10_000) {
+                    std::thread::sleep(Duration::from_millis(5));
+                    file.write_all(chunk).unwrap();
+                    file.flush().unwrap();
+                }
+            }
+        });
+
+        let result = extract_local_partition(&source, "system", &output, None, None, None);
+        writer.join().unwrap();
+        set_follow(Duration::ZERO);
+        result.unwrap();
+        assert!(std::fs::read(&output).unwrap() == image);
+        std::fs::remove_dir_all(&dir).unwrap();
+    }
+}
@@ -0,0 +1,262 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use crate::erofs::Erofs;
+use crate::ext4::Ext4;
+use crate::image::VirtualImage;
+use crate::stats::{self, STATS};
+use anyhow::{Result, anyhow};
+use std::fs::File;
+use std::io::{BufWriter, Write};
+use std::path::Path;
+use std::sync::Arc;
+
+/// reads larger than this are split so a big file never sits in memory whole
+const COPY_CHUNK: u64 = 1024 * 1024;
+
+const S_IFMT: u16 = 0o170000;
+const S_IFDIR: u16 = 0o040000;
+const S_IFREG: u16 = 0o100000;
+const S_IFLNK: u16 = 0o120000;
+
+/// an inode as stored in the image; the format-specific parts are parsed
+/// again from `raw` when its data is needed
+pub(crate) struct Inode {
+    pub id: u64,
+    pub mode: u16,
+    pub size: u64,
+    /// byte offset of the on-disk inode in the image
+    pub offset: u64,
+    pub raw: Vec<u8>,
+}
+
+impl Inode {
+    pub fn is_dir(&self) -> bool {
+        self.mode & S_IFMT == S_IFDIR
+    }
+}
+
+/// `len` bytes of a file starting at `file_offset`, stored at `source` in the
+/// image; None reads as zeros. ranges no segment covers are holes.
+pub(crate) struct Segment {
+    pub file_offset: u64,
+    pub len: u64,
+    pub source: Option<u64>,
+}
+
+/// one filesystem layout
+pub(crate) trait Format: Send + Sync {
+    fn name(&self) -> &'static str;
+    fn root(&self) -> u64;
+    fn inode(&self, image: &VirtualImage, id: u64) -> Result<Inode>;
+    /// where the data of `inode` lives, sorted by file offset
+    fn segments(&self, image: &VirtualImage, inode: &Inode) -> Result<Vec<Segment>>;
+    /// (name, inode) of every entry of a directory, "." and ".." excluded
+    fn dir_entries(&self, data: &[u8]) -> Result<Vec<(String, u64)>>;
+}
+
+/// exactly `len` bytes of the image at `offset`
+pub(crate) fn read_exact(image: &VirtualImage, offset: u64, len: usize) -> Result<Vec<u8>> {
+    let mut buf = vec![0u8; len];
+    let n = image.read_at(offset, &mut buf)?;
+    if n < len {
+        return Err(anyhow!("Filesystem reaches past the end of the image"));
+    }
+    Ok(buf)
+}
+
+pub(crate) fn le16(buf: &[u8], at: usize) -> u16 {
+    u16::from_le_bytes([buf[at], buf[at + 1]])
+}
+
+pub(crate) fn le32(buf: &[u8], at: usize) -> u32 {
+    u32::from_le_bytes(buf[at..at + 4].try_into().unwrap())
+}
+
+pub(crate) fn le64(buf: &[u8], at: usize) -> u64 {
+    u64::from_le_bytes(buf[at..at + 8].try_into().unwrap())
+}
+
+/// one entry of a directory listing
+#[derive(Debug, Clone, serde::Serialize)]
+pub struct Entry {
+    pub name: String,
+    /// "file", "dir", "symlink" or "other"
+    #[serde(rename = "type")]
+    pub kind: &'static str,
+    pub size: u64,
+    /// permission bits
+    pub mode: u16,
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub target: Option<String>,
+}
+
+#[derive(Debug, Clone, serde::Serialize)]
+pub struct Listing {
+    pub filesystem: &'static str,
+    pub path: String,
+    pub entries: Vec<Entry>,
+}
+
+/// an EROFS or ext4 filesystem inside a partition, read in place
+///
+/// every lookup goes through VirtualImage, so browsing a directory or
+/// extracting one file decodes only the payload operations that hold its
+/// metadata and data blocks, never the whole partition
+pub struct FileSystem {
+    image: Arc<VirtualImage>,
+    format: Box<dyn Format>,
+}
+
+impl FileSystem {
+    /// detect the filesystem of `image`; fails for anything but EROFS and ext4
+    pub fn open(image: Arc<VirtualImage>) -> Result<Self> {
+        let format: Box<dyn Format> = if let Some(erofs) = Erofs::probe(&image)? {
+            Box::new(erofs)
+        } else if let Some(ext4) = Ext4::probe(&image)? {
+            Box::new(ext4)
+        } else {
+            return Err(anyhow!("Partition holds no EROFS or ext4 filesystem"));
+        };
+        Ok(Self { image, format })
+    }
+
+    /// "erofs" or "ext4"
+    pub fn kind(&self) -> &'static str {
+        self.format.name()
+    }
+
+    /// entries of the directory at `path`, sorted with directories first
+    pub fn list(&self, path: &str) -> Result<Listing> {
+        let dir = self.resolve(path)?;
+        if !dir.is_dir() {
+            return Err(anyhow!("{} is not a directory", path));
+        }
+        stats::add(&STATS.fs_dirs_listed, 1);
+
+        let data = self.read_all(&dir)?;
+        let mut entries = Vec::new();
+        for (name, id) in self.format.dir_entries(&data)? {
+            let inode = self.format.inode(&self.image, id)?;
+            let kind = match inode.mode & S_IFMT {
+                S_IFDIR => "dir",
+                S_IFREG => "file",
+                S_IFLNK => "symlink",
+                _ => "other",
+            };
+            let target = if kind == "symlink" {
+                Some(String::from_utf8_lossy(&self.read_all(&inode)?).into_owned())
+            } else {
+                None
+            };
+            entries.push(Entry {
+                name,
+                kind,
+                size: inode.size,
+                mode: inode.mode & 0o7777,
+                target,
+            });
+        }
+        entries.sort_by(|a, b| {
+            (b.kind == "dir")
+                .cmp(&(a.kind == "dir"))
+                .then(a.name.cmp(&b.name))
+        });
+
+        Ok(Listing {
+            filesystem: self.kind(),
+            path: normalize(path),
+            entries,
+        })
+    }
+
+    /// copy the regular file at `path` to `output`; returns its size
+    pub fn extract(&self, path: &str, output: &Path) -> Result<u64> {
+        let inode = self.resolve(path)?;
+        if inode.mode & S_IFMT != S_IFREG {
+            return Err(anyhow!("{} is not a regular file", path));
+        }
+        let mut out = BufWriter::new(File::create(output)?);
+        self.copy(&inode, &mut out)?;
+        out.flush()?;
+        stats::add(&STATS.fs_files_extracted, 1);
+        Ok(inode.size)
+    }
+
+    /// the inode at `path`, without following symlinks
+    fn resolve(&self, path: &str) -> Result<Inode> {
+        let mut inode = self.format.inode(&self.image, self.format.root())?;
+        for component in normalize(path).split('/').filter(|c| !c.is_empty()) {
+            if !inode.is_dir() {
+                return Err(anyhow!("{} is not a directory", path));
+            }
+            let data = self.read_all(&inode)?;
+            let (_, id) = self
+                .format
+                .dir_entries(&data)?
+                .into_iter()
+                .find(|(name, _)| name == component)
+                .ok_or_else(|| anyhow!("{} not found", path))?;
+            inode = self.format.inode(&self.image, id)?;
+        }
+        Ok(inode)
+    }
+
+    /// whole contents of a small inode such as a directory or symlink
+    fn read_all(&self, inode: &Inode) -> Result<Vec<u8>> {
+        let mut data = Vec::with_capacity(inode.size as usize);
+        self.copy(inode, &mut data)?;
+        Ok(data)
+    }
+
+    fn copy(&self, inode: &Inode, out: &mut dyn Write) -> Result<()> {
+        static ZEROS: [u8; 64 * 1024] = [0; 64 * 1024];
+        let zeros = |out: &mut dyn Write, mut count: u64| -> Result<()> {
+            while count > 0 {
+                let n = count.min(ZEROS.len() as u64) as usize;
+                out.write_all(&ZEROS[..n])?;
+                count -= n as u64;
+            }
+            Ok(())
+        };
+
+        let mut position = 0u64;
+        for segment in self.format.segments(&self.image, inode)? {
+            let start = segment.file_offset.max(position);
+            let end = (segment.file_offset + segment.len).min(inode.size);
+            if start >= end {
+                continue;
+            }
+            zeros(out, start - position)?;
+            match segment.source {
+                None => zeros(out, end - start)?,
+                Some(source) => {
+                    let mut at = start;
+                    while at < end {
+                        let n = (end - at).min(COPY_CHUNK) as usize;
+                        let offset = source + (at - segment.file_offset);
+                        out.write_all(&read_exact(&self.image, offset, n)?)?;
+                        at += n as u64;
+                    }
+                }
+            }
+            position = end;
+        }
+        zeros(out, inode.size.saturating_sub(position))
+    }
+}
+
+/// `path` as an absolute path without "." and ".." components
+fn normalize(path: &str) -> String {
+    let mut parts: Vec<&str> = Vec::new();
+    for component in path.split('/') {
+        match component {
+            "" | "." => {}
+            ".." => {
+                parts.pop();
+            }
+            c => parts.push(c),
+        }
+    }
+    format!("/{}", parts.join("/"))
+}
@@ -0,0 +1,537 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use crate::scheduler::{Limiter, OwnedSlot};
+use crate::source::{FetchFuture, RangeSource};
+use crate::stats::{self, STATS};
+use crate::zip;
+use anyhow::{Result, anyhow};
+use once_cell::sync::Lazy;
+use reqwest::header::{CONTENT_RANGE, COOKIE, RANGE, USER_AGENT};
+use reqwest::{Client, StatusCode, Url, Version};
+use std::collections::HashMap;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Mutex, RwLock};
+use std::time::{Duration, Instant};
+
+/// idle connections kept per host unless configured otherwise
+const DEFAULT_IDLE_PER_HOST: u64 = 8;
+
+/// how long an idle connection is kept; CDNs close theirs after a minute or
+/// two, keeping one longer only finds it dead
+const IDLE_TIMEOUT: Duration = Duration::from_secs(90);
+
+/// longest wait for the next bytes of a response; a CDN that stops sending
+/// in the middle of a body fails the request instead of hanging the job
+const READ_TIMEOUT: Duration = Duration::from_secs(30);
+
+/// attempts of a request that fails to connect, gets a 5xx or stalls
+const ATTEMPTS: u32 = 3;
+const RETRY_DELAY: Duration = Duration::from_millis(250);
+
+/// smallest read issued while opening a remote payload, see Probe; most
+/// manifests fit
+const PROBE_WINDOW: u64 = 256 * 1024;
+
+/// process-wide HTTP client shared by every remote source
+///
+/// connections are pooled per origin and kept alive between requests, so
+/// listing a payload, extracting its partitions one job after another and
+/// probing it again all reuse the same TCP and TLS sessions. servers that
+/// speak HTTP/2 get every concurrent range request of every job multiplexed
+/// over one connection. requests to one origin can be capped; the cap is
+/// shared by all jobs.
+pub static HTTP: Lazy<HttpPool> = Lazy::new(HttpPool::new);
+
+pub struct HttpPool {
+    client: RwLock<Client>,
+    idle_per_host: AtomicU64,
+    /// one limiter per origin with requests in flight, dropped once the
+    /// last of them has finished
+    hosts: Mutex<HashMap<String, Arc<Limiter>>>,
+    requests_per_host: AtomicU64,
+}
+
+impl HttpPool {
+    fn new() -> Self {
+        Self {
+            client: RwLock::new(
+                build_client(DEFAULT_IDLE_PER_HOST).expect("Failed to create HTTP client"),
+            ),
+            idle_per_host: AtomicU64::new(DEFAULT_IDLE_PER_HOST),
+            hosts: Mutex::new(HashMap::new()),
+            requests_per_host: AtomicU64::new(0),
+        }
+    }
+
+    /// cap concurrent requests per origin (0 = unlimited) and set the idle
+    /// connections kept per origin (0 = 8)
+    ///
+    /// the cap applies at once. changing the idle setting starts a new pool,
+    /// so connections already open are not reused by later requests; calling
+    /// this again with the same setting keeps them.
+    pub fn configure(&self, requests_per_host: u64, idle_per_host: u64) -> Result<()> {
+        let idle = match idle_per_host {
+            0 => DEFAULT_IDLE_PER_HOST,
+            n => n,
+        };
+        if self.idle_per_host.load(Ordering::Relaxed) != idle {
+            let mut client = self.client.write().unwrap();
+            *client = build_client(idle)?;
+            self.idle_per_host.store(idle, Ordering::Relaxed);
+        }
+        self.requests_per_host
+            .store(requests_per_host, Ordering::Relaxed);
+        for limiter in self.hosts.lock().unwrap().values() {
+            limiter.set_limit(requests_per_host);
+        }
+        Ok(())
+    }
+
+    async fn host_slot(&self, url: &Url) -> OwnedSlot {
+        let origin = url.origin().ascii_serialization();
+        let limiter = {
+            let mut hosts = self.hosts.lock().unwrap();
+            // origins nobody is talking to any more
+            hosts.retain(|_, limiter| Arc::strong_count(limiter) > 1);
+            let limiter = Arc::clone(hosts.entry(origin).or_insert_with(|| {
+                Arc::new(Limiter::new(self.requests_per_host.load(Ordering::Relaxed)))
+            }));
+            stats::set(&STATS.http_hosts, hosts.len() as u64);
+            limiter
+        };
+        limiter.acquire_owned().await
+    }
+
+    /// `length` bytes at `offset`, or the last `length` bytes with `offset`
+    /// None; returns them with the size of the whole file
+    pub(crate) async fn get_range(
+        &self,
+        url: &str,
+        ua: Option<&str>,
+        ck: Option<&str>,
+        offset: Option<u64>,
+        length: u64,
+    ) -> Result<(Vec<u8>, Option<u64>)> {
+        if length == 0 {
+            return Ok((Vec::new(), None));
+        }
+        let parsed = Url::parse(url).map_err(|e| anyhow!("Invalid URL {}: {}", url, e))?;
+        let range = match offset {
+            Some(offset) => format!("bytes={}-{}", offset, offset + length - 1),
+            None => format!("bytes=-{}", length),
+        };
+        let _slot = self.host_slot(&parsed).await;
+        let client = self.client.read().unwrap().clone();
+
+        let mut attempt = 0;
+        loop {
+            let mut request = client.get(parsed.clone()).header(RANGE, &range);
+            if let Some(ua) = ua {
+                request = request.header(USER_AGENT, ua);
+            }
+            if let Some(ck) = ck {
+                request = request.header(COOKIE, ck);
+            }
+
+            let started = Instant::now();
+            let response = match request.send().await {
+                Ok(response) if !response.status().is_server_error() => response,
+                Ok(_) | Err(_) if attempt + 1 < ATTEMPTS => {
+                    attempt += 1;
+                    stats::add(&STATS.http_retries, 1);
+                    tokio::time::sleep(RETRY_DELAY * 2u32.pow(attempt - 1)).await;
+                    continue;
+                }
+                Ok(response) => {
+                    return Err(anyhow!("HTTP {} for {}", response.status(), url));
+                }
+                Err(e) => return Err(anyhow!("Request to {} failed: {}", url, e)),
+            };
+
+            let ttfb = started.elapsed().as_micros() as u64;
+            stats::add(&STATS.http_requests, 1);
+            stats::add(&STATS.http_ttfb_us_total, ttfb);
+            stats::set(&STATS.http_ttfb_us_last, ttfb);
+            if response.version() == Version::HTTP_2 {
+                stats::add(&STATS.http2_requests, 1);
+            }
+
+            match response.status() {
+                StatusCode::PARTIAL_CONTENT => {}
+                StatusCode::OK => {
+                    return Err(anyhow!("Server does not support range requests: {}", url));
+                }
+                status => return Err(anyhow!("HTTP {} for {}", status, url)),
+            }
+            // "bytes first-last/total"
+            let total = response
+                .headers()
+                .get(CONTENT_RANGE)
+                .and_then(|v| v.to_str().ok())
+                .and_then(|v| v.rsplit('/').next())
+                .and_then(|v| v.parse::<u64>().ok());
+
+            let data = match response.bytes().await {
+                Ok(data) => data,
+                // stalled or cut off mid-body; the range is simply asked again
+                Err(_) if attempt + 1 < ATTEMPTS => {
+                    attempt += 1;
+                    stats::add(&STATS.http_retries, 1);
+                    tokio::time::sleep(RETRY_DELAY * 2u32.pow(attempt - 1)).await;
+                    continue;
+                }
+                Err(e) => return Err(anyhow!("Reading from {} failed: {}", url, e)),
+            };
+            if offset.is_some() && data.len() as u64 != length {
+                return Err(anyhow!(
+                    "Short read from {}: {} of {} bytes",
+                    url,
+                    data.len(),
+                    length
+                ));
+            }
+            return Ok((data.to_vec(), total));
+        }
+    }
+}
+
+fn build_client(idle_per_host: u64) -> Result<Client> {
+    Client::builder()
+        .pool_max_idle_per_host(idle_per_host as usize)
+        .pool_idle_timeout(IDLE_TIMEOUT)
+        .connect_timeout(Duration::from_secs(15))
+        .read_timeout(READ_TIMEOUT)
+        .tcp_keepalive(Duration::from_secs(30))
+        .tcp_nodelay(true)
+        .http2_adaptive_window(true)
+        .build()
+        .map_err(|e| anyhow!("Failed to create HTTP client: {}", e))
+}
+
+/// remote payload.bin, or the payload.bin stored in a remote OTA zip, read
+/// through the shared pool
+pub struct HttpSource {
+    url: String,
+    ua: Option<String>,
+    ck: Option<String>,
+    /// offset of payload.bin in the file, non-zero inside an OTA zip
+    base: u64,
+}
+
+impl HttpSource {
+    /// `base` as found when the payload was opened, see Probe
+    pub fn new(url: &str, ua: Option<&str>, ck: Option<&str>, base: u64) -> Self {
+        Self {
+            url: url.to_string(),
+            ua: ua.map(str::to_string),
+            ck: ck.map(str::to_string),
+            base,
+        }
+    }
+}
+
+impl RangeSource for HttpSource {
+    fn fetch(&self, offset: u64, length: u64) -> FetchFuture<'_> {
+        Box::pin(async move {
+            let (data, _) = HTTP
+                .get_range(
+                    &self.url,
+                    self.ua.as_deref(),
+                    self.ck.as_deref(),
+                    Some(self.base + offset),
+                    length,
+                )
+                .await?;
+            Ok(data)
+        })
+    }
+}
+
+/// the ranges of a remote file read while it is opened
+///
+/// the last TAIL_LEN bytes are fetched up front: they tell a zip from a bare
+/// payload.bin, give the size of the file and usually hold the whole central
+/// directory. every read they do not cover fetches at least PROBE_WINDOW
+/// bytes, so the local header, the payload header and the manifest behind
+/// it mostly come in one more request.
+pub(crate) struct Probe<'a> {
+    url: &'a str,
+    ua: Option<&'a str>,
+    ck: Option<&'a str>,
+    file_len: u64,
+    tail_start: u64,
+    /// every range fetched so far with its offset, the tail first
+    fetched: Mutex<Vec<(u64, Vec<u8>)>>,
+    requests: AtomicU64,
+}
+
+impl<'a> Probe<'a> {
+    pub(crate) async fn open(
+        url: &'a str,
+        ua: Option<&'a str>,
+        ck: Option<&'a str>,
+    ) -> Result<Self> {
+        let (tail, total) = HTTP.get_range(url, ua, ck, None, zip::TAIL_LEN).await?;
+        let file_len = total.ok_or_else(|| anyhow!("Server did not report the size"))?;
+        let tail_start = file_len
+            .checked_sub(tail.len() as u64)
+            .ok_or_else(|| anyhow!("Server reported a size smaller than its data"))?;
+        Ok(Self {
+            url,
+            ua,
+            ck,
+            file_len,
+            tail_start,
+            fetched: Mutex::new(vec![(tail_start, tail)]),
+            requests: AtomicU64::new(1),
+        })
+    }
+
+    pub(crate) fn file_len(&self) -> u64 {
+        self.file_len
+    }
+
+    /// whether the file ends like a zip
+    pub(crate) fn is_zip(&self) -> bool {
+        let fetched = self.fetched.lock().unwrap();
+        zip::end_record(&fetched[0].1).is_some()
+    }
+
+    /// HTTP requests issued so far
+    pub(crate) fn requests(&self) -> u64 {
+        self.requests.load(Ordering::Relaxed)
+    }
+
+    /// exactly `len` bytes at `offset`
+    pub(crate) async fn read(&self, offset: u64, len: usize) -> Result<Vec<u8>> {
+        let end = offset
+            .checked_add(len as u64)
+            .filter(|&end| end <= self.file_len)
+            .ok_or_else(|| anyhow!("Read past the end of {}", self.url))?;
+        if let Some(data) = self.held(offset, end) {
+            return Ok(data);
+        }
+        // no point fetching what the tail already holds
+        let want = (len as u64)
+            .max(PROBE_WINDOW)
+            .min(self.tail_start.max(end) - offset);
+        let (data, _) = HTTP
+            .get_range(self.url, self.ua, self.ck, Some(offset), want)
+            .await?;
+        self.requests.fetch_add(1, Ordering::Relaxed);
+        let wanted = data[..len].to_vec();
+        self.fetched.lock().unwrap().push((offset, data));
+        Ok(wanted)
+    }
+
+    fn held(&self, offset: u64, end: u64) -> Option<Vec<u8>> {
+        let fetched = self.fetched.lock().unwrap();
+        fetched.iter().find_map(|(start, data)| {
+            (offset >= *start && end <= start + data.len() as u64)
+                .then(|| data[(offset - start) as usize..(end - start) as usize].to_vec())
+        })
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::{HTTP, HttpPool, HttpSource, Probe};
+    use crate::source::RangeSource;
+    use reqwest::Url;
+    use std::sync::Arc;
+    use std::sync::atomic::{AtomicUsize, Ordering};
+    use std::time::Duration;
+    use tokio::io::{AsyncBufReadExt, AsyncWriteExt, BufReader};
+    use tokio::net::{TcpListener, TcpStream};
+
+    const FILE_LEN: usize = 1024 * 1024;
+
+    #[derive(Clone, Copy)]
+    enum Reply {
+        /// every range as asked
+        Ranges,
+        /// 503 to the first request, then as asked
+        FailFirst,
+        /// half of every range asked
+        Short,
+    }
+
+    /// a loopback HTTP/1.1 server holding one file of FILE_LEN bytes
+    struct Server {
+        url: String,
+        connections: Arc<AtomicUsize>,
+        requests: Arc<AtomicUsize>,
+    }
+
+    fn file() -> Vec<u8> {
+        (0..FILE_LEN).map(|i| (i % 251) as u8).collect()
+    }
+
+    async fn serve(reply: Reply) -> Server {
+        let listener = TcpListener::bind("127.0.0.1:0").await.unwrap();
+        let url = format!("http://{}/payload.bin", listener.local_addr().unwrap());
+        let connections = Arc::new(AtomicUsize::new(0));
+        let requests = Arc::new(AtomicUsize::new(0));
+        let (accepted, served) = (connections.clone(), requests.clone());
+        tokio::spawn(async move {
+            let file = Arc::new(file());
+            while let Ok((stream, _)) = listener.accept().await {
+                accepted.fetch_add(1, Ordering::SeqCst);
+                tokio::spawn(answer(stream, reply, file.clone(), served.clone()));
+            }
+        });
+        Server {
+            url,
+            connections,
+            requests,
+        }
+    }
+
+    /// answers the requests of one kept-alive connection until it closes
+    async fn answer(stream: TcpStream, reply: Reply, file: Arc<Vec<u8>>, served: Arc<AtomicUsize>) {
+        let mut stream = BufReader::new(stream);
+        loop {
+            let mut range = None;
+            loop {
+                let mut line = String::new();
+                if stream.read_line(&mut line).await.unwrap_or(0) == 0 {
+                    return;
+                }
+                if line == "\r\n" {
+                    break;
+                }
+                let line = line.trim_end().to_ascii_lowercase();
+                if let Some(spec) = line.strip_prefix("range: bytes=") {
+                    range = Some(spec.to_string());
+                }
+            }
+            let nth = served.fetch_add(1, Ordering::SeqCst);
+
+            let (first, last) = match range.as_deref().and_then(|r| r.split_once('-')) {
+                Some(("", n)) => (FILE_LEN - n.parse::<usize>().unwrap(), FILE_LEN - 1),
+                Some((a, b)) => (a.parse().unwrap(), b.parse::<usize>().unwrap()),
+                None => (0, FILE_LEN - 1),
+            };
+            let response = match reply {
+                Reply::FailFirst if nth == 0 => {
+                    b"HTTP/1.1 503 Service Unavailable\r\ncontent-length: 0\r\n\r\n".to_vec()
+                }
+                _ => {
+                    let end = match reply {
+                        Reply::Short => first + (last + 1 - first) / 2,
+                        _ => last + 1,
+                    };
+                    let mut response = format!(
+                        "HTTP/1.1 206 Partial Content\r\ncontent-length: {}\r\n\
+                         content-range: bytes {}-{}/{}\r\n\r\n",
+                        end - first,
+                        first,
+                        end - 1,
+                        FILE_LEN
+                    )
+                    .into_bytes();
+                    response.extend_from_slice(&file[first..end]);
+                    response
+                }
+            };
+            if stream.get_mut().write_all(&response).await.is_err() {
+                return;
+            }
+        }
+    }
+
+    #[tokio::test]
+    async fn ranged_reads_of_several_jobs_share_one_connection() {
+        let server = serve(Reply::Ranges).await;
+        let file = file();
+
+        for (job, offset) in [0u64, 300_000, 900_000].into_iter().enumerate() {
+            let source = HttpSource::new(&server.url, None, None, offset);
+            for chunk in 0..4u64 {
+                let data = source.fetch(chunk * 4096, 4096).await.unwrap();
+                let at = (offset + chunk * 4096) as usize;
+                assert_eq!(data, file[at..at + 4096], "job {}", job);
+            }
+        }
+        assert_eq!(server.requests.load(Ordering::SeqCst), 12);
+        assert_eq!(server.connections.load(Ordering::SeqCst), 1);
+    }
+
+    #[tokio::test]
+    async fn server_errors_are_retried() {
+        let server = serve(Reply::FailFirst).await;
+
+        let (data, total) = HTTP
+            .get_range(&server.url, None, None, Some(100), 50)
+            .await
+            .unwrap();
+        assert_eq!(data, file()[100..150]);
+        assert_eq!(total, Some(FILE_LEN as u64));
+        assert_eq!(server.requests.load(Ordering::SeqCst), 2);
+    }
+
+    #[tokio::test]
+    async fn short_ranges_are_errors() {
+        let server = serve(Reply::Short).await;
+
+        let short = HTTP.get_range(&server.url, None, None, Some(0), 4096).await;
+        assert!(short.unwrap_err().to_string().contains("Short read"));
+    }
+
+    #[tokio::test]
+    async fn suffix_ranges_report_the_file_size() {
+        let server = serve(Reply::Ranges).await;
+
+        let (data, total) = HTTP
+            .get_range(&server.url, None, None, None, 1000)
+            .await
+            .unwrap();
+        assert_eq!(data, file()[FILE_LEN - 1000..]);
+        assert_eq!(total, Some(FILE_LEN as u64));
+    }
+
+    #[tokio::test]
+    async fn probe_reads_the_header_and_manifest_in_one_request() {
+        let server = serve(Reply::Ranges).await;
+        let file = file();
+
+        let probe = Probe::open(&server.url, None, None).await.unwrap();
+        assert_eq!(probe.file_len(), FILE_LEN as u64);
+        assert!(!probe.is_zip());
+        assert_eq!(probe.read(0, 24).await.unwrap(), file[..24]);
+        assert_eq!(probe.read(24, 10_000).await.unwrap(), file[24..10_024]);
+        // the tail already holds the end of the file
+        let end = FILE_LEN - 100;
+        assert_eq!(probe.read(end as u64, 100).await.unwrap(), file[end..]);
+        assert_eq!(probe.requests(), 2);
+        assert_eq!(server.requests.load(Ordering::SeqCst), 2);
+    }
+
+    #[tokio::test]
+    async fn origins_without_requests_are_dropped() {
+        let pool = HttpPool::new();
+        let a = Url::parse("https://a.example/payload.bin").unwrap();
+        let b = Url::parse("https://b.example/ota.zip").unwrap();
+
+        drop(pool.host_slot(&a).await);
+        let _slot = pool.host_slot(&b).await;
+        let hosts = pool.hosts.lock().unwrap();
+        assert_eq!(hosts.len(), 1);
+        assert!(hosts.contains_key("https://b.example"));
+    }
+
+    #[tokio::test]
+    async fn requests_to_one_origin_are_capped() {
+        let pool = HttpPool::new();
+        pool.configure(1, 0).unwrap();
+        let url = Url::parse("https://a.example/payload.bin").unwrap();
+
+        let first = pool.host_slot(&url).await;
+        let waiting = tokio::time::timeout(Duration::from_millis(50), pool.host_slot(&url));
+        assert!(waiting.await.is_err());
+        drop(first);
+        let second = tokio::time::timeout(Duration::from_secs(5), pool.host_slot(&url));
+        assert!(second.await.is_ok());
+    }
+}
@@ -0,0 +1,351 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use crate::cancel::CancelToken;
+use crate::engine::{self, Decoded, Input, decode_operation};
+use crate::extractor::{find_partition, open_local_source, open_remote_source};
+use crate::local::Access;
+use crate::profile;
+use crate::runtime::RUNTIME;
+use crate::source::RangeSource;
+use crate::stats::{self, STATS};
+use anyhow::{Result, anyhow};
+use payload_dumper_core::structs::PartitionUpdate;
+use payload_dumper_core::structs::install_operation::Type;
+use std::collections::HashMap;
+use std::path::Path;
+use std::sync::{Arc, Mutex};
+use tokio::task::JoinSet;
+
+/// decoded operations kept by default
+pub const DEFAULT_CACHE_BYTES: u64 = 64 * 1024 * 1024;
+/// the same in the low-memory profile
+const LOW_MEMORY_CACHE_BYTES: u64 = 8 * 1024 * 1024;
+
+/// uncompressed operations up to this size are fetched and cached whole like
+/// compressed ones; scattered small reads such as filesystem metadata then
+/// cost one request per operation instead of one per read
+const WHOLE_REPLACE_MAX: u64 = 2 * 1024 * 1024;
+
+/// part of the image written by one operation
+struct Span {
+    /// byte offset in the image
+    start: u64,
+    len: u64,
+    op: usize,
+    /// byte offset of this span in the output of the operation
+    op_offset: u64,
+}
+
+/// a piece of a read, served by one span
+struct Piece {
+    op: usize,
+    /// offset in the output of the operation
+    op_offset: u64,
+    /// offset in the caller's buffer
+    buf_offset: usize,
+    len: usize,
+}
+
+/// least recently used decoded operations, bounded in bytes
+struct Lru {
+    entries: HashMap<usize, (Arc<Decoded>, u64)>,
+    bytes: u64,
+    limit: u64,
+    tick: u64,
+}
+
+impl Lru {
+    fn get(&mut self, op: usize) -> Option<Arc<Decoded>> {
+        self.tick += 1;
+        let tick = self.tick;
+        self.entries.get_mut(&op).map(|(decoded, used)| {
+            *used = tick;
+            Arc::clone(decoded)
+        })
+    }
+
+    fn insert(&mut self, op: usize, decoded: Arc<Decoded>) {
+        let size = decoded.as_slice().len() as u64;
+        if size > self.limit {
+            return;
+        }
+        while self.bytes + size > self.limit {
+            let Some((&oldest, _)) = self.entries.iter().min_by_key(|(_, (_, used))| *used) else {
+                break;
+            };
+            if let Some((evicted, _)) = self.entries.remove(&oldest) {
+                self.bytes -= evicted.as_slice().len() as u64;
+            }
+        }
+        self.tick += 1;
+        if let Some((old, _)) = self.entries.insert(op, (decoded, self.tick)) {
+            self.bytes -= old.as_slice().len() as u64;
+        }
+        self.bytes += size;
+    }
+}
+
+/// random access to one partition without extracting it
+///
+/// a read is mapped onto the destination extents of the operations that
+/// cover it and only those are fetched and decoded. large uncompressed
+/// operations are read straight from the matching bytes of their blob; the
+/// others are decoded whole and kept in a bounded LRU, so neighbouring reads
+/// do not fetch them again. blocks that no operation writes read as zeros.
+pub struct VirtualImage {
+    source: Arc<dyn RangeSource>,
+    partition: PartitionUpdate,
+    data_offset: u64,
+    block_size: u64,
+    size: u64,
+    /// sorted by start
+    spans: Vec<Span>,
+    cache: Mutex<Lru>,
+    /// reads are never cancelled, decoders still want a token
+    cancel: CancelToken,
+}
+
+impl VirtualImage {
+    /// open partition `name` of a local payload.bin or OTA zip
+    pub fn open_local(path: &Path, name: &str, cache_bytes: u64) -> Result<Self> {
+        RUNTIME.block_on(async {
+            let (manifest, data_offset, source) = open_local_source(path, Access::Random).await?;
+            let partition = find_partition(&manifest, name)?.clone();
+            let block_size = manifest.block_size.unwrap_or(4096) as u64;
+            Self::new(source, partition, data_offset, block_size, cache_bytes)
+        })
+    }
+
+    /// open partition `name` of a remote payload.bin or OTA zip
+    pub fn open_remote(
+        url: &str,
+        name: &str,
+        ua: Option<&str>,
+        ck: Option<&str>,
+        cache_bytes: u64,
+    ) -> Result<Self> {
+        RUNTIME.block_on(async {
+            let (manifest, data_offset, source) = open_remote_source(url, ua, ck).await?;
+            let partition = find_partition(&manifest, name)?.clone();
+            let block_size = manifest.block_size.unwrap_or(4096) as u64;
+            Self::new(source, partition, data_offset, block_size, cache_bytes)
+        })
+    }
+
+    fn new(
+        source: Arc<dyn RangeSource>,
+        partition: PartitionUpdate,
+        data_offset: u64,
+        block_size: u64,
+        cache_bytes: u64,
+    ) -> Result<Self> {
+        if !engine::is_supported(&partition) {
+            return Err(anyhow!(
+                "Partition {} is differential and cannot be read directly",
+                partition.partition_name
+            ));
+        }
+
+        let mut spans = Vec::new();
+        for (op, operation) in partition.operations.iter().enumerate() {
+            let mut op_offset = 0;
+            for extent in &operation.dst_extents {
+                let len = extent.num_blocks() * block_size;
+                spans.push(Span {
+                    start: extent.start_block() * block_size,
+                    len,
+                    op,
+                    op_offset,
+                });
+                op_offset += len;
+            }
+        }
+        spans.sort_by_key(|s| s.start);
+
+        let end = spans.iter().map(|s| s.start + s.len).max().unwrap_or(0);
+        let size = partition
+            .new_partition_info
+            .as_ref()
+            .and_then(|i| i.size)
+            .unwrap_or(end);
+
+        Ok(Self {
+            source,
+            partition,
+            data_offset,
+            block_size,
+            size,
+            spans,
+            cache: Mutex::new(Lru {
+                entries: HashMap::new(),
+                bytes: 0,
+                limit: match cache_bytes {
+                    0 if profile::low_memory() => LOW_MEMORY_CACHE_BYTES,
+                    0 => DEFAULT_CACHE_BYTES,
+                    n => n,
+                },
+                tick: 0,
+            }),
+            cancel: CancelToken::new(),
+        })
+    }
+
+    pub fn size(&self) -> u64 {
+        self.size
+    }
+
+    pub fn block_size(&self) -> u64 {
+        self.block_size
+    }
+
+    /// fill `buf` from `offset`; returns the bytes read, short only at the end
+    /// of the image
+    pub fn read_at(&self, offset: u64, buf: &mut [u8]) -> Result<usize> {
+        if offset >= self.size {
+            return Ok(0);
+        }
+        let len = (buf.len() as u64).min(self.size - offset) as usize;
+        let buf = &mut buf[..len];
+        buf.fill(0);
+        stats::add(&STATS.image_reads, 1);
+
+        let pieces = self.pieces(offset, len as u64);
+        let operations = &self.partition.operations;
+
+        // compressed operations are decoded whole, uncompressed ones only need
+        // their own bytes of the blob
+        let mut decoded: HashMap<usize, Arc<Decoded>> = HashMap::new();
+        let mut missing: Vec<usize> = Vec::new();
+        let mut direct: Vec<&Piece> = Vec::new();
+        {
+            let mut cache = self.cache.lock().unwrap();
+            for piece in &pieces {
+                match operations[piece.op].r#type() {
+                    Type::Zero | Type::Discard => {}
+                    Type::Replace if operations[piece.op].data_length() > WHOLE_REPLACE_MAX => {
+                        direct.push(piece)
+                    }
+                    _ if decoded.contains_key(&piece.op) || missing.contains(&piece.op) => {}
+                    _ => match cache.get(piece.op) {
+                        Some(hit) => {
+                            stats::add(&STATS.image_cache_hits, 1);
+                            decoded.insert(piece.op, hit);
+                        }
+                        None => missing.push(piece.op),
+                    },
+                }
+            }
+        }
+
+        let (blobs, direct_data) = RUNTIME.block_on(self.fetch(&missing, &direct))?;
+
+        for (op, data) in blobs {
+            let result = decode_operation(
+                &operations[op],
+                Input::Owned(data),
+                self.block_size,
+                &self.cancel,
+            )
+            .map_err(|e| anyhow!("Operation {} failed: {}", op, e))?;
+            stats::add(&STATS.image_ops_decoded, 1);
+            let result = Arc::new(result);
+            self.cache.lock().unwrap().insert(op, Arc::clone(&result));
+            decoded.insert(op, result);
+        }
+
+        for (piece, data) in direct.iter().zip(direct_data) {
+            let n = data.len().min(piece.len);
+            buf[piece.buf_offset..piece.buf_offset + n].copy_from_slice(&data[..n]);
+        }
+        for piece in &pieces {
+            let Some(output) = decoded.get(&piece.op) else {
+                continue;
+            };
+            let output = output.as_slice();
+            let start = (piece.op_offset as usize).min(output.len());
+            let end = (start + piece.len).min(output.len());
+            buf[piece.buf_offset..piece.buf_offset + (end - start)]
+                .copy_from_slice(&output[start..end]);
+        }
+
+        stats::add(&STATS.image_read_bytes, len as u64);
+        Ok(len)
+    }
+
+    /// the spans overlapping [offset, offset + len), in operation order so a
+    /// later operation wins where two write the same blocks
+    fn pieces(&self, offset: u64, len: u64) -> Vec<Piece> {
+        let end = offset + len;
+        let first = self.spans.partition_point(|s| s.start + s.len <= offset);
+
+        let mut pieces: Vec<Piece> = self.spans[first..]
+            .iter()
+            .take_while(|s| s.start < end)
+            .filter(|s| s.start + s.len > offset)
+            .map(|s| {
+                let from = s.start.max(offset);
+                let to = (s.start + s.len).min(end);
+                Piece {
+                    op: s.op,
+                    op_offset: s.op_offset + (from - s.start),
+                    buf_offset: (from - offset) as usize,
+                    len: (to - from) as usize,
+                }
+            })
+            .collect();
+        pieces.sort_by_key(|p| p.op);
+        pieces
+    }
+
+    /// whole blobs of `ops`, and the bytes of each direct piece, fetched
+    /// concurrently
+    async fn fetch(
+        &self,
+        ops: &[usize],
+        direct: &[&Piece],
+    ) -> Result<(Vec<(usize, Vec<u8>)>, Vec<Vec<u8>>)> {
+        let operations = &self.partition.operations;
+        let mut tasks: JoinSet<(bool, usize, Result<Vec<u8>>)> = JoinSet::new();
+
+        for &op in ops {
+            let operation = &operations[op];
+            let (offset, length) = (
+                self.data_offset + operation.data_offset(),
+                operation.data_length(),
+            );
+            let source = Arc::clone(&self.source);
+            tasks.spawn(async move { (false, op, source.fetch(offset, length).await) });
+        }
+        for (i, piece) in direct.iter().enumerate() {
+            let operation = &operations[piece.op];
+            let available = operation.data_length().saturating_sub(piece.op_offset);
+            let length = (piece.len as u64).min(available);
+            let offset = self.data_offset + operation.data_offset() + piece.op_offset;
+            let source = Arc::clone(&self.source);
+            tasks.spawn(async move {
+                let data = if length == 0 {
+                    Ok(Vec::new())
+                } else {
+                    source.fetch(offset, length).await
+                };
+                (true, i, data)
+            });
+        }
+
+        let mut blobs = Vec::with_capacity(ops.len());
+        let mut pieces = vec![Vec::new(); direct.len()];
+        while let Some(joined) = tasks.join_next().await {
+            let (is_direct, index, data) =
+                joined.map_err(|e| anyhow!("Read task failed: {}", e))?;
+            let data = data?;
+            stats::add(&STATS.image_fetched_bytes, data.len() as u64);
+            if is_direct {
+                pieces[index] = data;
+            } else {
+                blobs.push((index, data));
+            }
+        }
+        Ok((blobs, pieces))
+    }
+}
@@ -5,9 +5,11 @@ use crate::extractor::{
     ExtractionProgress, ExtractionStatus, ProgressCallback, extract_local_partition,
     extract_remote_partition, list_local_partitions, list_remote_partitions,
 };
+use crate::profile::set_low_memory;
+use crate::stats::stats_json;
 use jni::JNIEnv;
 use jni::objects::{JClass, JObject, JString, JValue};
-use jni::sys::jstring;
+use jni::sys::{jboolean, jstring};
 use std::panic::AssertUnwindSafe;
 use std::sync::Arc;
 
@@ -235,7 +237,7 @@ pub extern "system" fn Java_com_rhythmcache_payloaddumper_PayloadDumper_extractL
         let source = optional_jstring(env, &source_dir)?;
         let cb = create_callback(env, &callback)?;
 
-        extract_local_partition(path_str, &partition, output, source, cb)
+        extract_local_partition(path_str, &partition, output, source, cb, None)
             .map_err(|e| format!("Extraction failed: {}", e))
     })
 }
@@ -269,7 +271,29 @@ pub extern "system" fn Java_com_rhythmcache_payloaddumper_PayloadDumper_extractR
             ck.as_deref(),
             source,
             cb,
+            None,
         )
         .map_err(|e| format!("Extraction failed: {}", e))
     })
 }
+
+#[unsafe(no_mangle)]
+pub extern "system" fn Java_com_rhythmcache_payloaddumper_PayloadDumper_getStats(
+    env: JNIEnv,
+    _class: JClass,
+) -> jstring {
+    handle_list(env, |_env| {
+        stats_json().map_err(|e| format!("Failed to get stats: {}", e))
+    })
+}
+
+#[unsafe(no_mangle)]
+pub extern "system" fn Java_com_rhythmcache_payloaddumper_PayloadDumper_setLowMemoryMode(
+    env: JNIEnv,
+    _class: JClass,
+    enabled: jboolean,
+) {
+    handle_extract(env, |_env| {
+        set_low_memory(enabled != 0).map_err(|e| format!("Failed to switch memory profile: {}", e))
+    })
+}
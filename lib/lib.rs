@@ -1,5 +1,32 @@
+pub mod budget;
+pub mod cache;
+pub mod cancel;
 #[cfg(feature = "capi")]
 pub mod capi;
+pub mod diff;
+pub mod engine;
+pub mod erofs;
+pub mod ext4;
 pub mod extractor;
+pub mod follow;
+pub mod fs;
+pub mod http;
+pub mod image;
 #[cfg(feature = "jni")]
 pub mod jni;
+pub mod local;
+pub mod manifest;
+pub mod onepass;
+pub mod output;
+pub mod pool;
+pub mod prefetch;
+pub mod profile;
+pub mod runtime;
+pub mod scheduler;
+pub mod sidecar;
+pub mod source;
+pub mod stats;
+pub mod stream;
+pub mod throttle;
+pub mod warm;
+pub mod zip;
@@ -0,0 +1,437 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use crate::engine::read_at;
+use crate::extractor::FileType;
+use crate::follow::{self, Growing};
+use crate::profile;
+use crate::source::{FetchFuture, RangeSource};
+use crate::stats::{self, STATS};
+use crate::zip;
+use anyhow::{Result, anyhow};
+use payload_dumper_core::payload::payload_dumper::AsyncPayloadRead;
+use std::fs::{File, OpenOptions};
+use std::io;
+use std::path::Path;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::{Arc, Mutex};
+use tokio::runtime::Handle;
+
+/// short reads that continue the previous one are extended to this, so a run
+/// of small blobs costs one request instead of one per operation
+const COALESCE_BYTES: u64 = 4 * 1024 * 1024;
+/// the same in the low-memory profile
+const LOW_MEMORY_COALESCE_BYTES: u64 = 1024 * 1024;
+
+static MMAP: AtomicBool = AtomicBool::new(false);
+
+/// serve reads of local payloads opened afterwards from a memory mapping of
+/// the file instead of read calls (64-bit Linux and Android only)
+///
+/// saves a system call per read on fast local storage; the file must not be
+/// truncated while it is open
+pub fn set_mmap(enabled: bool) {
+    MMAP.store(enabled, Ordering::Relaxed);
+}
+
+/// how a source is going to be read, passed on to the kernel as a hint
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Access {
+    /// extraction, blobs front to back
+    Sequential,
+    /// browsing a partition, blobs anywhere
+    Random,
+}
+
+struct Inner {
+    file: File,
+    /// offset of payload.bin in the file, non-zero inside an OTA zip
+    base: u64,
+    /// size of payload.bin, u64::MAX for a followed payload.bin
+    len: u64,
+    map: Option<map::Mapping>,
+    /// set in follow mode, the file may still be downloading
+    growing: Option<Growing>,
+}
+
+impl Inner {
+    /// bytes of payload.bin from `offset` that can be read without waiting
+    fn available(&self, offset: u64) -> u64 {
+        let end = match &self.growing {
+            Some(growing) => growing.arrived().saturating_sub(self.base).min(self.len),
+            None => self.len,
+        };
+        end.saturating_sub(offset)
+    }
+
+    fn read(&self, offset: u64, length: u64) -> io::Result<Vec<u8>> {
+        stats::add(&STATS.local_reads, 1);
+        stats::add(&STATS.local_read_bytes, length);
+        let start = self.base + offset;
+        if let Some(map) = &self.map {
+            let bytes = map.bytes();
+            let end = start + length;
+            if end > bytes.len() as u64 {
+                return Err(io::ErrorKind::UnexpectedEof.into());
+            }
+            return Ok(bytes[start as usize..end as usize].to_vec());
+        }
+        let mut buf = vec![0u8; length as usize];
+        read_at(&self.file, &mut buf, start)?;
+        Ok(buf)
+    }
+}
+
+#[derive(Default)]
+struct Window {
+    /// where the last read ended, a read starting here is sequential
+    next: u64,
+    /// the last read extended past what was asked, starting at `offset`
+    offset: u64,
+    data: Option<Vec<u8>>,
+}
+
+/// reader of a local payload.bin or of the payload.bin stored in an OTA zip
+///
+/// reads run on the blocking pool with positioned reads, so any number of
+/// them can be in flight on one handle. a short read that starts where the
+/// previous one ended reads ahead to COALESCE_BYTES and later reads are
+/// served from that window, which turns the per-operation blob reads of an
+/// extraction into large sequential ones; that is what matters on USB drives
+/// and network shares, where every request has a fixed cost. the kernel is
+/// told the access pattern, and asked to read the next window ahead while
+/// the current one is decoded.
+///
+/// the window belongs to this handle, and every job opens its own, so jobs
+/// never share or wait on each other's window. a mapped source has none:
+/// every read is copied once straight out of the mapping into the buffer it
+/// returns, instead of into a window first and out of it again. nor has a
+/// handle opened for random access, whose reads never continue each other.
+///
+/// in follow mode (see follow::set_follow()) the file may still be growing;
+/// reads wait for their data to arrive and read-ahead stops at what has.
+pub struct LocalPayload {
+    inner: Arc<Inner>,
+    /// None for mapped and random-access sources
+    window: Option<Mutex<Window>>,
+}
+
+impl LocalPayload {
+    pub async fn open(path: &Path, file_type: FileType, access: Access) -> Result<Self> {
+        let inner = if follow::enabled() {
+            open_followed(path, file_type, access).await?
+        } else {
+            let path = path.to_path_buf();
+            tokio::task::spawn_blocking(move || open_complete(&path, file_type, access))
+                .await
+                .map_err(|e| anyhow!("Open task failed: {}", e))??
+        };
+
+        let window = (access == Access::Sequential && inner.map.is_none())
+            .then(|| Mutex::new(Window::default()));
+        Ok(Self {
+            inner: Arc::new(inner),
+            window,
+        })
+    }
+
+    async fn read(&self, offset: u64, length: u64) -> Result<Vec<u8>> {
+        let Some(window) = &self.window else {
+            return self.read_span(offset, length, false).await;
+        };
+        let span = {
+            let mut window = window.lock().unwrap();
+            if let Some(data) = &window.data {
+                let end = window.offset + data.len() as u64;
+                if offset >= window.offset && offset + length <= end {
+                    let start = (offset - window.offset) as usize;
+                    let hit = data[start..start + length as usize].to_vec();
+                    window.next = offset + length;
+                    stats::add(&STATS.local_window_hits, 1);
+                    return Ok(hit);
+                }
+            }
+            let coalesce = if profile::low_memory() {
+                LOW_MEMORY_COALESCE_BYTES
+            } else {
+                COALESCE_BYTES
+            };
+            let sequential = offset == window.next;
+            window.next = offset + length;
+            if sequential && length < coalesce {
+                coalesce.min(self.inner.available(offset)).max(length)
+            } else {
+                length
+            }
+        };
+
+        let data = self.read_span(offset, span, span > length).await?;
+        if span == length {
+            return Ok(data);
+        }
+        let hit = data[..length as usize].to_vec();
+        let mut window = window.lock().unwrap();
+        window.offset = offset;
+        window.data = Some(data);
+        Ok(hit)
+    }
+
+    /// `span` bytes at `offset`, waiting for them in follow mode; `ahead`
+    /// asks the kernel for the span after them too
+    async fn read_span(&self, offset: u64, span: u64, ahead: bool) -> Result<Vec<u8>> {
+        if let Some(growing) = &self.inner.growing {
+            growing
+                .wait(&self.inner.file, self.inner.base + offset + span)
+                .await?;
+        }
+        let inner = Arc::clone(&self.inner);
+        tokio::task::spawn_blocking(move || {
+            let data = inner.read(offset, span);
+            if ahead {
+                // the read after this one is likely the next window
+                advise_willneed(&inner.file, inner.base + offset + span, span);
+            }
+            data
+        })
+        .await
+        .map_err(|e| anyhow!("Read task failed: {}", e))?
+        .map_err(Into::into)
+    }
+}
+
+/// a payload that is complete on disk, opened on the blocking pool
+fn open_complete(path: &Path, file_type: FileType, access: Access) -> Result<Inner> {
+    let file = open_hinted(path, access)?;
+    let file_len = file.metadata()?.len();
+    let (base, len) = match file_type {
+        FileType::Bin => (0, file_len),
+        FileType::Zip => {
+            // the reads complete right away, blocking here is fine
+            let read = |offset, len| std::future::ready(read_exact(&file, offset, len));
+            Handle::current().block_on(zip::locate_payload(file_len, read))?
+        }
+    };
+    advise(&file, base, len, access);
+    let map = if MMAP.load(Ordering::Relaxed) {
+        map::Mapping::new(&file, base + len, access)
+    } else {
+        None
+    };
+    if map.is_some() {
+        stats::add(&STATS.local_mapped_sources, 1);
+    }
+    Ok(Inner {
+        file,
+        base,
+        len,
+        map,
+        growing: None,
+    })
+}
+
+/// a payload that may still be downloading
+///
+/// runs on the runtime rather than the blocking pool: finding payload.bin in
+/// a zip waits for the download to get there, which would hold a blocking
+/// thread for as long as that takes.
+async fn open_followed(path: &Path, file_type: FileType, access: Access) -> Result<Inner> {
+    let file = open_hinted(path, access)?;
+    let growing = Growing::new(&file)?;
+    let (base, len) = match file_type {
+        FileType::Bin => (0, u64::MAX),
+        FileType::Zip => {
+            // the central directory is written last
+            let read = |offset: u64, len: usize| {
+                let (file, growing) = (&file, &growing);
+                async move {
+                    growing.wait(file, offset + len as u64).await?;
+                    read_exact(file, offset, len)
+                }
+            };
+            let (base, len) = zip::locate_payload_forward(read).await?;
+            growing.complete_at(base + len);
+            (base, len)
+        }
+    };
+    // a length of 0 advises up to the end of the file, wherever the download
+    // ends up; a mapping cannot grow with the file, so there is none
+    advise(&file, base, 0, access);
+    Ok(Inner {
+        file,
+        base,
+        len,
+        map: None,
+        growing: Some(growing),
+    })
+}
+
+fn read_exact(file: &File, offset: u64, len: usize) -> Result<Vec<u8>> {
+    let mut buf = vec![0u8; len];
+    read_at(file, &mut buf, offset)?;
+    Ok(buf)
+}
+
+impl AsyncPayloadRead for LocalPayload {
+    async fn read_bytes(&self, offset: u64, length: u64) -> Result<Vec<u8>> {
+        self.read(offset, length).await
+    }
+}
+
+impl RangeSource for LocalPayload {
+    fn fetch(&self, offset: u64, length: u64) -> FetchFuture<'_> {
+        Box::pin(self.read(offset, length))
+    }
+}
+
+#[cfg(windows)]
+fn open_hinted(path: &Path, access: Access) -> io::Result<File> {
+    use std::os::windows::fs::OpenOptionsExt;
+    const FILE_FLAG_RANDOM_ACCESS: u32 = 0x1000_0000;
+    const FILE_FLAG_SEQUENTIAL_SCAN: u32 = 0x0800_0000;
+    OpenOptions::new()
+        .read(true)
+        .custom_flags(match access {
+            Access::Sequential => FILE_FLAG_SEQUENTIAL_SCAN,
+            Access::Random => FILE_FLAG_RANDOM_ACCESS,
+        })
+        .open(path)
+}
+
+#[cfg(not(windows))]
+fn open_hinted(path: &Path, _access: Access) -> io::Result<File> {
+    OpenOptions::new().read(true).open(path)
+}
+
+#[cfg(all(
+    any(target_os = "linux", target_os = "android"),
+    target_pointer_width = "64"
+))]
+fn advise(file: &File, offset: u64, len: u64, access: Access) {
+    use std::os::fd::AsRawFd;
+    let advice = match access {
+        Access::Sequential => libc::POSIX_FADV_SEQUENTIAL,
+        Access::Random => libc::POSIX_FADV_RANDOM,
+    };
+    unsafe {
+        libc::posix_fadvise(
+            file.as_raw_fd(),
+            offset as libc::off_t,
+            len as libc::off_t,
+            advice,
+        );
+    }
+}
+
+#[cfg(all(
+    any(target_os = "linux", target_os = "android"),
+    target_pointer_width = "64"
+))]
+fn advise_willneed(file: &File, offset: u64, len: u64) {
+    use std::os::fd::AsRawFd;
+    unsafe {
+        libc::posix_fadvise(
+            file.as_raw_fd(),
+            offset as libc::off_t,
+            len as libc::off_t,
+            libc::POSIX_FADV_WILLNEED,
+        );
+    }
+}
+
+/// windows takes its hint at open time, see open_hinted(); 32-bit Linux
+/// cannot pass offsets past 2 GiB to posix_fadvise through libc::off_t
+#[cfg(not(all(
+    any(target_os = "linux", target_os = "android"),
+    target_pointer_width = "64"
+)))]
+fn advise(_file: &File, _offset: u64, _len: u64, _access: Access) {}
+
+#[cfg(not(all(
+    any(target_os = "linux", target_os = "android"),
+    target_pointer_width = "64"
+)))]
+fn advise_willneed(_file: &File, _offset: u64, _len: u64) {}
+
+#[cfg(all(
+    any(target_os = "linux", target_os = "android"),
+    target_pointer_width = "64"
+))]
+mod map {
+    use super::Access;
+    use std::fs::File;
+    use std::os::fd::AsRawFd;
+
+    /// a read-only shared mapping of the first `len` bytes of a file
+    pub struct Mapping {
+        ptr: *mut libc::c_void,
+        len: usize,
+    }
+
+    // the mapping is read-only and lives as long as the reader
+    unsafe impl Send for Mapping {}
+    unsafe impl Sync for Mapping {}
+
+    impl Mapping {
+        pub fn new(file: &File, len: u64, access: Access) -> Option<Self> {
+            if len == 0 {
+                return None;
+            }
+            let len = len as usize;
+            let ptr = unsafe {
+                libc::mmap(
+                    std::ptr::null_mut(),
+                    len,
+                    libc::PROT_READ,
+                    libc::MAP_SHARED,
+                    file.as_raw_fd(),
+                    0,
+                )
+            };
+            if ptr == libc::MAP_FAILED {
+                return None;
+            }
+            let advice = match access {
+                Access::Sequential => libc::MADV_SEQUENTIAL,
+                Access::Random => libc::MADV_RANDOM,
+            };
+            unsafe {
+                libc::madvise(ptr, len, advice);
+            }
+            Some(Self { ptr, len })
+        }
+
+        pub fn bytes(&self) -> &[u8] {
+            unsafe { std::slice::from_raw_parts(self.ptr as *const u8, self.len) }
+        }
+    }
+
+    impl Drop for Mapping {
+        fn drop(&mut self) {
+            unsafe {
+                libc::munmap(self.ptr, self.len);
+            }
+        }
+    }
+}
+
+/// elsewhere payloads are always read with read calls
+#[cfg(not(all(
+    any(target_os = "linux", target_os = "android"),
+    target_pointer_width = "64"
+)))]
+mod map {
+    use super::Access;
+    use std::fs::File;
+
+    pub enum Mapping {}
+
+    impl Mapping {
+        pub fn new(_file: &File, _len: u64, _access: Access) -> Option<Self> {
+            None
+        }
+
+        pub fn bytes(&self) -> &[u8] {
+            match *self {}
+        }
+    }
+}
@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use anyhow::{Result, anyhow};
+use payload_dumper_core::constants::PAYLOAD_MAGIC;
+use payload_dumper_core::structs::DeltaArchiveManifest;
+use prost::Message;
+use std::future::Future;
+
+/// a manifest size past this is a corrupt header, not a real payload
+const MAX_MANIFEST_LEN: u64 = 256 * 1024 * 1024;
+
+/// manifest and data offset of the payload.bin starting at `base`
+///
+/// `read(offset, len)` returns exactly `len` bytes of the file. only the
+/// header and the manifest are read and decoded in memory; the returned data
+/// offset is relative to `base`, as the readers of payload.bin expect it.
+pub(crate) async fn parse<F, Fut>(base: u64, read: F) -> Result<(DeltaArchiveManifest, u64)>
+where
+    F: Fn(u64, usize) -> Fut,
+    Fut: Future<Output = Result<Vec<u8>>>,
+{
+    // magic, version, manifest size and, from version 2 on, the size of
+    // the metadata signature, all big endian
+    let header = read(base, 24).await?;
+    if header.len() < 24 || &header[..4] != PAYLOAD_MAGIC {
+        return Err(anyhow!("Invalid payload magic"));
+    }
+    let version = u64::from_be_bytes(header[4..12].try_into().unwrap());
+    let manifest_len = u64::from_be_bytes(header[12..20].try_into().unwrap());
+    let (header_len, signature_len) = match version {
+        1 => (20, 0),
+        2 => (
+            24,
+            u32::from_be_bytes(header[20..24].try_into().unwrap()) as u64,
+        ),
+        _ => return Err(anyhow!("Unsupported payload version {}", version)),
+    };
+    if manifest_len > MAX_MANIFEST_LEN {
+        return Err(anyhow!("Invalid manifest size {}", manifest_len));
+    }
+
+    let manifest = read(base + header_len, manifest_len as usize).await?;
+    let manifest = DeltaArchiveManifest::decode(manifest.as_slice())
+        .map_err(|e| anyhow!("Failed to parse manifest: {}", e))?;
+    Ok((manifest, header_len + manifest_len + signature_len))
+}
@@ -0,0 +1,401 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use crate::budget::{BUDGET, BudgetPermit};
+use crate::cache::to_hex;
+use crate::cancel::CancelToken;
+use crate::engine::{
+    Decoded, Input, SharedRead, StreamDigest, apply_operation, decode_footprint, is_streamed,
+    stream_operation, written_len,
+};
+use crate::output::OutputFile;
+use crate::profile;
+use crate::scheduler::SCHEDULER;
+use crate::stats::{self, STATS};
+use crate::throttle::JobPace;
+use anyhow::{Result, anyhow};
+use payload_dumper_core::payload::payload_dumper::{AsyncPayloadRead, ProgressReporter};
+use payload_dumper_core::structs::PartitionUpdate;
+use std::collections::BTreeMap;
+use std::io;
+use std::path::PathBuf;
+use std::sync::Arc;
+use std::sync::atomic::{AtomicU64, Ordering};
+use tokio::task::JoinSet;
+
+/// default upper bound on a single sequential read
+pub const DEFAULT_READ_SIZE: u64 = 16 * 1024 * 1024;
+/// the same in the low-memory profile
+const LOW_MEMORY_READ_SIZE: u64 = 2 * 1024 * 1024;
+
+/// 0 until set, the default of the active profile applies then
+static READ_SIZE: AtomicU64 = AtomicU64::new(0);
+
+/// size of the sequential reads of later passes, 0 restores the default
+pub fn set_read_size(bytes: u64) {
+    READ_SIZE.store(bytes, Ordering::Relaxed);
+}
+
+fn read_size() -> u64 {
+    match READ_SIZE.load(Ordering::Relaxed) {
+        0 if profile::low_memory() => LOW_MEMORY_READ_SIZE,
+        0 => DEFAULT_READ_SIZE,
+        n => n,
+    }
+}
+
+/// unselected data shorter than this is read through instead of skipped; a
+/// short forward skip costs a seek (or a new HTTP request) for nothing
+const MAX_READ_THROUGH: u64 = 1024 * 1024;
+
+struct Item {
+    target: usize,
+    index: usize,
+    /// read that holds the blob, None for operations without one
+    read: Option<usize>,
+}
+
+struct Read {
+    offset: u64,
+    length: u64,
+    /// the read itself plus the decode buffers of the operations it feeds
+    footprint: u64,
+}
+
+type TaskOutput = (usize, usize, io::Result<Decoded>);
+
+/// extraction of several full partitions in one forward scan of payload.bin
+///
+/// the blobs of every selected operation are sorted by their position in the
+/// payload and grouped into large sequential reads; each read is handed to
+/// the operations it contains, whichever partition they belong to. operations
+/// of one partition are still dispatched in manifest order, so their digests
+/// and the in-flight bound work exactly like in engine::extract_partition.
+pub struct OnePass<'a> {
+    partitions: Vec<&'a PartitionUpdate>,
+    items: Vec<Item>,
+    reads: Vec<Read>,
+    data_offset: u64,
+}
+
+impl<'a> OnePass<'a> {
+    /// every partition must satisfy engine::is_supported
+    pub fn new(partitions: Vec<&'a PartitionUpdate>, data_offset: u64, block_size: u64) -> Self {
+        // operations without a blob, and blobs stored out of order, keep the
+        // position of the furthest blob before them so that a stable sort never
+        // reorders the operations of one partition
+        let mut order: Vec<(u64, usize, usize)> = Vec::new();
+        for (target, partition) in partitions.iter().enumerate() {
+            let mut key = 0;
+            for (index, op) in partition.operations.iter().enumerate() {
+                if op.data_length() > 0 {
+                    key = key.max(op.data_offset());
+                }
+                order.push((key, target, index));
+            }
+        }
+        order.sort_by_key(|&(key, _, _)| key);
+
+        let read_size = read_size();
+        let mut items = Vec::with_capacity(order.len());
+        let mut reads: Vec<Read> = Vec::new();
+        for (_, target, index) in order {
+            let op = &partitions[target].operations[index];
+            if op.data_length() == 0 {
+                items.push(Item {
+                    target,
+                    index,
+                    read: None,
+                });
+                continue;
+            }
+
+            let start = data_offset + op.data_offset();
+            let end = start + op.data_length();
+            let extends = reads.last().is_some_and(|r| {
+                start >= r.offset
+                    && start <= r.offset + r.length + MAX_READ_THROUGH
+                    && end - r.offset <= read_size
+            });
+            if !extends {
+                reads.push(Read {
+                    offset: start,
+                    length: 0,
+                    footprint: 0,
+                });
+            }
+
+            let read = reads.last_mut().unwrap();
+            read.length = read.length.max(end - read.offset);
+            read.footprint += decode_footprint(op, block_size);
+            items.push(Item {
+                target,
+                index,
+                read: Some(reads.len() - 1),
+            });
+        }
+        for read in &mut reads {
+            read.footprint += read.length;
+        }
+
+        Self {
+            partitions,
+            items,
+            reads,
+            data_offset,
+        }
+    }
+
+    /// the reads the pass will issue, in order, as (offset, length) from the
+    /// start of payload.bin; remote sources prefetch exactly these
+    pub fn reads(&self) -> Vec<(u64, u64)> {
+        self.reads.iter().map(|r| (r.offset, r.length)).collect()
+    }
+
+    /// run the pass, writing partition `i` to `outputs[i]`
+    ///
+    /// a failing partition does not stop the others, its error is returned in
+    /// its slot; Ok(true) means the image was checked against the manifest
+    /// hash. reading errors and cancellation fail the whole pass.
+    pub async fn run<R: AsyncPayloadRead>(
+        &self,
+        outputs: &[PathBuf],
+        block_size: u64,
+        reader: &R,
+        reporter: &dyn ProgressReporter,
+        cancel: &Arc<CancelToken>,
+    ) -> Result<Vec<Result<bool>>> {
+        let max_in_flight = profile::in_flight();
+        let pace = JobPace::new();
+
+        let mut targets = Vec::with_capacity(self.partitions.len());
+        for (partition, output) in self.partitions.iter().zip(outputs) {
+            targets.push(Target::open(partition, output, block_size)?);
+        }
+        for target in &targets {
+            reporter.on_start(target.name(), target.total_operations());
+        }
+
+        let mut tasks: JoinSet<TaskOutput> = JoinSet::new();
+        let mut loaded: Option<(usize, Arc<SharedRead>)> = None;
+
+        for item in &self.items {
+            if cancel.is_cancelled() {
+                tasks.abort_all();
+                return Err(anyhow!("Extraction cancelled"));
+            }
+            if targets[item.target].error.is_some() {
+                continue;
+            }
+
+            // every partition dispatches in order, so the head of each reorder
+            // buffer is still in `tasks` and this never waits on an empty set
+            while tasks.len() + buffered(&targets) >= max_in_flight {
+                let output = join_next(&mut tasks).await?;
+                on_finished(&mut targets, output, reporter);
+            }
+
+            let op = &self.partitions[item.target].operations[item.index];
+            let input = match item.read {
+                None => Input::Owned(Vec::new()),
+                Some(read) => {
+                    if loaded.as_ref().map(|(i, _)| *i) != Some(read) {
+                        // release our reference first, a read still in use is
+                        // kept alive by the operations that need it
+                        drop(loaded.take());
+                        let permit = BUDGET
+                            .acquire_reaping(self.reads[read].footprint, &mut tasks, |output| {
+                                on_finished(&mut targets, output, reporter);
+                                Ok(())
+                            })
+                            .await?;
+                        loaded = Some((read, self.load(read, reader, permit).await?));
+                    }
+                    let (_, shared) = loaded.as_ref().unwrap();
+                    let start =
+                        (self.data_offset + op.data_offset() - self.reads[read].offset) as usize;
+                    let end = start + op.data_length() as usize;
+                    if end > shared.len() {
+                        return Err(anyhow!("Short read at offset {}", self.reads[read].offset));
+                    }
+                    Input::Shared(Arc::clone(shared), start..end)
+                }
+            };
+
+            pace.disk(written_len(op, block_size)).await;
+            let slot = SCHEDULER.decode.acquire().await;
+            let file = Arc::clone(&targets[item.target].file);
+            let cancel = Arc::clone(cancel);
+            let op = op.clone();
+            let (target, index) = (item.target, item.index);
+
+            tasks.spawn_blocking(move || {
+                let result = if is_streamed(&op, block_size) {
+                    stream_operation(&op, input, block_size, &file, &cancel)
+                        .map(|_| Decoded::Written)
+                } else {
+                    apply_operation(&op, input, block_size, &file, &cancel)
+                };
+                drop(slot);
+                (target, index, result)
+            });
+        }
+        drop(loaded);
+
+        while !tasks.is_empty() {
+            let output = join_next(&mut tasks).await?;
+            on_finished(&mut targets, output, reporter);
+        }
+
+        Ok(targets
+            .into_iter()
+            .map(|target| target.finish(reporter))
+            .collect())
+    }
+
+    async fn load<R: AsyncPayloadRead>(
+        &self,
+        read: usize,
+        reader: &R,
+        permit: BudgetPermit,
+    ) -> Result<Arc<SharedRead>> {
+        let read = &self.reads[read];
+        let data = reader.read_bytes(read.offset, read.length).await?;
+        stats::add(&STATS.sequential_reads, 1);
+        stats::add(&STATS.sequential_read_bytes, data.len() as u64);
+        Ok(Arc::new(SharedRead::new(data, permit)))
+    }
+}
+
+/// per-partition state of a pass
+struct Target<'a> {
+    partition: &'a PartitionUpdate,
+    file: Arc<OutputFile>,
+    size: Option<u64>,
+    expected_hash: Option<Vec<u8>>,
+    digest: Option<StreamDigest>,
+    /// finished out of order, waiting for an earlier operation to reach the digest
+    finished: BTreeMap<usize, Decoded>,
+    next_digest: usize,
+    completed: u64,
+    error: Option<anyhow::Error>,
+}
+
+impl<'a> Target<'a> {
+    fn open(partition: &'a PartitionUpdate, output: &PathBuf, block_size: u64) -> Result<Self> {
+        let info = partition.new_partition_info.as_ref();
+        let size = info.and_then(|i| i.size);
+        let expected_hash = info.and_then(|i| i.hash.clone()).filter(|h| !h.is_empty());
+
+        let file = OutputFile::create(output, size, block_size)?;
+
+        Ok(Self {
+            partition,
+            file: Arc::new(file),
+            size,
+            digest: expected_hash
+                .as_ref()
+                .map(|_| StreamDigest::new(block_size)),
+            expected_hash,
+            finished: BTreeMap::new(),
+            next_digest: 0,
+            completed: 0,
+            error: None,
+        })
+    }
+
+    fn name(&self) -> &str {
+        &self.partition.partition_name
+    }
+
+    fn total_operations(&self) -> u64 {
+        self.partition.operations.len() as u64
+    }
+
+    fn finish(self, reporter: &dyn ProgressReporter) -> Result<bool> {
+        if let Some(e) = self.error {
+            return Err(e);
+        }
+        self.file.flush()?;
+
+        let verified = self.digest.is_some();
+        if let (Some(d), Some(expected)) = (self.digest, self.expected_hash) {
+            let actual = d.finish(self.size);
+            if actual != expected {
+                return Err(anyhow!(
+                    "Hash mismatch for {}: expected {}, got {}",
+                    self.partition.partition_name,
+                    to_hex(&expected),
+                    to_hex(&actual)
+                ));
+            }
+        }
+
+        reporter.on_complete(&self.partition.partition_name, self.total_operations());
+        Ok(verified)
+    }
+}
+
+fn buffered(targets: &[Target<'_>]) -> usize {
+    targets.iter().map(|t| t.finished.len()).sum()
+}
+
+fn on_finished(targets: &mut [Target<'_>], output: TaskOutput, reporter: &dyn ProgressReporter) {
+    let (target, index, result) = output;
+    let t = &mut targets[target];
+    if t.error.is_some() {
+        return;
+    }
+
+    let decoded = match result {
+        Ok(decoded) => decoded,
+        Err(e) => {
+            t.error = Some(anyhow!("Operation {} failed: {}", index, e));
+            t.finished.clear();
+            return;
+        }
+    };
+    // the operation is in the image; a buffer kept only for the digest must
+    // not keep the read it came from, and with it its reservation, alive
+    let decoded = match t.digest {
+        None => Decoded::Zero,
+        Some(_) if index != t.next_digest => decoded.park(),
+        Some(_) => decoded,
+    };
+    t.finished.insert(index, decoded);
+
+    t.completed += 1;
+    reporter.on_progress(
+        t.partition.partition_name.as_str(),
+        t.completed,
+        t.total_operations(),
+    );
+
+    while let Some(decoded) = t.finished.remove(&t.next_digest) {
+        if let Some(d) = t.digest.as_mut() {
+            let extents = &t.partition.operations[t.next_digest].dst_extents;
+            match d.update_written(&t.file, extents, &decoded) {
+                Ok(true) => {}
+                Ok(false) => t.digest = None,
+                Err(e) => {
+                    t.error = Some(anyhow!(
+                        "Reading back {} failed: {}",
+                        t.partition.partition_name,
+                        e
+                    ));
+                    t.finished.clear();
+                    return;
+                }
+            }
+        }
+        t.next_digest += 1;
+    }
+}
+
+async fn join_next(tasks: &mut JoinSet<TaskOutput>) -> Result<TaskOutput> {
+    tasks
+        .join_next()
+        .await
+        .ok_or_else(|| anyhow!("No decode task in flight"))?
+        .map_err(|e| anyhow!("Decode task failed: {}", e))
+}
@@ -0,0 +1,313 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use crate::engine::{read_at, write_at};
+use crate::pool::{POOL, PooledBuf};
+use crate::stats::{self, STATS};
+use payload_dumper_core::structs::Extent;
+use std::fs::{File, OpenOptions};
+use std::io;
+use std::path::Path;
+use std::sync::Mutex;
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::time::Instant;
+
+/// alignment of offsets, lengths and buffers of unbuffered I/O; a multiple of
+/// every logical sector size in use
+const ALIGN: usize = 4096;
+
+/// writes shorter than this are staged and merged with the writes that
+/// continue them
+const STAGE_MAX: usize = 512 * 1024;
+
+/// size of the staging buffer, and of the bounce buffer of unbuffered writes
+/// from unaligned memory
+const STAGE_BYTES: usize = 4 * 1024 * 1024;
+
+/// images at least this large are written unbuffered, 0 never
+static DIRECT_MIN: AtomicU64 = AtomicU64::new(0);
+
+/// write images of at least `bytes` bypassing the page cache (O_DIRECT on
+/// Linux, FILE_FLAG_NO_BUFFERING on Windows), 0 turns it off
+///
+/// a multi-GB image written through the page cache pushes everything else
+/// out of it; written unbuffered it goes to the device at device speed and
+/// leaves the cache alone. where the filesystem refuses unbuffered I/O the
+/// image is written buffered.
+pub fn set_direct_threshold(bytes: u64) {
+    DIRECT_MIN.store(bytes, Ordering::Relaxed);
+}
+
+/// whether short writes of buffered images are merged
+static MERGE: AtomicBool = AtomicBool::new(true);
+
+/// merge short writes of buffered images, on by default
+///
+/// only there to measure what merging gains: turned off, every run of
+/// destination extents is written as it is decoded. unbuffered images merge
+/// regardless, their writes have to be aligned.
+pub fn set_merging(enabled: bool) {
+    MERGE.store(enabled, Ordering::Relaxed);
+}
+
+struct Staged {
+    /// file offset of buf[0]
+    start: u64,
+    len: usize,
+    buf: Option<PooledBuf>,
+}
+
+/// an extracted image, written by position from many decoders at once
+///
+/// destination extents that follow each other on disk are written with one
+/// call, and short writes that continue the previous one are gathered into a
+/// staging buffer and written together, so images made of many small
+/// operations still reach the disk in large aligned writes. decoders keep
+/// writing in parallel, which keeps several writes in flight.
+///
+/// staged data is only guaranteed on disk after flush(); read_exact_at()
+/// flushes first.
+pub struct OutputFile {
+    file: File,
+    direct: bool,
+    merge: bool,
+    staged: Mutex<Staged>,
+}
+
+impl OutputFile {
+    /// create (or truncate) `path`, sized to `size` when it is known
+    ///
+    /// a freshly truncated file reads back as zeros, ZERO and DISCARD are free
+    pub fn create(path: &Path, size: Option<u64>, block_size: u64) -> io::Result<Self> {
+        let threshold = DIRECT_MIN.load(Ordering::Relaxed);
+        let wanted =
+            threshold > 0 && size.is_some_and(|s| s >= threshold) && block_size % ALIGN as u64 == 0;
+
+        let (file, direct) = match wanted.then(|| open(path, true)) {
+            Some(Ok(opened)) => opened,
+            _ => open(path, false)?,
+        };
+        if let Some(size) = size {
+            file.set_len(size)?;
+        }
+        if direct {
+            stats::add(&STATS.output_direct_files, 1);
+        }
+
+        Ok(Self {
+            file,
+            direct,
+            merge: direct || MERGE.load(Ordering::Relaxed),
+            staged: Mutex::new(Staged {
+                start: 0,
+                len: 0,
+                buf: None,
+            }),
+        })
+    }
+
+    /// scatter `data`, which starts `skip` bytes into the output of an
+    /// operation, over the matching part of its destination extents
+    pub fn write_extents(
+        &self,
+        extents: &[Extent],
+        block_size: u64,
+        skip: u64,
+        data: &[u8],
+    ) -> io::Result<()> {
+        let end = skip + data.len() as u64;
+        let mut pos = 0u64;
+        // (file offset, data range) of the run being built
+        let mut run: Option<(u64, usize, usize)> = None;
+
+        for extent in extents {
+            if pos >= end {
+                break;
+            }
+            let len = extent.num_blocks() * block_size;
+            let from = pos.max(skip);
+            let to = (pos + len).min(end);
+            if from < to {
+                let offset = extent.start_block() * block_size + (from - pos);
+                let (a, b) = ((from - skip) as usize, (to - skip) as usize);
+                run = match run {
+                    Some((start, x, y)) if start + (y - x) as u64 == offset => Some((start, x, b)),
+                    Some((start, x, y)) => {
+                        self.write(start, &data[x..y])?;
+                        Some((offset, a, b))
+                    }
+                    None => Some((offset, a, b)),
+                };
+            }
+            pos += len;
+        }
+        if let Some((start, x, y)) = run {
+            self.write(start, &data[x..y])?;
+        }
+        Ok(())
+    }
+
+    fn write(&self, offset: u64, data: &[u8]) -> io::Result<()> {
+        if !self.merge || data.len() >= STAGE_MAX {
+            return self.write_now(offset, data);
+        }
+
+        let mut staged = self.staged.lock().unwrap();
+        let continues = staged.buf.is_some()
+            && staged.start + staged.len as u64 == offset
+            && staged.len + data.len() <= STAGE_BYTES;
+        if !continues {
+            self.flush_staged(&mut staged)?;
+            staged.start = offset;
+        } else {
+            stats::add(&STATS.output_merged_writes, 1);
+        }
+
+        let len = staged.len;
+        let buf = staged.buf.get_or_insert_with(|| POOL.get(STAGE_BYTES));
+        buf[len..len + data.len()].copy_from_slice(data);
+        staged.len += data.len();
+        if staged.len + STAGE_MAX > STAGE_BYTES {
+            self.flush_staged(&mut staged)?;
+        }
+        Ok(())
+    }
+
+    fn flush_staged(&self, staged: &mut Staged) -> io::Result<()> {
+        let len = std::mem::take(&mut staged.len);
+        match staged.buf.as_mut() {
+            Some(buf) if len > 0 => {
+                if self.direct {
+                    // the rest of the last block belongs to the same
+                    // operation and is zeros
+                    let padded = len.next_multiple_of(ALIGN);
+                    buf[len..padded].fill(0);
+                    self.write_now(staged.start, &buf[..padded])
+                } else {
+                    self.write_now(staged.start, &buf[..len])
+                }
+            }
+            _ => Ok(()),
+        }
+    }
+
+    fn write_now(&self, offset: u64, data: &[u8]) -> io::Result<()> {
+        let started = Instant::now();
+        let aligned = data.as_ptr() as usize % ALIGN == 0 && data.len() % ALIGN == 0;
+        if !self.direct || aligned {
+            write_at(&self.file, data, offset)?;
+        } else {
+            // unbuffered writes need aligned memory; copy through a pooled
+            // buffer, which is page aligned
+            let mut bounce = POOL.get(STAGE_BYTES);
+            let mut done = 0;
+            while done < data.len() {
+                let n = (data.len() - done).min(STAGE_BYTES);
+                let padded = n.next_multiple_of(ALIGN);
+                bounce[..n].copy_from_slice(&data[done..done + n]);
+                bounce[n..padded].fill(0);
+                write_at(&self.file, &bounce[..padded], offset + done as u64)?;
+                done += n;
+            }
+        }
+        stats::add(&STATS.output_writes, 1);
+        stats::add(&STATS.output_write_bytes, data.len() as u64);
+        stats::add(&STATS.output_write_us, started.elapsed().as_micros() as u64);
+        Ok(())
+    }
+
+    /// write out whatever is staged
+    pub fn flush(&self) -> io::Result<()> {
+        let mut staged = self.staged.lock().unwrap();
+        self.flush_staged(&mut staged)?;
+        // the staging buffer goes back to the pool between bursts
+        staged.buf = None;
+        Ok(())
+    }
+
+    /// read back bytes already written; `buf` must be a pooled buffer and
+    /// `offset` and its length multiples of the block size
+    pub fn read_exact_at(&self, buf: &mut [u8], offset: u64) -> io::Result<()> {
+        self.flush()?;
+        read_at(&self.file, buf, offset)
+    }
+}
+
+/// readable too, operations decoded straight to disk are hashed from it;
+/// returns whether the file is unbuffered
+fn open(path: &Path, direct: bool) -> io::Result<(File, bool)> {
+    let mut options = OpenOptions::new();
+    options.create(true).read(true).write(true).truncate(true);
+    let direct = direct && unbuffered(&mut options);
+    Ok((options.open(path)?, direct))
+}
+
+#[cfg(any(target_os = "linux", target_os = "android"))]
+fn unbuffered(options: &mut OpenOptions) -> bool {
+    use std::os::unix::fs::OpenOptionsExt;
+    options.custom_flags(libc::O_DIRECT);
+    true
+}
+
+#[cfg(windows)]
+fn unbuffered(options: &mut OpenOptions) -> bool {
+    use std::os::windows::fs::OpenOptionsExt;
+    const FILE_FLAG_NO_BUFFERING: u32 = 0x2000_0000;
+    options.custom_flags(FILE_FLAG_NO_BUFFERING);
+    true
+}
+
+/// elsewhere the page cache cannot be bypassed at open time
+#[cfg(not(any(target_os = "linux", target_os = "android", windows)))]
+fn unbuffered(_options: &mut OpenOptions) -> bool {
+    false
+}
+
+#[cfg(test)]
+mod tests {
+    use super::OutputFile;
+    use payload_dumper_core::structs::Extent;
+
+    const BLOCK: u64 = 4096;
+
+    fn extent(start_block: u64, num_blocks: u64) -> Extent {
+        Extent {
+            start_block: Some(start_block),
+            num_blocks: Some(num_blocks),
+        }
+    }
+
+    #[test]
+    fn short_writes_are_merged_and_land_where_they_belong() {
+        let path = std::env::temp_dir().join(format!("payload-output-test-{}", std::process::id()));
+        let file = OutputFile::create(&path, Some(64 * BLOCK), BLOCK).unwrap();
+        let mut expected = vec![0u8; 64 * BLOCK as usize];
+
+        // one-block operations front to back end up in one staged write
+        for block in 0..16u64 {
+            let data = vec![block as u8 + 1; BLOCK as usize];
+            file.write_extents(&[extent(block, 1)], BLOCK, 0, &data)
+                .unwrap();
+            expected[(block * BLOCK) as usize..((block + 1) * BLOCK) as usize]
+                .copy_from_slice(&data);
+        }
+        assert_eq!(file.staged.lock().unwrap().len, 16 * BLOCK as usize);
+
+        // an operation over two extents, written in two chunks
+        let data: Vec<u8> = (0..3 * BLOCK).map(|i| (i % 251) as u8).collect();
+        let extents = [extent(40, 2), extent(50, 1)];
+        let (first, second) = data.split_at(BLOCK as usize + 100);
+        file.write_extents(&extents, BLOCK, 0, first).unwrap();
+        file.write_extents(&extents, BLOCK, first.len() as u64, second)
+            .unwrap();
+        expected[(40 * BLOCK) as usize..(42 * BLOCK) as usize]
+            .copy_from_slice(&data[..2 * BLOCK as usize]);
+        expected[(50 * BLOCK) as usize..(51 * BLOCK) as usize]
+            .copy_from_slice(&data[2 * BLOCK as usize..]);
+
+        file.flush().unwrap();
+        drop(file);
+        assert!(std::fs::read(&path).unwrap() == expected);
+        std::fs::remove_file(&path).unwrap();
+    }
+}
@@ -0,0 +1,249 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use crate::profile;
+use crate::stats::{self, STATS};
+use once_cell::sync::Lazy;
+use std::alloc::{self, Layout};
+use std::ops::{Deref, DerefMut};
+use std::ptr::NonNull;
+use std::sync::Mutex;
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+
+pub static POOL: Lazy<BufferPool> = Lazy::new(BufferPool::new);
+
+/// idle memory kept for reuse unless configured otherwise
+pub const DEFAULT_RETAIN_LIMIT: u64 = 256 * 1024 * 1024;
+/// the same in the low-memory profile
+const LOW_MEMORY_RETAIN_LIMIT: u64 = 16 * 1024 * 1024;
+
+/// retain limit of the active profile
+pub fn default_retain_limit() -> u64 {
+    if profile::low_memory() {
+        LOW_MEMORY_RETAIN_LIMIT
+    } else {
+        DEFAULT_RETAIN_LIMIT
+    }
+}
+
+/// smallest pooled class, every class doubles the previous one
+const MIN_CLASS: usize = 64 * 1024;
+/// 64 KiB .. 64 MiB
+const CLASS_COUNT: usize = 11;
+/// buffers are page aligned so they can be used for unbuffered I/O as well
+const PAGE_ALIGN: usize = 4096;
+const HUGE_PAGE: usize = 2 * 1024 * 1024;
+
+struct RawBuf {
+    ptr: NonNull<u8>,
+    layout: Layout,
+}
+
+// the buffer is plain owned memory, it is only ever accessed through &/&mut
+unsafe impl Send for RawBuf {}
+unsafe impl Sync for RawBuf {}
+
+impl RawBuf {
+    fn new(capacity: usize, huge_pages: bool) -> Self {
+        let align = if huge_pages && capacity >= HUGE_PAGE {
+            HUGE_PAGE
+        } else {
+            PAGE_ALIGN
+        };
+        let layout =
+            Layout::from_size_align(capacity.max(1), align).expect("Invalid buffer layout");
+
+        // zeroed so a fresh buffer never exposes uninitialized memory
+        let ptr = unsafe { alloc::alloc_zeroed(layout) };
+        let ptr = NonNull::new(ptr).unwrap_or_else(|| alloc::handle_alloc_error(layout));
+
+        #[cfg(target_os = "linux")]
+        if align == HUGE_PAGE {
+            unsafe {
+                libc::madvise(
+                    ptr.as_ptr() as *mut libc::c_void,
+                    layout.size(),
+                    libc::MADV_HUGEPAGE,
+                );
+            }
+        }
+
+        Self { ptr, layout }
+    }
+
+    fn capacity(&self) -> usize {
+        self.layout.size()
+    }
+}
+
+impl Drop for RawBuf {
+    fn drop(&mut self) {
+        unsafe { alloc::dealloc(self.ptr.as_ptr(), self.layout) };
+    }
+}
+
+/// size-classed free lists shared by every extraction job
+///
+/// buffers are handed out as PooledBuf and go back to their class on drop, so
+/// the decode and write buffers of one operation are reused by the next one,
+/// across partitions and jobs. requests larger than the biggest class are
+/// allocated and freed directly.
+pub struct BufferPool {
+    classes: Vec<Mutex<Vec<RawBuf>>>,
+    retained: AtomicU64,
+    retain_limit: AtomicU64,
+    /// set through set_retain_limit(), a profile switch leaves it alone
+    retain_explicit: AtomicBool,
+    huge_pages: AtomicBool,
+}
+
+impl BufferPool {
+    fn new() -> Self {
+        Self {
+            classes: (0..CLASS_COUNT).map(|_| Mutex::new(Vec::new())).collect(),
+            retained: AtomicU64::new(0),
+            retain_limit: AtomicU64::new(default_retain_limit()),
+            retain_explicit: AtomicBool::new(false),
+            huge_pages: AtomicBool::new(false),
+        }
+    }
+
+    /// upper bound on idle memory kept in the free lists
+    pub fn set_retain_limit(&self, bytes: u64) {
+        self.retain_explicit.store(true, Ordering::Relaxed);
+        self.store_retain_limit(bytes);
+    }
+
+    /// go back to the retain limit of the active profile
+    pub(crate) fn set_default_retain_limit(&self) {
+        self.retain_explicit.store(false, Ordering::Relaxed);
+        self.store_retain_limit(default_retain_limit());
+    }
+
+    /// take the retain limit of a newly switched profile, unless one was set
+    pub(crate) fn apply_profile(&self) {
+        if !self.retain_explicit.load(Ordering::Relaxed) {
+            self.store_retain_limit(default_retain_limit());
+        }
+    }
+
+    fn store_retain_limit(&self, bytes: u64) {
+        self.retain_limit.store(bytes, Ordering::Relaxed);
+        if bytes == 0 {
+            self.trim();
+        }
+    }
+
+    /// back buffers of 2 MiB and more with transparent huge pages (Linux only)
+    pub fn set_huge_pages(&self, enabled: bool) {
+        self.huge_pages.store(enabled, Ordering::Relaxed);
+    }
+
+    /// drop every idle buffer
+    pub fn trim(&self) {
+        for class in &self.classes {
+            let freed: Vec<RawBuf> = std::mem::take(&mut *class.lock().unwrap());
+            let bytes: u64 = freed.iter().map(|b| b.capacity() as u64).sum();
+            self.retained.fetch_sub(bytes, Ordering::Relaxed);
+        }
+        stats::set(
+            &STATS.pool_retained_bytes,
+            self.retained.load(Ordering::Relaxed),
+        );
+    }
+
+    fn class_of(len: usize) -> Option<usize> {
+        let class = len.max(MIN_CLASS).next_power_of_two().trailing_zeros() as usize
+            - MIN_CLASS.trailing_zeros() as usize;
+        (class < CLASS_COUNT).then_some(class)
+    }
+
+    /// get a buffer of exactly `len` bytes, its contents are unspecified
+    pub fn get(&'static self, len: usize) -> PooledBuf {
+        let class = Self::class_of(len);
+
+        let reused = class.and_then(|c| self.classes[c].lock().unwrap().pop());
+        let raw = match reused {
+            Some(raw) => {
+                let retained = self
+                    .retained
+                    .fetch_sub(raw.capacity() as u64, Ordering::Relaxed);
+                stats::set(
+                    &STATS.pool_retained_bytes,
+                    retained.saturating_sub(raw.capacity() as u64),
+                );
+                stats::add(&STATS.pool_reuses, 1);
+                raw
+            }
+            None => {
+                let capacity = class.map(|c| MIN_CLASS << c).unwrap_or(len);
+                stats::add(&STATS.pool_allocations, 1);
+                RawBuf::new(capacity, self.huge_pages.load(Ordering::Relaxed))
+            }
+        };
+
+        PooledBuf {
+            pool: self,
+            raw: Some(raw),
+            len,
+            class,
+        }
+    }
+
+    fn put(&self, raw: RawBuf, class: usize) {
+        // counted before it becomes visible, so a get() taking it right away
+        // never subtracts more than was added
+        let size = raw.capacity() as u64;
+        let retained = self.retained.fetch_add(size, Ordering::Relaxed) + size;
+        if retained > self.retain_limit.load(Ordering::Relaxed) {
+            self.retained.fetch_sub(size, Ordering::Relaxed);
+            return;
+        }
+        self.classes[class].lock().unwrap().push(raw);
+        stats::set(&STATS.pool_retained_bytes, retained);
+    }
+}
+
+/// buffer borrowed from the pool, returned to it on drop
+pub struct PooledBuf {
+    pool: &'static BufferPool,
+    raw: Option<RawBuf>,
+    len: usize,
+    class: Option<usize>,
+}
+
+impl PooledBuf {
+    pub fn capacity(&self) -> usize {
+        self.raw.as_ref().map(|r| r.capacity()).unwrap_or(0)
+    }
+
+    /// shrink or grow the visible length within the capacity
+    pub fn set_len(&mut self, len: usize) {
+        assert!(len <= self.capacity(), "length exceeds buffer capacity");
+        self.len = len;
+    }
+}
+
+impl Deref for PooledBuf {
+    type Target = [u8];
+
+    fn deref(&self) -> &[u8] {
+        let raw = self.raw.as_ref().unwrap();
+        unsafe { std::slice::from_raw_parts(raw.ptr.as_ptr(), self.len) }
+    }
+}
+
+impl DerefMut for PooledBuf {
+    fn deref_mut(&mut self) -> &mut [u8] {
+        let raw = self.raw.as_ref().unwrap();
+        unsafe { std::slice::from_raw_parts_mut(raw.ptr.as_ptr(), self.len) }
+    }
+}
+
+impl Drop for PooledBuf {
+    fn drop(&mut self) {
+        if let (Some(raw), Some(class)) = (self.raw.take(), self.class) {
+            self.pool.put(raw, class);
+        }
+    }
+}
@@ -0,0 +1,304 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use crate::budget::{BUDGET, BudgetPermit};
+use crate::profile;
+use crate::source::RangeSource;
+use crate::stats::{self, STATS};
+use anyhow::{Result, anyhow};
+use payload_dumper_core::payload::payload_dumper::AsyncPayloadRead;
+use payload_dumper_core::structs::PartitionUpdate;
+use std::collections::HashMap;
+use std::sync::{Arc, Mutex};
+use std::time::{Duration, Instant};
+use tokio::task::JoinHandle;
+
+/// limits for the read-ahead window of a single partition job
+#[derive(Debug, Clone, Copy)]
+pub struct PrefetchConfig {
+    /// upper bound on bytes held by requests that are in flight or not yet consumed
+    pub memory_cap: u64,
+    /// upper bound on concurrent ranged requests
+    pub max_requests: usize,
+    /// window used before the link has been measured
+    pub min_window: u64,
+}
+
+impl Default for PrefetchConfig {
+    /// the defaults of the active profile
+    fn default() -> Self {
+        if profile::low_memory() {
+            return Self {
+                memory_cap: 8 * 1024 * 1024,
+                max_requests: 4,
+                min_window: 512 * 1024,
+            };
+        }
+        Self {
+            memory_cap: 64 * 1024 * 1024,
+            max_requests: 16,
+            min_window: 1024 * 1024,
+        }
+    }
+}
+
+/// settings used by every remote extraction, None until payload_init_ex()
+static CONFIGURED: Mutex<Option<PrefetchConfig>> = Mutex::new(None);
+
+impl PrefetchConfig {
+    /// the process-wide settings, or the defaults when none were set
+    pub fn configured() -> Self {
+        CONFIGURED.lock().unwrap().unwrap_or_default()
+    }
+
+    pub fn set_configured(config: Self) {
+        *CONFIGURED.lock().unwrap() = Some(config);
+    }
+}
+
+/// tracks round-trip time and bandwidth from completed requests
+///
+/// every request is modelled as `elapsed = rtt + bytes / bandwidth`; rtt follows
+/// the fastest request seen (drifting up slowly so a route change is noticed),
+/// bandwidth is an EWMA over requests large enough to say something about it
+#[derive(Debug, Default)]
+struct LinkEstimator {
+    rtt: Option<f64>,
+    bandwidth: Option<f64>,
+}
+
+impl LinkEstimator {
+    const BANDWIDTH_SAMPLE_MIN: u64 = 64 * 1024;
+
+    fn observe(&mut self, bytes: u64, elapsed: Duration) {
+        let secs = elapsed.as_secs_f64().max(1e-6);
+
+        let rtt = match self.rtt {
+            Some(rtt) if secs >= rtt => rtt * 0.98 + secs * 0.02,
+            _ => secs,
+        };
+        self.rtt = Some(rtt);
+
+        if bytes >= Self::BANDWIDTH_SAMPLE_MIN {
+            let transfer = (secs - rtt).max(secs * 0.1);
+            let sample = bytes as f64 / transfer;
+            self.bandwidth = Some(match self.bandwidth {
+                Some(bw) => bw * 0.75 + sample * 0.25,
+                None => sample,
+            });
+        }
+
+        stats::set(&STATS.remote_rtt_us, (rtt * 1e6) as u64);
+        if let Some(bw) = self.bandwidth {
+            stats::set(&STATS.remote_throughput_bps, bw as u64);
+        }
+    }
+
+    /// twice the bandwidth-delay product, so the pipe stays full while the
+    /// consumer is busy decoding the previous operation
+    fn window(&self, config: &PrefetchConfig) -> u64 {
+        match (self.rtt, self.bandwidth) {
+            (Some(rtt), Some(bw)) => {
+                ((bw * rtt * 2.0) as u64).clamp(config.min_window, config.memory_cap)
+            }
+            _ => config.min_window.min(config.memory_cap),
+        }
+    }
+}
+
+/// the blobs of a partition in the order dump_partition reads them
+pub fn operation_plan(partition: &PartitionUpdate, data_offset: u64) -> Vec<(u64, u64)> {
+    partition
+        .operations
+        .iter()
+        .filter(|op| op.data_length() > 0)
+        .map(|op| (data_offset + op.data_offset(), op.data_length()))
+        .collect()
+}
+
+struct Fetched {
+    data: Vec<u8>,
+    elapsed: Duration,
+}
+
+struct Pending {
+    handle: JoinHandle<Result<Fetched>>,
+    length: u64,
+    _permit: BudgetPermit,
+}
+
+#[derive(Default)]
+struct State {
+    cursor: usize,
+    pending: HashMap<usize, Pending>,
+    pending_bytes: u64,
+    link: LinkEstimator,
+}
+
+/// read-ahead wrapper for the remote readers
+///
+/// the operation list of a partition is known up front, so while dump_partition
+/// works on one operation the blobs of the following ones are already being
+/// fetched. reads that do not match the plan fall through to the inner reader.
+pub struct PrefetchReader<R: RangeSource> {
+    inner: Arc<R>,
+    plan: Vec<(u64, u64)>,
+    index: HashMap<u64, usize>,
+    config: PrefetchConfig,
+    state: Mutex<State>,
+}
+
+impl<R: RangeSource> PrefetchReader<R> {
+    pub fn new(inner: R, partition: &PartitionUpdate, data_offset: u64) -> Self {
+        Self::with_config(inner, partition, data_offset, PrefetchConfig::configured())
+    }
+
+    pub fn with_config(
+        inner: R,
+        partition: &PartitionUpdate,
+        data_offset: u64,
+        config: PrefetchConfig,
+    ) -> Self {
+        Self::with_plan(
+            Arc::new(inner),
+            operation_plan(partition, data_offset),
+            config,
+        )
+    }
+
+    /// read ahead along an arbitrary list of (offset, length) reads, sharing
+    /// `inner` with other readers
+    pub fn with_plan(inner: Arc<R>, plan: Vec<(u64, u64)>, config: PrefetchConfig) -> Self {
+        let mut index = HashMap::with_capacity(plan.len());
+        for (i, (offset, _)) in plan.iter().enumerate() {
+            index.entry(*offset).or_insert(i);
+        }
+
+        Self {
+            inner,
+            plan,
+            index,
+            config,
+            state: Mutex::new(State::default()),
+        }
+    }
+
+    fn top_up(&self, state: &mut State) {
+        let window = state.link.window(&self.config);
+        stats::set(&STATS.prefetch_window_bytes, window);
+
+        while state.cursor < self.plan.len() && state.pending.len() < self.config.max_requests {
+            let (offset, length) = self.plan[state.cursor];
+
+            if length > self.config.memory_cap {
+                // never held ahead of time, read on demand instead
+                state.cursor += 1;
+                continue;
+            }
+            if state.pending_bytes + length > window && !state.pending.is_empty() {
+                break;
+            }
+            let Some(permit) = BUDGET.try_acquire_soft(length) else {
+                break;
+            };
+
+            let inner = Arc::clone(&self.inner);
+            let handle = tokio::spawn(async move {
+                let start = Instant::now();
+                let data = inner.fetch(offset, length).await?;
+                Ok(Fetched {
+                    data,
+                    elapsed: start.elapsed(),
+                })
+            });
+
+            state.pending.insert(
+                state.cursor,
+                Pending {
+                    handle,
+                    length,
+                    _permit: permit,
+                },
+            );
+            state.pending_bytes += length;
+            stats::add(&STATS.prefetch_bytes, length);
+            state.cursor += 1;
+        }
+    }
+
+    fn observe(&self, bytes: u64, elapsed: Duration) {
+        let mut state = self.state.lock().unwrap();
+        state.link.observe(bytes, elapsed);
+    }
+}
+
+impl<R: RangeSource> AsyncPayloadRead for PrefetchReader<R> {
+    async fn read_bytes(&self, offset: u64, length: u64) -> Result<Vec<u8>> {
+        let pending = {
+            let mut state = self.state.lock().unwrap();
+            let idx = self.index.get(&offset).copied();
+
+            let pending = idx.and_then(|i| state.pending.remove(&i));
+            if let Some(p) = &pending {
+                state.pending_bytes -= p.length;
+            }
+
+            if let Some(i) = idx {
+                // anything before the current operation will never be asked for
+                let mut dropped = 0;
+                state.pending.retain(|&k, p| {
+                    if k < i {
+                        p.handle.abort();
+                        dropped += p.length;
+                        false
+                    } else {
+                        true
+                    }
+                });
+                state.pending_bytes -= dropped;
+                state.cursor = state.cursor.max(i + 1);
+            }
+
+            self.top_up(&mut state);
+            pending
+        };
+
+        match pending {
+            Some(p) if p.length == length => {
+                if p.handle.is_finished() {
+                    stats::add(&STATS.prefetch_hits, 1);
+                } else {
+                    stats::add(&STATS.prefetch_stalls, 1);
+                }
+
+                let fetched = p
+                    .handle
+                    .await
+                    .map_err(|e| anyhow!("Prefetch task failed: {}", e))??;
+                self.observe(length, fetched.elapsed);
+                Ok(fetched.data)
+            }
+            other => {
+                if let Some(p) = other {
+                    p.handle.abort();
+                }
+                stats::add(&STATS.prefetch_misses, 1);
+
+                let start = Instant::now();
+                let data = self.inner.fetch(offset, length).await?;
+                self.observe(length, start.elapsed());
+                Ok(data)
+            }
+        }
+    }
+}
+
+impl<R: RangeSource> Drop for PrefetchReader<R> {
+    fn drop(&mut self) {
+        if let Ok(state) = self.state.get_mut() {
+            for p in state.pending.values() {
+                p.handle.abort();
+            }
+        }
+    }
+}
@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use crate::budget::BUDGET;
+use crate::pool::POOL;
+use crate::runtime::RUNTIME;
+use crate::scheduler::SCHEDULER;
+use anyhow::Result;
+use std::sync::atomic::{AtomicBool, Ordering};
+
+/// on by default where the address space is 32 bits; a few hundred MiB of
+/// buffers and thread stacks is all such a process can count on
+static LOW_MEMORY: AtomicBool = AtomicBool::new(cfg!(target_pointer_width = "32"));
+
+/// operations a job keeps in flight in the low-memory profile
+const LOW_MEMORY_IN_FLIGHT: usize = 2;
+
+/// true when the low-memory profile is active
+///
+/// the profile trades throughput for a small, predictable footprint: two
+/// async workers and a small blocking pool, two decoders, two operations in
+/// flight per job, short reads and read-ahead, a small buffer pool, a memory
+/// budget by default, and large compressed operations decoded straight to
+/// disk in chunks instead of into one buffer. settings given explicitly
+/// still win over these defaults.
+pub fn low_memory() -> bool {
+    LOW_MEMORY.load(Ordering::Relaxed)
+}
+
+/// switch the low-memory profile on or off and apply its defaults
+///
+/// fails while an extraction is running, the runtime can only be rebuilt
+/// when idle; call it before starting any work. the decode limit, the buffer
+/// pool and the memory budget take the defaults of the profile unless they
+/// were set explicitly.
+pub fn set_low_memory(enabled: bool) -> Result<()> {
+    let was = LOW_MEMORY.swap(enabled, Ordering::Relaxed);
+    if let Err(e) = RUNTIME.configure(RUNTIME.config()) {
+        LOW_MEMORY.store(was, Ordering::Relaxed);
+        return Err(e);
+    }
+    SCHEDULER.apply_profile();
+    POOL.apply_profile();
+    BUDGET.apply_profile();
+    Ok(())
+}
+
+/// operations one job decodes ahead of its writer
+pub(crate) fn in_flight() -> usize {
+    if low_memory() {
+        LOW_MEMORY_IN_FLIGHT
+    } else {
+        num_cpus::get().max(1) * 2
+    }
+}
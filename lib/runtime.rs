@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use crate::profile;
+use anyhow::{Result, anyhow};
+use once_cell::sync::Lazy;
+use std::future::Future;
+use std::sync::{Arc, Mutex};
+use std::time::Duration;
+use tokio::runtime::{Builder, Runtime};
+
+pub static RUNTIME: Lazy<ManagedRuntime> = Lazy::new(ManagedRuntime::new);
+
+/// thread counts of the tokio runtime, 0 picks the default
+#[derive(Debug, Clone, Copy, Default)]
+pub struct RuntimeConfig {
+    /// async workers driving I/O and task scheduling (default: one per core, at least 2)
+    pub worker_threads: usize,
+    /// upper bound on the pool that runs decoders and blocking writes (default: 512)
+    pub max_blocking_threads: usize,
+}
+
+/// the runtime every blocking entry point of the library runs on
+///
+/// it is built on first use from the current configuration and can be shut
+/// down again, which joins its threads; the next call builds a fresh one.
+/// callers share it through an Arc, so shutting down while an extraction is
+/// running only drops our reference and the last caller tears it down.
+pub struct ManagedRuntime {
+    config: Mutex<RuntimeConfig>,
+    current: Mutex<Option<Arc<Runtime>>>,
+}
+
+impl ManagedRuntime {
+    fn new() -> Self {
+        Self {
+            config: Mutex::new(RuntimeConfig::default()),
+            current: Mutex::new(None),
+        }
+    }
+
+    /// use `config` for the runtime; an idle runtime is rebuilt with it, a
+    /// busy one is left alone and the call fails
+    pub fn configure(&self, config: RuntimeConfig) -> Result<()> {
+        let old = {
+            let mut current = self.current.lock().unwrap();
+            if current.as_ref().is_some_and(|rt| Arc::strong_count(rt) > 1) {
+                return Err(anyhow!("Runtime is busy, finish running extractions first"));
+            }
+            *self.config.lock().unwrap() = config;
+            current.take()
+        };
+        // joined without the lock, so a thread of the old runtime that
+        // reaches for RUNTIME while shutting down cannot deadlock on it
+        if let Some(rt) = old.and_then(Arc::into_inner) {
+            rt.shutdown_timeout(Duration::from_secs(1));
+        }
+        Ok(())
+    }
+
+    pub fn config(&self) -> RuntimeConfig {
+        *self.config.lock().unwrap()
+    }
+
+    /// run `fut` to completion on the runtime, building it if needed
+    pub fn block_on<F: Future>(&self, fut: F) -> F::Output {
+        let rt = self.get();
+        rt.block_on(fut)
+    }
+
+    fn get(&self) -> Arc<Runtime> {
+        let mut current = self.current.lock().unwrap();
+        if let Some(rt) = current.as_ref() {
+            return Arc::clone(rt);
+        }
+        let rt = Arc::new(build(self.config()));
+        *current = Some(Arc::clone(&rt));
+        rt
+    }
+
+    /// stop the runtime and join its threads, waiting at most `timeout` for
+    /// blocking tasks; a runtime still in use stops when its last caller returns
+    pub fn shutdown(&self, timeout: Duration) {
+        let rt = self.current.lock().unwrap().take();
+        if let Some(rt) = rt.and_then(Arc::into_inner) {
+            rt.shutdown_timeout(timeout);
+        }
+    }
+}
+
+/// async workers and blocking threads in the low-memory profile; every
+/// thread reserves its own stack
+const LOW_MEMORY_WORKERS: usize = 2;
+const LOW_MEMORY_BLOCKING_THREADS: usize = 8;
+
+fn build(config: RuntimeConfig) -> Runtime {
+    let low_memory = profile::low_memory();
+    let workers = match config.worker_threads {
+        0 if low_memory => LOW_MEMORY_WORKERS,
+        0 => num_cpus::get().max(2),
+        n => n,
+    };
+    let mut builder = Builder::new_multi_thread();
+    builder
+        .worker_threads(workers)
+        .thread_name("payload-worker")
+        .enable_all();
+    match config.max_blocking_threads {
+        0 if low_memory => {
+            builder.max_blocking_threads(LOW_MEMORY_BLOCKING_THREADS);
+        }
+        0 => {}
+        n => {
+            builder.max_blocking_threads(n);
+        }
+    }
+    builder.build().expect("Failed to create tokio runtime")
+}
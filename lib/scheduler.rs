@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use crate::budget::WaitGuard;
+use crate::profile;
+use once_cell::sync::Lazy;
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::{Arc, Mutex};
+use tokio::sync::Notify;
+
+/// global limits shared by every extraction, whichever payload it belongs to
+///
+/// callers may start as many extractions as they like (one per partition, from
+/// any number of payloads); jobs queue here instead of oversubscribing the
+/// machine. a job holds its network slot (remote sources only) and its disk
+/// slot for its whole lifetime and decode slots per operation. slots are
+/// always taken in that order, so jobs never wait on each other in a cycle.
+pub static SCHEDULER: Lazy<Scheduler> = Lazy::new(Scheduler::new);
+
+pub struct Scheduler {
+    /// partitions being written at the same time
+    pub disk: Limiter,
+    /// remote partitions being downloaded at the same time
+    pub network: Limiter,
+    /// operations being decoded at the same time
+    pub decode: Limiter,
+    /// decode limit given to set_limits(), a profile switch leaves it alone
+    decode_explicit: AtomicBool,
+}
+
+impl Scheduler {
+    fn new() -> Self {
+        Self {
+            disk: Limiter::new(0),
+            network: Limiter::new(0),
+            decode: Limiter::new(default_decode_slots()),
+            decode_explicit: AtomicBool::new(false),
+        }
+    }
+
+    /// 0 leaves disk and network unlimited and decode at one slot per core
+    pub fn set_limits(&self, disk: u64, network: u64, decode: u64) {
+        self.disk.set_limit(disk);
+        self.network.set_limit(network);
+        self.decode_explicit.store(decode != 0, Ordering::Relaxed);
+        self.decode.set_limit(if decode == 0 {
+            default_decode_slots()
+        } else {
+            decode
+        });
+    }
+
+    /// take the decode limit of a newly switched profile, unless one was set
+    pub(crate) fn apply_profile(&self) {
+        if !self.decode_explicit.load(Ordering::Relaxed) {
+            self.decode.set_limit(default_decode_slots());
+        }
+    }
+}
+
+/// decoders running at once in the low-memory profile
+const LOW_MEMORY_DECODE_SLOTS: u64 = 2;
+
+pub(crate) fn default_decode_slots() -> u64 {
+    if profile::low_memory() {
+        return LOW_MEMORY_DECODE_SLOTS;
+    }
+    num_cpus::get().max(1) as u64
+}
+
+/// counting semaphore whose size can change while jobs are waiting on it
+pub struct Limiter {
+    limit: AtomicU64,
+    active: Mutex<u64>,
+    released: Notify,
+    waiting: AtomicU64,
+}
+
+impl Limiter {
+    pub(crate) fn new(limit: u64) -> Self {
+        Self {
+            limit: AtomicU64::new(limit),
+            active: Mutex::new(0),
+            released: Notify::new(),
+            waiting: AtomicU64::new(0),
+        }
+    }
+
+    /// set the number of slots, 0 disables the limit
+    pub fn set_limit(&self, slots: u64) {
+        self.limit.store(slots, Ordering::Relaxed);
+        self.released.notify_waiters();
+    }
+
+    pub fn limit(&self) -> u64 {
+        self.limit.load(Ordering::Relaxed)
+    }
+
+    pub fn active(&self) -> u64 {
+        *self.active.lock().unwrap()
+    }
+
+    pub fn waiting(&self) -> u64 {
+        self.waiting.load(Ordering::Relaxed)
+    }
+
+    fn try_take(&self) -> bool {
+        let limit = self.limit();
+        let mut active = self.active.lock().unwrap();
+        if limit != 0 && *active >= limit {
+            return false;
+        }
+        *active += 1;
+        true
+    }
+
+    fn give_back(&self) {
+        *self.active.lock().unwrap() -= 1;
+        self.released.notify_waiters();
+    }
+
+    /// take a slot, waiting for one to be released if needed
+    pub async fn acquire(&'static self) -> Slot {
+        self.take().await;
+        Slot { limiter: self }
+    }
+
+    /// acquire() for a limiter that lives only as long as its users
+    pub(crate) async fn acquire_owned(self: Arc<Self>) -> OwnedSlot {
+        self.take().await;
+        OwnedSlot { limiter: self }
+    }
+
+    async fn take(&self) {
+        let mut waiter: Option<WaitGuard> = None;
+        loop {
+            let notified = self.released.notified();
+            tokio::pin!(notified);
+            notified.as_mut().enable();
+
+            if self.try_take() {
+                drop(waiter);
+                return;
+            }
+
+            if waiter.is_none() {
+                waiter = Some(WaitGuard::new(&self.waiting));
+            }
+            notified.await;
+        }
+    }
+}
+
+/// slot taken from a Limiter, given back on drop
+pub struct Slot {
+    limiter: &'static Limiter,
+}
+
+impl Drop for Slot {
+    fn drop(&mut self) {
+        self.limiter.give_back();
+    }
+}
+
+/// slot taken from a shared Limiter, given back on drop
+pub(crate) struct OwnedSlot {
+    limiter: Arc<Limiter>,
+}
+
+impl Drop for OwnedSlot {
+    fn drop(&mut self) {
+        self.limiter.give_back();
+    }
+}
@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use crate::cache::to_hex;
+use anyhow::Result;
+use std::fs;
+use std::path::{Path, PathBuf};
+use std::time::UNIX_EPOCH;
+
+/// small record next to an image: `<image>.digest.json`
+///
+/// it states that the image had `size` bytes and mtime `modified_ns` when its
+/// SHA-256 was verified. as long as size and mtime still match, the image can
+/// be trusted without reading it again.
+#[derive(Debug, Clone, serde::Serialize, serde::Deserialize)]
+struct Sidecar {
+    size: u64,
+    modified_ns: u128,
+    sha256: String,
+}
+
+pub fn sidecar_path(image: &Path) -> PathBuf {
+    let mut name = image.as_os_str().to_owned();
+    name.push(".digest.json");
+    PathBuf::from(name)
+}
+
+fn stamp(image: &Path) -> Option<(u64, u128)> {
+    let meta = fs::metadata(image).ok()?;
+    let modified = meta.modified().ok()?.duration_since(UNIX_EPOCH).ok()?;
+    Some((meta.len(), modified.as_nanos()))
+}
+
+/// record that `image` currently hashes to `sha256`
+pub fn write(image: &Path, sha256: &[u8]) -> Result<()> {
+    let (size, modified_ns) =
+        stamp(image).ok_or_else(|| anyhow::anyhow!("Cannot stat {}", image.display()))?;
+    let sidecar = Sidecar {
+        size,
+        modified_ns,
+        sha256: to_hex(sha256),
+    };
+    fs::write(sidecar_path(image), serde_json::to_vec_pretty(&sidecar)?)?;
+    Ok(())
+}
+
+/// true when `image` is unchanged since it was verified to hash to `sha256`
+pub fn is_up_to_date(image: &Path, sha256: &[u8]) -> bool {
+    let Some((size, modified_ns)) = stamp(image) else {
+        return false;
+    };
+    fs::read(sidecar_path(image))
+        .ok()
+        .and_then(|data| serde_json::from_slice::<Sidecar>(&data).ok())
+        .map(|s| {
+            s.size == size
+                && s.modified_ns == modified_ns
+                && s.sha256.eq_ignore_ascii_case(&to_hex(sha256))
+        })
+        .unwrap_or(false)
+}
+
+/// forget a previous verification, before the image is rewritten
+pub fn remove(image: &Path) {
+    let _ = fs::remove_file(sidecar_path(image));
+}
+
+/// parse a hex SHA-256 as printed in the partition listing
+pub fn parse_hex(hex: &str) -> Option<Vec<u8>> {
+    let hex = hex.trim();
+    if hex.len() % 2 != 0 {
+        return None;
+    }
+    (0..hex.len())
+        .step_by(2)
+        .map(|i| u8::from_str_radix(hex.get(i..i + 2)?, 16).ok())
+        .collect()
+}
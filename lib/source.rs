@@ -0,0 +1,27 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use anyhow::Result;
+use payload_dumper_core::payload::payload_dumper::AsyncPayloadRead;
+use std::future::Future;
+use std::pin::Pin;
+use std::sync::Arc;
+
+pub type FetchFuture<'a> = Pin<Box<dyn Future<Output = Result<Vec<u8>>> + Send + 'a>>;
+
+/// object-safe view of a payload reader that can be shared with spawned tasks
+///
+/// offsets are relative to the start of payload.bin, exactly like the
+/// readers from payload_dumper_core expect them
+pub trait RangeSource: Send + Sync + 'static {
+    fn fetch(&self, offset: u64, length: u64) -> FetchFuture<'_>;
+}
+
+/// payload reader behind an Arc, so one open source can serve several passes
+pub struct SharedSource<R: RangeSource>(pub Arc<R>);
+
+impl<R: RangeSource> AsyncPayloadRead for SharedSource<R> {
+    async fn read_bytes(&self, offset: u64, length: u64) -> Result<Vec<u8>> {
+        self.0.fetch(offset, length).await
+    }
+}
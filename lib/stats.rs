@@ -0,0 +1,296 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use crate::budget::BUDGET;
+use crate::scheduler::SCHEDULER;
+use anyhow::{Result, anyhow};
+use std::sync::atomic::{AtomicU64, Ordering};
+
+/// process-wide engine counters
+///
+/// everything here is monotonic or a last-observed gauge, so relaxed
+/// ordering is enough; readers only ever want an approximate snapshot
+pub struct EngineStats {
+    pub prefetch_hits: AtomicU64,
+    pub prefetch_stalls: AtomicU64,
+    pub prefetch_misses: AtomicU64,
+    pub prefetch_bytes: AtomicU64,
+    pub prefetch_window_bytes: AtomicU64,
+    pub remote_rtt_us: AtomicU64,
+    pub remote_throughput_bps: AtomicU64,
+    pub pool_allocations: AtomicU64,
+    pub pool_reuses: AtomicU64,
+    pub pool_retained_bytes: AtomicU64,
+    pub cache_hits: AtomicU64,
+    pub cache_misses: AtomicU64,
+    pub cache_bytes_saved: AtomicU64,
+    pub cancel_requests: AtomicU64,
+    pub cancel_latency_us_last: AtomicU64,
+    pub cancel_latency_us_max: AtomicU64,
+    pub sequential_reads: AtomicU64,
+    pub sequential_read_bytes: AtomicU64,
+    pub streamed_bytes: AtomicU64,
+    pub remote_opens: AtomicU64,
+    pub remote_open_us_last: AtomicU64,
+    pub remote_open_requests_last: AtomicU64,
+    pub remote_list_us_last: AtomicU64,
+    pub remote_summary_us_last: AtomicU64,
+    pub image_reads: AtomicU64,
+    pub image_read_bytes: AtomicU64,
+    pub image_fetched_bytes: AtomicU64,
+    pub image_ops_decoded: AtomicU64,
+    pub image_cache_hits: AtomicU64,
+    pub fs_dirs_listed: AtomicU64,
+    pub fs_files_extracted: AtomicU64,
+    pub warm_manifest_hits: AtomicU64,
+    pub warm_blob_hits: AtomicU64,
+    pub warm_blob_bytes: AtomicU64,
+    pub warm_fetched_bytes: AtomicU64,
+    pub throttle_network_wait_us: AtomicU64,
+    pub throttle_disk_wait_us: AtomicU64,
+    pub output_writes: AtomicU64,
+    pub output_write_bytes: AtomicU64,
+    pub output_write_us: AtomicU64,
+    pub output_merged_writes: AtomicU64,
+    pub output_direct_files: AtomicU64,
+    pub local_reads: AtomicU64,
+    pub local_read_bytes: AtomicU64,
+    pub local_window_hits: AtomicU64,
+    pub local_mapped_sources: AtomicU64,
+    pub http_hosts: AtomicU64,
+    pub http_requests: AtomicU64,
+    pub http2_requests: AtomicU64,
+    pub http_retries: AtomicU64,
+    pub http_ttfb_us_total: AtomicU64,
+    pub http_ttfb_us_last: AtomicU64,
+    pub follow_waits: AtomicU64,
+    pub follow_wait_us: AtomicU64,
+    pub follow_stalls: AtomicU64,
+}
+
+pub static STATS: EngineStats = EngineStats {
+    prefetch_hits: AtomicU64::new(0),
+    prefetch_stalls: AtomicU64::new(0),
+    prefetch_misses: AtomicU64::new(0),
+    prefetch_bytes: AtomicU64::new(0),
+    prefetch_window_bytes: AtomicU64::new(0),
+    remote_rtt_us: AtomicU64::new(0),
+    remote_throughput_bps: AtomicU64::new(0),
+    pool_allocations: AtomicU64::new(0),
+    pool_reuses: AtomicU64::new(0),
+    pool_retained_bytes: AtomicU64::new(0),
+    cache_hits: AtomicU64::new(0),
+    cache_misses: AtomicU64::new(0),
+    cache_bytes_saved: AtomicU64::new(0),
+    cancel_requests: AtomicU64::new(0),
+    cancel_latency_us_last: AtomicU64::new(0),
+    cancel_latency_us_max: AtomicU64::new(0),
+    sequential_reads: AtomicU64::new(0),
+    sequential_read_bytes: AtomicU64::new(0),
+    streamed_bytes: AtomicU64::new(0),
+    remote_opens: AtomicU64::new(0),
+    remote_open_us_last: AtomicU64::new(0),
+    remote_open_requests_last: AtomicU64::new(0),
+    remote_list_us_last: AtomicU64::new(0),
+    remote_summary_us_last: AtomicU64::new(0),
+    image_reads: AtomicU64::new(0),
+    image_read_bytes: AtomicU64::new(0),
+    image_fetched_bytes: AtomicU64::new(0),
+    image_ops_decoded: AtomicU64::new(0),
+    image_cache_hits: AtomicU64::new(0),
+    fs_dirs_listed: AtomicU64::new(0),
+    fs_files_extracted: AtomicU64::new(0),
+    warm_manifest_hits: AtomicU64::new(0),
+    warm_blob_hits: AtomicU64::new(0),
+    warm_blob_bytes: AtomicU64::new(0),
+    warm_fetched_bytes: AtomicU64::new(0),
+    throttle_network_wait_us: AtomicU64::new(0),
+    throttle_disk_wait_us: AtomicU64::new(0),
+    output_writes: AtomicU64::new(0),
+    output_write_bytes: AtomicU64::new(0),
+    output_write_us: AtomicU64::new(0),
+    output_merged_writes: AtomicU64::new(0),
+    output_direct_files: AtomicU64::new(0),
+    local_reads: AtomicU64::new(0),
+    local_read_bytes: AtomicU64::new(0),
+    local_window_hits: AtomicU64::new(0),
+    local_mapped_sources: AtomicU64::new(0),
+    http_hosts: AtomicU64::new(0),
+    http_requests: AtomicU64::new(0),
+    http2_requests: AtomicU64::new(0),
+    http_retries: AtomicU64::new(0),
+    http_ttfb_us_total: AtomicU64::new(0),
+    http_ttfb_us_last: AtomicU64::new(0),
+    follow_waits: AtomicU64::new(0),
+    follow_wait_us: AtomicU64::new(0),
+    follow_stalls: AtomicU64::new(0),
+};
+
+#[inline]
+pub fn add(counter: &AtomicU64, value: u64) {
+    counter.fetch_add(value, Ordering::Relaxed);
+}
+
+#[inline]
+pub fn set(gauge: &AtomicU64, value: u64) {
+    gauge.store(value, Ordering::Relaxed);
+}
+
+#[derive(Debug, Clone, serde::Serialize)]
+pub struct StatsSnapshot {
+    pub prefetch_hits: u64,
+    pub prefetch_stalls: u64,
+    pub prefetch_misses: u64,
+    pub prefetch_bytes: u64,
+    pub prefetch_window_bytes: u64,
+    pub remote_rtt_ms: f64,
+    pub remote_throughput_bps: u64,
+    pub memory_limit_bytes: u64,
+    pub memory_in_use_bytes: u64,
+    pub memory_peak_bytes: u64,
+    pub memory_waiting_jobs: u64,
+    pub pool_allocations: u64,
+    pub pool_reuses: u64,
+    pub pool_retained_bytes: u64,
+    pub cache_hits: u64,
+    pub cache_misses: u64,
+    pub cache_bytes_saved: u64,
+    pub cancel_requests: u64,
+    pub cancel_latency_ms_last: f64,
+    pub cancel_latency_ms_max: f64,
+    pub sequential_reads: u64,
+    pub sequential_read_bytes: u64,
+    pub streamed_bytes: u64,
+    pub remote_opens: u64,
+    pub remote_open_ms_last: f64,
+    pub remote_open_requests_last: u64,
+    pub remote_list_ms_last: f64,
+    pub remote_summary_ms_last: f64,
+    pub image_reads: u64,
+    pub image_read_bytes: u64,
+    pub image_fetched_bytes: u64,
+    pub image_ops_decoded: u64,
+    pub image_cache_hits: u64,
+    pub fs_dirs_listed: u64,
+    pub fs_files_extracted: u64,
+    pub warm_manifest_hits: u64,
+    pub warm_blob_hits: u64,
+    pub warm_blob_bytes: u64,
+    pub warm_fetched_bytes: u64,
+    pub throttle_network_wait_ms: f64,
+    pub throttle_disk_wait_ms: f64,
+    pub output_writes: u64,
+    pub output_write_bytes: u64,
+    pub output_write_mbs: f64,
+    pub output_merged_writes: u64,
+    pub output_direct_files: u64,
+    pub local_reads: u64,
+    pub local_read_bytes: u64,
+    pub local_window_hits: u64,
+    pub local_mapped_sources: u64,
+    pub http_hosts: u64,
+    pub http_requests: u64,
+    pub http2_requests: u64,
+    pub http_retries: u64,
+    pub http_ttfb_ms_avg: f64,
+    pub http_ttfb_ms_last: f64,
+    pub follow_waits: u64,
+    pub follow_wait_ms: f64,
+    pub follow_stalls: u64,
+    pub disk_jobs_active: u64,
+    pub disk_jobs_waiting: u64,
+    pub network_jobs_active: u64,
+    pub network_jobs_waiting: u64,
+    pub decode_active: u64,
+    pub decode_limit: u64,
+}
+
+pub fn snapshot() -> StatsSnapshot {
+    let get = |c: &AtomicU64| c.load(Ordering::Relaxed);
+
+    StatsSnapshot {
+        prefetch_hits: get(&STATS.prefetch_hits),
+        prefetch_stalls: get(&STATS.prefetch_stalls),
+        prefetch_misses: get(&STATS.prefetch_misses),
+        prefetch_bytes: get(&STATS.prefetch_bytes),
+        prefetch_window_bytes: get(&STATS.prefetch_window_bytes),
+        remote_rtt_ms: get(&STATS.remote_rtt_us) as f64 / 1000.0,
+        remote_throughput_bps: get(&STATS.remote_throughput_bps),
+        memory_limit_bytes: BUDGET.limit(),
+        memory_in_use_bytes: BUDGET.in_use(),
+        memory_peak_bytes: BUDGET.peak(),
+        memory_waiting_jobs: BUDGET.waiting(),
+        pool_allocations: get(&STATS.pool_allocations),
+        pool_reuses: get(&STATS.pool_reuses),
+        pool_retained_bytes: get(&STATS.pool_retained_bytes),
+        cache_hits: get(&STATS.cache_hits),
+        cache_misses: get(&STATS.cache_misses),
+        cache_bytes_saved: get(&STATS.cache_bytes_saved),
+        cancel_requests: get(&STATS.cancel_requests),
+        cancel_latency_ms_last: get(&STATS.cancel_latency_us_last) as f64 / 1000.0,
+        cancel_latency_ms_max: get(&STATS.cancel_latency_us_max) as f64 / 1000.0,
+        sequential_reads: get(&STATS.sequential_reads),
+        sequential_read_bytes: get(&STATS.sequential_read_bytes),
+        streamed_bytes: get(&STATS.streamed_bytes),
+        remote_opens: get(&STATS.remote_opens),
+        remote_open_ms_last: get(&STATS.remote_open_us_last) as f64 / 1000.0,
+        remote_open_requests_last: get(&STATS.remote_open_requests_last),
+        remote_list_ms_last: get(&STATS.remote_list_us_last) as f64 / 1000.0,
+        remote_summary_ms_last: get(&STATS.remote_summary_us_last) as f64 / 1000.0,
+        image_reads: get(&STATS.image_reads),
+        image_read_bytes: get(&STATS.image_read_bytes),
+        image_fetched_bytes: get(&STATS.image_fetched_bytes),
+        image_ops_decoded: get(&STATS.image_ops_decoded),
+        image_cache_hits: get(&STATS.image_cache_hits),
+        fs_dirs_listed: get(&STATS.fs_dirs_listed),
+        fs_files_extracted: get(&STATS.fs_files_extracted),
+        warm_manifest_hits: get(&STATS.warm_manifest_hits),
+        warm_blob_hits: get(&STATS.warm_blob_hits),
+        warm_blob_bytes: get(&STATS.warm_blob_bytes),
+        warm_fetched_bytes: get(&STATS.warm_fetched_bytes),
+        throttle_network_wait_ms: get(&STATS.throttle_network_wait_us) as f64 / 1000.0,
+        throttle_disk_wait_ms: get(&STATS.throttle_disk_wait_us) as f64 / 1000.0,
+        output_writes: get(&STATS.output_writes),
+        output_write_bytes: get(&STATS.output_write_bytes),
+        output_write_mbs: per_second_mb(
+            get(&STATS.output_write_bytes),
+            get(&STATS.output_write_us),
+        ),
+        output_merged_writes: get(&STATS.output_merged_writes),
+        output_direct_files: get(&STATS.output_direct_files),
+        local_reads: get(&STATS.local_reads),
+        local_read_bytes: get(&STATS.local_read_bytes),
+        local_window_hits: get(&STATS.local_window_hits),
+        local_mapped_sources: get(&STATS.local_mapped_sources),
+        http_hosts: get(&STATS.http_hosts),
+        http_requests: get(&STATS.http_requests),
+        http2_requests: get(&STATS.http2_requests),
+        http_retries: get(&STATS.http_retries),
+        http_ttfb_ms_avg: match get(&STATS.http_requests) {
+            0 => 0.0,
+            n => get(&STATS.http_ttfb_us_total) as f64 / n as f64 / 1000.0,
+        },
+        http_ttfb_ms_last: get(&STATS.http_ttfb_us_last) as f64 / 1000.0,
+        follow_waits: get(&STATS.follow_waits),
+        follow_wait_ms: get(&STATS.follow_wait_us) as f64 / 1000.0,
+        follow_stalls: get(&STATS.follow_stalls),
+        disk_jobs_active: SCHEDULER.disk.active(),
+        disk_jobs_waiting: SCHEDULER.disk.waiting(),
+        network_jobs_active: SCHEDULER.network.active(),
+        network_jobs_waiting: SCHEDULER.network.waiting(),
+        decode_active: SCHEDULER.decode.active(),
+        decode_limit: SCHEDULER.decode.limit(),
+    }
+}
+
+/// MiB per second of `bytes` moved in `us`, 0 before anything was timed
+fn per_second_mb(bytes: u64, us: u64) -> f64 {
+    match us {
+        0 => 0.0,
+        us => bytes as f64 / (1024.0 * 1024.0) / (us as f64 / 1_000_000.0),
+    }
+}
+
+pub fn stats_json() -> Result<String> {
+    serde_json::to_string_pretty(&snapshot()).map_err(|e| anyhow!("Serialization failed: {}", e))
+}
@@ -0,0 +1,301 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use crate::budget::{BUDGET, BudgetPermit, operation_footprint};
+use crate::cache::to_hex;
+use crate::cancel::CancelToken;
+use crate::engine::{self, Decoded, Input, decode_operation, extents_len};
+use crate::profile;
+use crate::scheduler::SCHEDULER;
+use crate::stats::{self, STATS};
+use crate::throttle::JobPace;
+use anyhow::{Result, anyhow};
+use payload_dumper_core::payload::payload_dumper::{AsyncPayloadRead, ProgressReporter};
+use payload_dumper_core::structs::{Extent, PartitionUpdate};
+use sha2::{Digest, Sha256};
+use std::collections::BTreeMap;
+use std::fs::File;
+use std::io::{self, Write};
+use std::mem::ManuallyDrop;
+use std::sync::Arc;
+use tokio::task::JoinSet;
+
+/// destination of a streamed image
+pub type Sink = Box<dyn Write + Send>;
+
+/// a file descriptor (a HANDLE on Windows) owned by the caller; writes go
+/// straight to it and it is left open afterwards
+pub struct BorrowedFd(ManuallyDrop<File>);
+
+impl BorrowedFd {
+    /// # Safety
+    /// `fd` must stay a valid, writable descriptor for as long as this lives
+    #[cfg(unix)]
+    pub unsafe fn new(fd: isize) -> Self {
+        use std::os::unix::io::FromRawFd;
+        Self(ManuallyDrop::new(unsafe { File::from_raw_fd(fd as i32) }))
+    }
+
+    /// # Safety
+    /// `handle` must stay a valid, writable HANDLE for as long as this lives
+    #[cfg(windows)]
+    pub unsafe fn new(handle: isize) -> Self {
+        use std::os::windows::io::FromRawHandle;
+        Self(ManuallyDrop::new(unsafe {
+            File::from_raw_handle(handle as _)
+        }))
+    }
+}
+
+impl Write for BorrowedFd {
+    fn write(&mut self, buf: &[u8]) -> io::Result<usize> {
+        self.0.write(buf)
+    }
+
+    fn flush(&mut self) -> io::Result<()> {
+        self.0.flush()
+    }
+}
+
+/// operations sorted by destination offset, or None when their extents
+/// overlap or interleave and the image cannot be written front to back
+fn sequential_order(partition: &PartitionUpdate) -> Option<Vec<usize>> {
+    let operations = &partition.operations;
+    let mut order: Vec<usize> = (0..operations.len()).collect();
+    order.sort_by_key(|&i| {
+        operations[i]
+            .dst_extents
+            .first()
+            .map(|e| e.start_block())
+            .unwrap_or(0)
+    });
+
+    let mut next_block = 0;
+    for &i in &order {
+        for extent in &operations[i].dst_extents {
+            if extent.start_block() < next_block {
+                return None;
+            }
+            next_block = extent.start_block() + extent.num_blocks();
+        }
+    }
+    Some(order)
+}
+
+/// blobs in the order stream_partition reads them, for read-ahead
+pub fn read_plan(partition: &PartitionUpdate, data_offset: u64) -> Vec<(u64, u64)> {
+    sequential_order(partition)
+        .unwrap_or_default()
+        .into_iter()
+        .map(|i| &partition.operations[i])
+        .filter(|op| op.data_length() > 0)
+        .map(|op| (data_offset + op.data_offset(), op.data_length()))
+        .collect()
+}
+
+/// writes an image strictly front to back and hashes it on the way
+///
+/// gaps between extents and the tail up to the partition size are written
+/// as zeros, so the stream is byte-identical to the extracted file
+struct SequentialOutput {
+    sink: Sink,
+    hasher: Option<Sha256>,
+    position: u64,
+    block_size: u64,
+}
+
+impl SequentialOutput {
+    fn write(&mut self, extents: &[Extent], data: &[u8]) -> io::Result<()> {
+        let mut pos = 0usize;
+        for extent in extents {
+            let start = extent.start_block() * self.block_size;
+            let len = extent.num_blocks() * self.block_size;
+            self.zeros(start - self.position)?;
+
+            let end = (pos + len as usize).min(data.len());
+            let chunk = if pos < end { &data[pos..end] } else { &[][..] };
+            self.emit(chunk)?;
+            self.zeros(len - chunk.len() as u64)?;
+
+            self.position = start + len;
+            pos += len as usize;
+        }
+        Ok(())
+    }
+
+    fn emit(&mut self, buf: &[u8]) -> io::Result<()> {
+        self.sink.write_all(buf)?;
+        if let Some(hasher) = self.hasher.as_mut() {
+            hasher.update(buf);
+        }
+        stats::add(&STATS.streamed_bytes, buf.len() as u64);
+        Ok(())
+    }
+
+    fn zeros(&mut self, mut count: u64) -> io::Result<()> {
+        static ZEROS: [u8; 64 * 1024] = [0; 64 * 1024];
+        while count > 0 {
+            let n = count.min(ZEROS.len() as u64) as usize;
+            self.emit(&ZEROS[..n])?;
+            count -= n as u64;
+        }
+        Ok(())
+    }
+
+    fn finish(mut self, size: Option<u64>) -> io::Result<Option<Vec<u8>>> {
+        if let Some(size) = size {
+            self.zeros(size.saturating_sub(self.position))?;
+        }
+        self.sink.flush()?;
+        Ok(self.hasher.map(|h| h.finalize().to_vec()))
+    }
+}
+
+type TaskOutput = (usize, io::Result<Decoded>, BudgetPermit);
+
+/// extract a full partition into `sink` instead of a file
+///
+/// operations are read and decoded in destination order, in parallel like
+/// engine::extract_partition, and a reorder buffer hands them to the sink one
+/// after another. the manifest hash is computed over the bytes as they are
+/// written. writes to the sink block the extraction, so a slow consumer
+/// throttles decoding instead of growing memory.
+///
+/// returns true when the stream was checked against the manifest hash. on a
+/// mismatch the bytes have already been written; the error tells the caller
+/// to discard them.
+pub async fn stream_partition<R: AsyncPayloadRead>(
+    partition: &PartitionUpdate,
+    data_offset: u64,
+    block_size: u64,
+    sink: Sink,
+    reader: &R,
+    reporter: &dyn ProgressReporter,
+    cancel: &Arc<CancelToken>,
+) -> Result<bool> {
+    let name = partition.partition_name.as_str();
+    if !engine::is_supported(partition) {
+        return Err(anyhow!(
+            "Partition {} is differential and cannot be streamed",
+            name
+        ));
+    }
+    let order = sequential_order(partition).ok_or_else(|| {
+        anyhow!(
+            "Partition {} has interleaved extents and cannot be streamed",
+            name
+        )
+    })?;
+
+    let operations = &partition.operations;
+    let total_operations = operations.len() as u64;
+    let info = partition.new_partition_info.as_ref();
+    let size = info.and_then(|i| i.size);
+    let expected_hash = info.and_then(|i| i.hash.clone()).filter(|h| !h.is_empty());
+    let max_in_flight = profile::in_flight();
+    let pace = JobPace::new();
+
+    reporter.on_start(name, total_operations);
+
+    let mut output = SequentialOutput {
+        sink,
+        hasher: expected_hash.as_ref().map(|_| Sha256::new()),
+        position: 0,
+        block_size,
+    };
+    let mut tasks: JoinSet<TaskOutput> = JoinSet::new();
+    // decoded out of order, waiting for an earlier operation to be written
+    let mut finished: BTreeMap<usize, (Decoded, BudgetPermit)> = BTreeMap::new();
+    let mut next_write = 0usize;
+    let mut completed = 0u64;
+
+    let mut on_finished = |task: TaskOutput,
+                           finished: &mut BTreeMap<usize, (Decoded, BudgetPermit)>,
+                           output: &mut SequentialOutput|
+     -> Result<()> {
+        let (position, result, permit) = task;
+        let decoded = result.map_err(|e| anyhow!("Operation {} failed: {}", order[position], e))?;
+        finished.insert(position, (decoded, permit));
+
+        completed += 1;
+        reporter.on_progress(name, completed, total_operations);
+
+        while let Some((decoded, permit)) = finished.remove(&next_write) {
+            let extents = &operations[order[next_write]].dst_extents;
+            tokio::task::block_in_place(|| output.write(extents, decoded.as_slice()))
+                .map_err(|e| anyhow!("Write failed: {}", e))?;
+            // the sink has the bytes
+            drop(decoded);
+            drop(permit);
+            next_write += 1;
+        }
+        Ok(())
+    };
+
+    for (position, &index) in order.iter().enumerate() {
+        if cancel.is_cancelled() {
+            tasks.abort_all();
+            return Err(anyhow!("Extraction cancelled"));
+        }
+
+        // the head of the reorder buffer is always still in `tasks`
+        while tasks.len() + finished.len() >= max_in_flight {
+            let done = join_next(&mut tasks).await?;
+            on_finished(done, &mut finished, &mut output)?;
+        }
+
+        let op = &operations[index];
+        let permit = BUDGET
+            .acquire_reaping(operation_footprint(op, block_size), &mut tasks, |done| {
+                on_finished(done, &mut finished, &mut output)
+            })
+            .await?;
+        let data = if op.data_length() > 0 {
+            reader
+                .read_bytes(data_offset + op.data_offset(), op.data_length())
+                .await?
+        } else {
+            Vec::new()
+        };
+
+        pace.disk(extents_len(&op.dst_extents, block_size)).await;
+        let slot = SCHEDULER.decode.acquire().await;
+        let cancel = Arc::clone(cancel);
+        let op = op.clone();
+
+        tasks.spawn_blocking(move || {
+            let result = decode_operation(&op, Input::Owned(data), block_size, &cancel);
+            drop(slot);
+            (position, result, permit)
+        });
+    }
+
+    while !tasks.is_empty() {
+        let done = join_next(&mut tasks).await?;
+        on_finished(done, &mut finished, &mut output)?;
+    }
+
+    let actual = tokio::task::block_in_place(|| output.finish(size))
+        .map_err(|e| anyhow!("Write failed: {}", e))?;
+    if let (Some(actual), Some(expected)) = (&actual, &expected_hash) {
+        if actual != expected {
+            return Err(anyhow!(
+                "Hash mismatch for {}: expected {}, got {}",
+                name,
+                to_hex(expected),
+                to_hex(actual)
+            ));
+        }
+    }
+
+    reporter.on_complete(name, total_operations);
+    Ok(actual.is_some())
+}
+
+async fn join_next(tasks: &mut JoinSet<TaskOutput>) -> Result<TaskOutput> {
+    tasks
+        .join_next()
+        .await
+        .ok_or_else(|| anyhow!("No decode task in flight"))?
+        .map_err(|e| anyhow!("Decode task failed: {}", e))
+}
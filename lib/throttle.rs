@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use crate::source::{FetchFuture, RangeSource};
+use crate::stats::{self, STATS};
+use std::sync::Mutex;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::time::{Duration, Instant};
+
+/// bytes a bucket may run ahead of its rate, in time at that rate
+const BURST: Duration = Duration::from_millis(250);
+
+/// smallest slice of a request paced at once; larger requests are paced in
+/// slices of a tenth of a second so concurrent jobs take turns
+const MIN_SLICE: u64 = 64 * 1024;
+
+/// process-wide bandwidth limits for remote reads and image writes
+///
+/// every limit is in bytes per second, 0 disables it. the global buckets are
+/// shared by every job; each job also has buckets of its own that follow the
+/// per-job rates. limits can be changed at any time and apply from the next
+/// slice a job asks for.
+pub static THROTTLE: Throttle = Throttle {
+    network: Bucket::new(),
+    disk: Bucket::new(),
+    job_network: AtomicU64::new(0),
+    job_disk: AtomicU64::new(0),
+};
+
+pub struct Throttle {
+    network: Bucket,
+    disk: Bucket,
+    job_network: AtomicU64,
+    job_disk: AtomicU64,
+}
+
+impl Throttle {
+    pub fn set_limits(&self, network: u64, disk: u64, job_network: u64, job_disk: u64) {
+        self.network.rate.store(network, Ordering::Relaxed);
+        self.disk.rate.store(disk, Ordering::Relaxed);
+        self.job_network.store(job_network, Ordering::Relaxed);
+        self.job_disk.store(job_disk, Ordering::Relaxed);
+    }
+}
+
+/// token bucket kept as the time it is paid up to (GCRA): a slice reserves
+/// the next stretch of time at the current rate and waits until that stretch
+/// is no more than BURST ahead of now. reservations are handed out in the
+/// order jobs ask, which is what shares the rate fairly between them.
+pub struct Bucket {
+    rate: AtomicU64,
+    paid_until: Mutex<Option<Instant>>,
+}
+
+impl Bucket {
+    const fn new() -> Self {
+        Self {
+            rate: AtomicU64::new(0),
+            paid_until: Mutex::new(None),
+        }
+    }
+
+    /// how long to wait before `bytes` may pass at `rate`
+    fn reserve(&self, bytes: u64, rate: u64) -> Duration {
+        let now = Instant::now();
+        let cost = Duration::from_secs_f64(bytes as f64 / rate as f64);
+        let mut paid_until = self.paid_until.lock().unwrap();
+        let until = paid_until.filter(|&t| t > now).unwrap_or(now) + cost;
+        *paid_until = Some(until);
+        until.saturating_duration_since(now + BURST)
+    }
+}
+
+/// the per-job half of the limits, one per extraction or remote reader
+pub struct JobPace {
+    network: Bucket,
+    disk: Bucket,
+}
+
+impl JobPace {
+    pub fn new() -> Self {
+        Self {
+            network: Bucket::new(),
+            disk: Bucket::new(),
+        }
+    }
+
+    /// false while no network limit is set, the common case
+    fn network_limited(&self) -> bool {
+        THROTTLE.network.rate.load(Ordering::Relaxed) != 0
+            || THROTTLE.job_network.load(Ordering::Relaxed) != 0
+    }
+
+    /// wait until `bytes` more may be downloaded
+    pub async fn network(&self, bytes: u64) {
+        let job_rate = THROTTLE.job_network.load(Ordering::Relaxed);
+        let waited = pace(&THROTTLE.network, &self.network, job_rate, bytes).await;
+        if !waited.is_zero() {
+            stats::add(&STATS.throttle_network_wait_us, waited.as_micros() as u64);
+        }
+    }
+
+    /// wait until `bytes` more may be written
+    pub async fn disk(&self, bytes: u64) {
+        let job_rate = THROTTLE.job_disk.load(Ordering::Relaxed);
+        let waited = pace(&THROTTLE.disk, &self.disk, job_rate, bytes).await;
+        if !waited.is_zero() {
+            stats::add(&STATS.throttle_disk_wait_us, waited.as_micros() as u64);
+        }
+    }
+}
+
+impl Default for JobPace {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+/// let `bytes` through the job bucket and then the global one, slice by
+/// slice; returns the time spent waiting
+async fn pace(global: &Bucket, job: &Bucket, job_rate: u64, bytes: u64) -> Duration {
+    let global_rate = global.rate.load(Ordering::Relaxed);
+    if (global_rate == 0 && job_rate == 0) || bytes == 0 {
+        return Duration::ZERO;
+    }
+
+    let slowest = match (global_rate, job_rate) {
+        (0, rate) | (rate, 0) => rate,
+        (a, b) => a.min(b),
+    };
+    let slice = (slowest / 10).max(MIN_SLICE);
+
+    let mut waited = Duration::ZERO;
+    let mut left = bytes;
+    while left > 0 {
+        let n = left.min(slice);
+        if job_rate > 0 {
+            waited += sleep(job.reserve(n, job_rate)).await;
+        }
+        if global_rate > 0 {
+            waited += sleep(global.reserve(n, global_rate)).await;
+        }
+        left -= n;
+    }
+    waited
+}
+
+async fn sleep(wait: Duration) -> Duration {
+    if !wait.is_zero() {
+        tokio::time::sleep(wait).await;
+    }
+    wait
+}
+
+/// remote reader whose requests are paced by the network limits
+pub struct Throttled<R: RangeSource> {
+    inner: R,
+    pace: JobPace,
+}
+
+impl<R: RangeSource> Throttled<R> {
+    pub fn new(inner: R) -> Self {
+        Self {
+            inner,
+            pace: JobPace::new(),
+        }
+    }
+}
+
+impl<R: RangeSource> RangeSource for Throttled<R> {
+    fn fetch(&self, offset: u64, length: u64) -> FetchFuture<'_> {
+        if !self.pace.network_limited() {
+            return self.inner.fetch(offset, length);
+        }
+        Box::pin(async move {
+            self.pace.network(length).await;
+            self.inner.fetch(offset, length).await
+        })
+    }
+}
@@ -0,0 +1,224 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use crate::cancel::CancelToken;
+use crate::extractor::{
+    find_partition, is_partition_differential, is_remote, list_local_partitions,
+    open_remote_source, summarize,
+};
+use crate::prefetch::operation_plan;
+use crate::runtime::RUNTIME;
+use crate::source::{FetchFuture, RangeSource};
+use crate::stats::{self, STATS};
+use anyhow::Result;
+use payload_dumper_core::structs::DeltaArchiveManifest;
+use std::collections::VecDeque;
+use std::sync::{Arc, Mutex};
+use std::time::{Duration, Instant};
+use tokio::task::JoinSet;
+
+/// partitions that are usually extracted first and are small enough to warm
+pub const WARM_PARTITIONS: &[&str] = &["boot", "init_boot", "vendor_boot"];
+
+/// bytes warmed at the start of each of them
+const WARM_PER_PARTITION: u64 = 4 * 1024 * 1024;
+
+/// prefetched blob bytes kept until an extraction asks for them
+const BLOB_LIMIT: u64 = 32 * 1024 * 1024;
+
+/// remote manifests remembered, most recent first
+const MANIFEST_ENTRIES: usize = 4;
+
+/// how long a remembered manifest is trusted; the file behind a URL can be
+/// replaced by a newer build
+const MANIFEST_TTL: Duration = Duration::from_secs(10 * 60);
+
+struct Opened {
+    url: String,
+    ua: Option<String>,
+    ck: Option<String>,
+    at: Instant,
+    /// offset of payload.bin in the file
+    base: u64,
+    manifest: DeltaArchiveManifest,
+    data_offset: u64,
+}
+
+static MANIFESTS: Mutex<Vec<Opened>> = Mutex::new(Vec::new());
+
+struct Blob {
+    url: String,
+    offset: u64,
+    data: Arc<Vec<u8>>,
+}
+
+struct Blobs {
+    /// oldest first
+    entries: VecDeque<Blob>,
+    bytes: u64,
+}
+
+static BLOBS: Mutex<Blobs> = Mutex::new(Blobs {
+    entries: VecDeque::new(),
+    bytes: 0,
+});
+
+/// the manifest of `url` when it was opened recently with the same headers
+pub(crate) fn cached_manifest(
+    url: &str,
+    ua: Option<&str>,
+    ck: Option<&str>,
+) -> Option<(u64, DeltaArchiveManifest, u64)> {
+    let mut manifests = MANIFESTS.lock().unwrap();
+    manifests.retain(|m| m.at.elapsed() < MANIFEST_TTL);
+    let hit = manifests
+        .iter()
+        .find(|m| m.url == url && m.ua.as_deref() == ua && m.ck.as_deref() == ck)?;
+    stats::add(&STATS.warm_manifest_hits, 1);
+    Some((hit.base, hit.manifest.clone(), hit.data_offset))
+}
+
+pub(crate) fn remember_manifest(
+    url: &str,
+    ua: Option<&str>,
+    ck: Option<&str>,
+    opened: &(u64, DeltaArchiveManifest, u64),
+) {
+    let mut manifests = MANIFESTS.lock().unwrap();
+    manifests.retain(|m| !(m.url == url && m.ua.as_deref() == ua && m.ck.as_deref() == ck));
+    manifests.insert(
+        0,
+        Opened {
+            url: url.to_string(),
+            ua: ua.map(str::to_string),
+            ck: ck.map(str::to_string),
+            at: Instant::now(),
+            base: opened.0,
+            manifest: opened.1.clone(),
+            data_offset: opened.2,
+        },
+    );
+    manifests.truncate(MANIFEST_ENTRIES);
+}
+
+/// bytes [offset, offset + length) of `url` if a warmed blob holds them
+fn lookup(url: &str, offset: u64, length: u64) -> Option<Vec<u8>> {
+    let blobs = BLOBS.lock().unwrap();
+    let blob = blobs.entries.iter().find(|b| {
+        b.url == url && b.offset <= offset && offset + length <= b.offset + b.data.len() as u64
+    })?;
+    let start = (offset - blob.offset) as usize;
+    Some(blob.data[start..start + length as usize].to_vec())
+}
+
+fn store(url: &str, offset: u64, data: Vec<u8>) {
+    let size = data.len() as u64;
+    let mut blobs = BLOBS.lock().unwrap();
+    while blobs.bytes + size > BLOB_LIMIT {
+        let Some(oldest) = blobs.entries.pop_front() else {
+            return;
+        };
+        blobs.bytes -= oldest.data.len() as u64;
+    }
+    blobs.bytes += size;
+    blobs.entries.push_back(Blob {
+        url: url.to_string(),
+        offset,
+        data: Arc::new(data),
+    });
+}
+
+/// remote reader that serves ranges warmed by prefetch_source() from memory
+pub struct Warmed<R: RangeSource> {
+    url: String,
+    inner: R,
+}
+
+impl<R: RangeSource> Warmed<R> {
+    pub fn new(url: &str, inner: R) -> Self {
+        Self {
+            url: url.to_string(),
+            inner,
+        }
+    }
+}
+
+impl<R: RangeSource> RangeSource for Warmed<R> {
+    fn fetch(&self, offset: u64, length: u64) -> FetchFuture<'_> {
+        if let Some(data) = lookup(&self.url, offset, length) {
+            stats::add(&STATS.warm_blob_hits, 1);
+            stats::add(&STATS.warm_blob_bytes, length);
+            return Box::pin(async move { Ok(data) });
+        }
+        self.inner.fetch(offset, length)
+    }
+}
+
+/// list a source the moment it is known, before the user asks for it
+///
+/// returns the same JSON as the list functions. for a URL the manifest is
+/// remembered, so the listing or extraction that follows skips fetching it
+/// again, and the first blobs of WARM_PARTITIONS keep downloading in the
+/// background after this returns. cancelling `cancel` stops that download;
+/// ranges that already arrived stay cached.
+pub fn prefetch_source(
+    source: &str,
+    ua: Option<&str>,
+    ck: Option<&str>,
+    cancel: Option<Arc<CancelToken>>,
+) -> Result<String> {
+    if tokio::runtime::Handle::try_current().is_ok() {
+        panic!("Cannot be called from async context");
+    }
+    if !is_remote(source) {
+        return list_local_partitions(source);
+    }
+
+    let cancel = cancel.unwrap_or_default();
+    RUNTIME.block_on(cancel.run(async {
+        let (manifest, data_offset, reader) = open_remote_source(source, ua, ck).await?;
+        let summary = summarize(&manifest, data_offset).await?;
+
+        let mut ranges = Vec::new();
+        for name in WARM_PARTITIONS {
+            let Ok(partition) = find_partition(&manifest, name) else {
+                continue;
+            };
+            if is_partition_differential(partition) {
+                continue;
+            }
+            let mut warmed = 0;
+            for (offset, length) in operation_plan(partition, data_offset) {
+                if warmed + length > WARM_PER_PARTITION {
+                    break;
+                }
+                warmed += length;
+                if lookup(source, offset, length).is_none() {
+                    ranges.push((offset, length));
+                }
+            }
+        }
+
+        let url = source.to_string();
+        let token = Arc::clone(&cancel);
+        RUNTIME.spawn(async move {
+            let _ = token.run(warm(url, reader, ranges)).await;
+        });
+        Ok(summary)
+    }))
+}
+
+async fn warm(url: String, reader: Arc<dyn RangeSource>, ranges: Vec<(u64, u64)>) -> Result<()> {
+    let mut tasks = JoinSet::new();
+    for (offset, length) in ranges {
+        let reader = Arc::clone(&reader);
+        tasks.spawn(async move { (offset, reader.fetch(offset, length).await) });
+    }
+    while let Some(joined) = tasks.join_next().await {
+        if let Ok((offset, Ok(data))) = joined {
+            stats::add(&STATS.warm_fetched_bytes, data.len() as u64);
+            store(&url, offset, data);
+        }
+    }
+    Ok(())
+}
@@ -0,0 +1,209 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (c) 2026 rhythmcache
+
+use crate::fs::{le16, le32, le64};
+use anyhow::{Result, anyhow};
+use std::future::Future;
+
+/// the end of central directory record is followed by at most a 64 KiB
+/// comment, the last TAIL_LEN bytes of a zip always hold it
+pub(crate) const TAIL_LEN: u64 = 22 + 0xffff;
+
+const LOCAL: u32 = 0x0403_4b50;
+
+/// position of the end of central directory record in the last bytes of a
+/// zip, None when `tail` holds none and the file is no zip
+pub(crate) fn end_record(tail: &[u8]) -> Option<usize> {
+    const EOCD: u32 = 0x0605_4b50;
+    (0..tail.len().saturating_sub(21))
+        .rev()
+        .find(|&i| le32(tail, i) == EOCD)
+}
+
+/// offset and size of payload.bin inside an OTA zip of `file_len` bytes
+///
+/// `read(offset, len)` returns exactly `len` bytes of the zip. payload.bin has
+/// to be stored, OTA packages never compress it.
+pub(crate) async fn locate_payload<F, Fut>(file_len: u64, read: F) -> Result<(u64, u64)>
+where
+    F: Fn(u64, usize) -> Fut,
+    Fut: Future<Output = Result<Vec<u8>>>,
+{
+    const EOCD64: u32 = 0x0606_4b50;
+    const EOCD64_LOCATOR: u32 = 0x0706_4b50;
+    const CENTRAL: u32 = 0x0201_4b50;
+
+    let tail_len = file_len.min(TAIL_LEN);
+    let tail_start = file_len - tail_len;
+    let tail = read(tail_start, tail_len as usize).await?;
+    let eocd =
+        end_record(&tail).ok_or_else(|| anyhow!("Not a zip file: no end of central directory"))?;
+
+    let mut entries = le16(&tail, eocd + 10) as u64;
+    let mut cd_size = le32(&tail, eocd + 12) as u64;
+    let mut cd_offset = le32(&tail, eocd + 16) as u64;
+    if entries == 0xffff || cd_size == 0xffff_ffff || cd_offset == 0xffff_ffff {
+        let at = eocd
+            .checked_sub(20)
+            .filter(|&at| le32(&tail, at) == EOCD64_LOCATOR)
+            .ok_or_else(|| anyhow!("Zip64 end of central directory locator missing"))?;
+        let record = read(le64(&tail, at + 8), 56).await?;
+        if record.len() < 56 || le32(&record, 0) != EOCD64 {
+            return Err(anyhow!("Invalid zip64 end of central directory"));
+        }
+        entries = le64(&record, 32);
+        cd_size = le64(&record, 40);
+        cd_offset = le64(&record, 48);
+    }
+
+    if cd_offset
+        .checked_add(cd_size)
+        .is_none_or(|end| end > file_len)
+    {
+        return Err(anyhow!(
+            "Corrupt zip: central directory past the end of the file"
+        ));
+    }
+    let cd = read(cd_offset, cd_size as usize).await?;
+    let mut at = 0usize;
+    for _ in 0..entries {
+        if at + 46 > cd.len() || le32(&cd, at) != CENTRAL {
+            return Err(anyhow!("Corrupt zip central directory"));
+        }
+        let method = le16(&cd, at + 10);
+        let compressed = le32(&cd, at + 20) as u64;
+        let mut size = le32(&cd, at + 24) as u64;
+        let name_len = le16(&cd, at + 28) as usize;
+        let extra_len = le16(&cd, at + 30) as usize;
+        let comment_len = le16(&cd, at + 32) as usize;
+        if at + 46 + name_len + extra_len > cd.len() {
+            return Err(anyhow!("Corrupt zip central directory"));
+        }
+        let mut header = le32(&cd, at + 42) as u64;
+        let name = &cd[at + 46..at + 46 + name_len];
+        let extra = &cd[at + 46 + name_len..at + 46 + name_len + extra_len];
+        at += 46 + name_len + extra_len + comment_len;
+
+        if name != b"payload.bin" {
+            continue;
+        }
+        if method != 0 {
+            return Err(anyhow!("payload.bin is compressed inside the zip"));
+        }
+        if size == 0xffff_ffff || header == 0xffff_ffff {
+            (size, header) = zip64_fields(extra, size, compressed, header)?;
+        }
+
+        let local = read(header, 30).await?;
+        if local.len() < 30 || le32(&local, 0) != LOCAL {
+            return Err(anyhow!("Corrupt zip local header"));
+        }
+        let data = header + 30 + le16(&local, 26) as u64 + le16(&local, 28) as u64;
+        if data.checked_add(size).is_none_or(|end| end > file_len) {
+            return Err(anyhow!("Corrupt zip: payload.bin past the end of the file"));
+        }
+        return Ok((data, size));
+    }
+    Err(anyhow!("payload.bin not found in zip"))
+}
+
+/// offset and size of payload.bin found by walking the local headers from
+/// the start of the zip, for a zip whose end has not been written yet
+///
+/// takes the sizes from the local headers, which OTA packages fill in; an
+/// entry whose sizes follow its data ends the walk.
+pub(crate) async fn locate_payload_forward<F, Fut>(read: F) -> Result<(u64, u64)>
+where
+    F: Fn(u64, usize) -> Fut,
+    Fut: Future<Output = Result<Vec<u8>>>,
+{
+    let mut header = 0u64;
+    loop {
+        let local = read(header, 30).await?;
+        if local.len() < 30 || le32(&local, 0) != LOCAL {
+            return Err(anyhow!("payload.bin not found in zip"));
+        }
+        let flags = le16(&local, 6);
+        let method = le16(&local, 8);
+        let mut compressed = le32(&local, 18) as u64;
+        let mut size = le32(&local, 22) as u64;
+        let name_len = le16(&local, 26) as usize;
+        let extra_len = le16(&local, 28) as usize;
+        let names = read(header + 30, name_len + extra_len).await?;
+        if names.len() < name_len + extra_len {
+            return Err(anyhow!("Corrupt zip local header"));
+        }
+        let (name, extra) = names.split_at(name_len);
+
+        if flags & 0x8 != 0 {
+            return Err(anyhow!(
+                "Zip entry sizes are stored after the data, the zip cannot be read before it is complete"
+            ));
+        }
+        if size == 0xffff_ffff || compressed == 0xffff_ffff {
+            (size, compressed) = local_zip64_sizes(extra)?;
+        }
+        let data = header + 30 + (name_len + extra_len) as u64;
+        if name == b"payload.bin" {
+            if method != 0 {
+                return Err(anyhow!("payload.bin is compressed inside the zip"));
+            }
+            return Ok((data, size));
+        }
+        header = data + compressed;
+    }
+}
+
+/// sizes from the zip64 extra field of a local header, which always carries
+/// both of them
+fn local_zip64_sizes(extra: &[u8]) -> Result<(u64, u64)> {
+    let mut at = 0usize;
+    while at + 4 <= extra.len() {
+        let id = le16(extra, at);
+        let len = le16(extra, at + 2) as usize;
+        if id == 0x0001 {
+            if len < 16 || at + 20 > extra.len() {
+                return Err(anyhow!("Corrupt zip64 field"));
+            }
+            return Ok((le64(extra, at + 4), le64(extra, at + 12)));
+        }
+        at += 4 + len;
+    }
+    Err(anyhow!("Zip64 extra field missing"))
+}
+
+/// the real size and local header offset of an entry from its zip64 extra
+/// field; only the fields saturated in the central directory are present
+fn zip64_fields(extra: &[u8], size: u64, compressed: u64, header: u64) -> Result<(u64, u64)> {
+    let mut at = 0usize;
+    while at + 4 <= extra.len() {
+        let id = le16(extra, at);
+        let len = le16(extra, at + 2) as usize;
+        let field = extra
+            .get(at + 4..at + 4 + len)
+            .ok_or_else(|| anyhow!("Corrupt zip extra field"))?;
+        if id == 0x0001 {
+            let mut values = field.chunks_exact(8).map(|c| le64(c, 0));
+            let size = if size == 0xffff_ffff {
+                values
+                    .next()
+                    .ok_or_else(|| anyhow!("Corrupt zip64 field"))?
+            } else {
+                size
+            };
+            if compressed == 0xffff_ffff {
+                values.next();
+            }
+            let header = if header == 0xffff_ffff {
+                values
+                    .next()
+                    .ok_or_else(|| anyhow!("Corrupt zip64 field"))?
+            } else {
+                header
+            };
+            return Ok((size, header));
+        }
+        at += 4 + len;
+    }
+    Err(anyhow!("Zip64 extra field missing"))
+}
@@ -0,0 +1,472 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "core.h"
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+// headless front end to the same pipeline as the GUI, for scripts and CI:
+// progress goes to stdout as one JSON object per line, diagnostics to stderr,
+// and the exit code is non-zero when any partition failed
+//
+// comparing image writes: extract the same partition once per write mode,
+// dropping the page cache before each run (on Linux, sync and then
+// echo 3 > /proc/sys/vm/drop_caches), and compare the "seconds" of the
+// summary and output_writes, output_write_mbs and output_merged_writes of
+// the stats line:
+//
+//   payload-dumper-cli -s ota.zip -p system -o out --stats --no-merge
+//   payload-dumper-cli -s ota.zip -p system -o out --stats
+//   payload-dumper-cli -s ota.zip -p system -o out --stats --direct-io 1
+//
+// buffered, merged and unbuffered in that order; the last run must report
+// output_direct_files 1, or the filesystem refused unbuffered writes and
+// the image went through the page cache after all
+
+struct Options {
+  std::string source;
+  std::string output_dir = ".";
+  std::string partitions;
+  std::string user_agent;
+  int jobs = 2;
+  bool verify = true;
+  bool one_pass = false;
+  bool low_memory = false;
+  int memory_budget_mb = 0;
+  double net_limit_mbs = 0;
+  double disk_limit_mbs = 0;
+  int direct_io_mb = 0;
+  bool merge = true;
+  bool mmap = false;
+  int follow_s = 0;
+  int host_requests = 0;
+  bool stats = false;
+  int threads = 0;
+  int decode_threads = 0;
+  int interval_ms = 500;
+};
+
+static void usage(FILE* out) {
+  fprintf(out,
+          "usage: payload-dumper-cli --source <payload|url> [options]\n"
+          "\n"
+          "  -s, --source <path|url>   payload.bin, OTA zip or http(s) URL\n"
+          "  -o, --out <dir>           output directory (default: .)\n"
+          "  -p, --partitions <list>   comma separated names, * for all\n"
+          "                            (default: all)\n"
+          "  -j, --jobs <n>            partitions extracted at once\n"
+          "                            (default: 2)\n"
+          "      --one-pass            read the payload once, front to back\n"
+          "      --no-verify           skip the SHA-256 check of the images\n"
+          "      --low-memory          small-footprint profile, the default\n"
+          "                            of 32-bit builds\n"
+          "      --memory-budget <mb>  cap on decode memory, 0 = no cap\n"
+          "      --net-limit <mb/s>    download rate, 0 = unlimited\n"
+          "      --disk-limit <mb/s>   image write rate, 0 = unlimited\n"
+          "      --direct-io <mb>      write images of at least this size\n"
+          "                            past the page cache, 0 = never\n"
+          "      --no-merge            write short runs of buffered images\n"
+          "                            one by one, to compare with merging\n"
+          "      --mmap                map local payloads instead of reading\n"
+          "      --follow <s>          the local source is still downloading,\n"
+          "                            give up after <s> seconds without data\n"
+          "      --host-requests <n>   requests to one server at once,\n"
+          "                            0 = unlimited\n"
+          "      --threads <n>         async I/O threads, 0 = one per core\n"
+          "      --decode-threads <n>  decoders at once, 0 = one per core\n"
+          "      --interval <ms>       progress report interval (default: "
+          "500)\n"
+          "      --user-agent <ua>     user agent for remote payloads\n"
+          "      --stats               print the engine counters at the end\n"
+          "  -h, --help                show this help\n");
+}
+
+// a whole number from 0 to INT_MAX; anything else, trailing junk included,
+// is a usage error
+static bool parse_count(const char* name, const char* v, int& out) {
+  char* end = nullptr;
+  errno = 0;
+  unsigned long n = strtoul(v, &end, 10);
+  if (v[0] == '-' || end == v || *end != '\0' || errno == ERANGE ||
+      n > INT_MAX) {
+    fprintf(stderr, "%s: not a whole number: %s\n", name, v);
+    return false;
+  }
+  out = (int)n;
+  return true;
+}
+
+// a finite number of at least 0
+static bool parse_rate(const char* name, const char* v, double& out) {
+  char* end = nullptr;
+  errno = 0;
+  double n = strtod(v, &end);
+  if (end == v || *end != '\0' || errno == ERANGE || !std::isfinite(n) ||
+      n < 0) {
+    fprintf(stderr, "%s: not a rate: %s\n", name, v);
+    return false;
+  }
+  out = n;
+  return true;
+}
+
+static bool parse_args(int argc, char** argv, Options& opt) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    auto value = [&](const char* name) -> const char* {
+      if (i + 1 >= argc) {
+        fprintf(stderr, "%s needs a value\n", name);
+        return nullptr;
+      }
+      return argv[++i];
+    };
+    const char* v = nullptr;
+
+    if (arg == "-h" || arg == "--help") {
+      usage(stdout);
+      exit(0);
+    } else if (arg == "-s" || arg == "--source") {
+      if (!(v = value("--source"))) return false;
+      opt.source = v;
+    } else if (arg == "-o" || arg == "--out") {
+      if (!(v = value("--out"))) return false;
+      opt.output_dir = v;
+    } else if (arg == "-p" || arg == "--partitions") {
+      if (!(v = value("--partitions"))) return false;
+      opt.partitions = v;
+    } else if (arg == "-j" || arg == "--jobs") {
+      if (!(v = value("--jobs")) || !parse_count("--jobs", v, opt.jobs))
+        return false;
+    } else if (arg == "--one-pass") {
+      opt.one_pass = true;
+    } else if (arg == "--verify") {
+      opt.verify = true;
+    } else if (arg == "--no-verify") {
+      opt.verify = false;
+    } else if (arg == "--low-memory") {
+      opt.low_memory = true;
+    } else if (arg == "--memory-budget") {
+      if (!(v = value("--memory-budget")) ||
+          !parse_count("--memory-budget", v, opt.memory_budget_mb))
+        return false;
+    } else if (arg == "--net-limit") {
+      if (!(v = value("--net-limit")) ||
+          !parse_rate("--net-limit", v, opt.net_limit_mbs))
+        return false;
+    } else if (arg == "--disk-limit") {
+      if (!(v = value("--disk-limit")) ||
+          !parse_rate("--disk-limit", v, opt.disk_limit_mbs))
+        return false;
+    } else if (arg == "--direct-io") {
+      if (!(v = value("--direct-io")) ||
+          !parse_count("--direct-io", v, opt.direct_io_mb))
+        return false;
+    } else if (arg == "--no-merge") {
+      opt.merge = false;
+    } else if (arg == "--mmap") {
+      opt.mmap = true;
+    } else if (arg == "--follow") {
+      if (!(v = value("--follow")) || !parse_count("--follow", v, opt.follow_s))
+        return false;
+    } else if (arg == "--host-requests") {
+      if (!(v = value("--host-requests")) ||
+          !parse_count("--host-requests", v, opt.host_requests))
+        return false;
+    } else if (arg == "--stats") {
+      opt.stats = true;
+    } else if (arg == "--threads") {
+      if (!(v = value("--threads")) ||
+          !parse_count("--threads", v, opt.threads))
+        return false;
+    } else if (arg == "--decode-threads") {
+      if (!(v = value("--decode-threads")) ||
+          !parse_count("--decode-threads", v, opt.decode_threads))
+        return false;
+    } else if (arg == "--interval") {
+      if (!(v = value("--interval")) ||
+          !parse_count("--interval", v, opt.interval_ms))
+        return false;
+    } else if (arg == "--user-agent") {
+      if (!(v = value("--user-agent"))) return false;
+      opt.user_agent = v;
+    } else {
+      fprintf(stderr, "unknown option: %s\n", arg.c_str());
+      return false;
+    }
+  }
+
+  if (opt.source.empty()) {
+    fprintf(stderr, "--source is required\n");
+    return false;
+  }
+  if (opt.jobs < 1) opt.jobs = 1;
+  if (opt.interval_ms < 50) opt.interval_ms = 50;
+  if (opt.memory_budget_mb < 0) opt.memory_budget_mb = 0;
+  if (opt.net_limit_mbs < 0) opt.net_limit_mbs = 0;
+  if (opt.disk_limit_mbs < 0) opt.disk_limit_mbs = 0;
+  if (opt.direct_io_mb < 0) opt.direct_io_mb = 0;
+  if (opt.host_requests < 0) opt.host_requests = 0;
+  if (opt.follow_s < 0) opt.follow_s = 0;
+  if (opt.threads < 0) opt.threads = 0;
+  if (opt.decode_threads < 0) opt.decode_threads = 0;
+  if (opt.user_agent.empty()) {
+    char ua[64];
+    snprintf(ua, sizeof(ua), "PayloadDumper-CLI/%d.%d.%d",
+             PAYLOAD_DUMPER_MAJOR, PAYLOAD_DUMPER_MINOR, PAYLOAD_DUMPER_PATCH);
+    opt.user_agent = ua;
+  }
+  return true;
+}
+
+// stdout is shared by the reporter and the workers
+static std::mutex out_mutex;
+
+static void emit(const std::string& line) {
+  std::lock_guard<std::mutex> lock(out_mutex);
+  fputs(line.c_str(), stdout);
+  fputc('\n', stdout);
+  fflush(stdout);
+}
+
+static bool part_failed(const Part& part) {
+  return part.get_status().rfind("Completed", 0) != 0 ||
+         part.get_verify_status().find("FAILED") != std::string::npos;
+}
+
+static void on_signal(int) { shutdown_requested.store(true); }
+
+// peak resident set of the process in KiB, 0 where it is not available;
+// reported in the summary so memory profiles can be compared run to run
+static long peak_rss_kb() {
+#ifndef _WIN32
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+  }
+#endif
+  return 0;
+}
+
+// everything a run needs to report on and wait for
+struct Run {
+  std::deque<Part> parts;
+  std::mutex mutex;
+  std::condition_variable cv;
+  size_t finished = 0;
+  int failed = 0;
+  std::chrono::steady_clock::time_point started;
+
+  // called once per partition, after its verification
+  void done(Part* part) {
+    std::chrono::duration<double> took =
+        std::chrono::steady_clock::now() - started;
+    bool bad = part_failed(*part);
+
+    char tail[64];
+    snprintf(tail, sizeof(tail), ", \"seconds\": %.3f}", took.count());
+    emit("{\"event\": \"done\", \"name\": \"" + json_escape(part->name) +
+         "\", \"ok\": " + (bad ? "false" : "true") + ", \"status\": \"" +
+         json_escape(part->get_status()) + "\", \"verify\": \"" +
+         json_escape(part->get_verify_status()) + "\"" + tail);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (bad) failed++;
+    finished++;
+    cv.notify_all();
+  }
+};
+
+static void report(Run& run, int interval_ms) {
+  std::unique_lock<std::mutex> lock(run.mutex);
+  while (run.finished < run.parts.size()) {
+    run.cv.wait_for(lock, std::chrono::milliseconds(interval_ms));
+    if (run.finished >= run.parts.size()) break;
+
+    if (shutdown_requested.load()) {
+      for (auto& part : run.parts) part.cancel();
+    }
+
+    lock.unlock();
+    for (auto& part : run.parts) {
+      if (!part.extracting.load() && !part.verifying.load()) continue;
+      char line[512];
+      snprintf(line, sizeof(line),
+               "{\"event\": \"progress\", \"name\": \"%s\", "
+               "\"progress\": %.1f, \"verify_progress\": %.1f, "
+               "\"status\": \"%s\"}",
+               json_escape(part.name).c_str(), part.progress.load(),
+               part.verify_progress.load(),
+               json_escape(part.verifying.load() ? part.get_verify_status()
+                                                 : part.get_status())
+                   .c_str());
+      emit(line);
+    }
+    lock.lock();
+  }
+}
+
+int main(int argc, char** argv) {
+  Options opt;
+  if (!parse_args(argc, argv, opt)) {
+    usage(stderr);
+    return 2;
+  }
+
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+
+  if (opt.low_memory && payload_set_low_memory(1) != 0) {
+    fprintf(stderr, "error: %s\n", payload_get_last_error());
+    return 1;
+  }
+
+  PayloadConfig config = {};
+  config.worker_threads = opt.threads;
+  config.decode_threads = opt.decode_threads;
+  config.memory_budget_bytes = (uint64_t)opt.memory_budget_mb * 1024 * 1024;
+  if (payload_init_ex(&config) != 0) {
+    fprintf(stderr, "error: %s\n", payload_get_last_error());
+    return 1;
+  }
+  payload_set_rate_limits((uint64_t)(opt.net_limit_mbs * 1024 * 1024),
+                          (uint64_t)(opt.disk_limit_mbs * 1024 * 1024), 0, 0);
+  payload_set_direct_io((uint64_t)opt.direct_io_mb * 1024 * 1024);
+  payload_set_write_merging(opt.merge ? 1 : 0);
+  payload_set_local_mmap(opt.mmap ? 1 : 0);
+  payload_set_follow((uint64_t)opt.follow_s * 1000);
+  if (payload_configure_http(opt.host_requests, 0) != 0) {
+    fprintf(stderr, "error: %s\n", payload_get_last_error());
+    return 1;
+  }
+
+  SourceMode mode = source_mode(opt.source);
+  char* json_result =
+      mode == SourceMode::SRC_FILE
+          ? payload_list_local_partitions(opt.source.c_str())
+          : payload_list_remote_partitions(opt.source.c_str(),
+                                           opt.user_agent.c_str(), nullptr);
+  if (!json_result) {
+    const char* err = payload_get_last_error();
+    fprintf(stderr, "error: %s\n", err ? err : "Failed to load partitions");
+    return 1;
+  }
+
+  std::deque<Part> listed;
+  bool ok = read_partitions(json_result, listed);
+  payload_free_string(json_result);
+  if (!ok) {
+    fprintf(stderr, "error: Failed to parse partition information\n");
+    return 1;
+  }
+
+  Run run;
+  std::vector<std::string> names = parse_rule(opt.partitions);
+  for (auto& part : listed) {
+    if (rule_matches(names, part.name)) {
+      part.set_status("Queued");
+      run.parts.emplace_back(std::move(part));
+    }
+  }
+  if (run.parts.empty()) {
+    fprintf(stderr, "error: No matching partitions\n");
+    return 1;
+  }
+
+  uint64_t total_bytes = 0;
+  for (const auto& part : run.parts) total_bytes += part.size_bytes;
+  char start[128];
+  snprintf(start, sizeof(start),
+           "{\"event\": \"start\", \"partitions\": %zu, "
+           "\"total_bytes\": %llu, \"one_pass\": %s}",
+           run.parts.size(), (unsigned long long)total_bytes,
+           opt.one_pass ? "true" : "false");
+  emit(start);
+
+  run.started = std::chrono::steady_clock::now();
+  std::thread reporter(report, std::ref(run), opt.interval_ms);
+  std::vector<std::thread> workers;
+
+  if (opt.one_pass) {
+    std::vector<Part*> parts;
+    for (auto& part : run.parts) {
+      part.extracting.store(true);
+      parts.push_back(&part);
+    }
+    workers.emplace_back([&run, &opt, mode, parts] {
+      dump_one_pass(parts, opt.source, mode, opt.output_dir, opt.user_agent,
+                    opt.verify, [&run](Part* part) { run.done(part); });
+    });
+  } else {
+    // workers take the next partition off a shared counter and move on as
+    // soon as the image is handed to the verifier
+    std::atomic<size_t> next(0);
+    int count = std::min<int>(opt.jobs, static_cast<int>(run.parts.size()));
+    for (int i = 0; i < count; i++) {
+      workers.emplace_back([&run, &opt, &next, mode] {
+        for (size_t n; (n = next++) < run.parts.size();) {
+          Part* part = &run.parts[n];
+          if (shutdown_requested.load()) {
+            part->set_status("Cancelled");
+            run.done(part);
+            continue;
+          }
+          part->extracting.store(true);
+          part->set_status("Starting...");
+          dump_part(part, opt.source, mode, opt.output_dir, opt.user_agent,
+                    opt.verify, [&run, part] { run.done(part); });
+        }
+      });
+    }
+    for (auto& t : workers) t.join();
+    workers.clear();
+  }
+
+  for (auto& t : workers) t.join();
+  reporter.join();
+  verifier.stop();
+  for (auto& t : verifier.workers) t.join();
+
+  std::chrono::duration<double> took =
+      std::chrono::steady_clock::now() - run.started;
+  char summary[256];
+  snprintf(summary, sizeof(summary),
+           "{\"event\": \"summary\", \"partitions\": %zu, \"failed\": %d, "
+           "\"cancelled\": %s, \"seconds\": %.3f, \"peak_rss_kb\": %ld}",
+           run.parts.size(), run.failed,
+           shutdown_requested.load() ? "true" : "false", took.count(),
+           peak_rss_kb());
+  emit(summary);
+
+  // write speed, merged writes and the like, to compare runs
+  if (opt.stats) {
+    char* stats = payload_get_stats();
+    if (stats) {
+      std::string flat = stats;
+      std::replace(flat.begin(), flat.end(), '\n', ' ');
+      emit("{\"event\": \"stats\", \"stats\": " + flat + "}");
+      payload_free_string(stats);
+    }
+  }
+
+  payload_cleanup();
+  return run.failed > 0 || shutdown_requested.load() ? 1 : 0;
+}
@@ -0,0 +1,450 @@
+#include "core.h"
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <set>
+#include "json.h"
+#include "sha256.h"
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+std::atomic<bool> shutdown_requested(false);
+std::atomic<int> live_threads(0);
+BufferPool verify_buffers(1024 * 1024);
+
+SourceMode source_mode(const std::string& source) {
+  return (source.rfind("http://", 0) == 0 || source.rfind("https://", 0) == 0)
+             ? SourceMode::SRC_URL
+             : SourceMode::SRC_FILE;
+}
+
+std::string part_output_path(const std::string& output_dir,
+                             const std::string& name) {
+  return output_dir + "/" + name + ".img";
+}
+
+void read_part_list(struct json_array_s* arr, std::deque<Part>& parts) {
+  for (struct json_array_element_s* part_elem = arr->start; part_elem;
+       part_elem = part_elem->next) {
+    struct json_object_s* part_obj =
+        (struct json_object_s*)part_elem->value->payload;
+
+    Part info;
+    for (struct json_object_element_s* field = part_obj->start; field;
+         field = field->next) {
+      const char* field_key = field->name->string;
+
+      if (strcmp(field_key, "name") == 0) {
+        struct json_string_s* str =
+            (struct json_string_s*)field->value->payload;
+        info.name = str->string;
+      } else if (strcmp(field_key, "size_bytes") == 0) {
+        struct json_number_s* num =
+            (struct json_number_s*)field->value->payload;
+        info.size_bytes = strtoull(num->number, nullptr, 10);
+      } else if (strcmp(field_key, "size_readable") == 0) {
+        struct json_string_s* str =
+            (struct json_string_s*)field->value->payload;
+        info.size_readable = str->string;
+      } else if (strcmp(field_key, "operations_count") == 0) {
+        struct json_number_s* num =
+            (struct json_number_s*)field->value->payload;
+        info.operations_count = strtoull(num->number, nullptr, 10);
+      } else if (strcmp(field_key, "hash") == 0) {
+        struct json_string_s* str =
+            (struct json_string_s*)field->value->payload;
+        info.hash = str->string;
+      }
+    }
+
+    parts.emplace_back(std::move(info));
+  }
+}
+
+bool read_partitions(const char* json_str, std::deque<Part>& parts) {
+  struct json_value_s* root = json_parse(json_str, strlen(json_str));
+  if (!root) return false;
+
+  struct json_object_s* root_obj = (struct json_object_s*)root->payload;
+  for (struct json_object_element_s* elem = root_obj->start; elem;
+       elem = elem->next) {
+    if (strcmp(elem->name->string, "partitions") == 0) {
+      read_part_list((struct json_array_s*)elem->value->payload, parts);
+    }
+  }
+
+  free(root);
+  return true;
+}
+
+std::vector<std::string> parse_rule(const std::string& rule) {
+  std::vector<std::string> names;
+  std::string cur;
+  for (char c : rule) {
+    if (c == ',' || c == ' ' || c == '\t' || c == ';') {
+      if (!cur.empty()) names.push_back(cur);
+      cur.clear();
+    } else {
+      cur += c;
+    }
+  }
+  if (!cur.empty()) names.push_back(cur);
+  return names;
+}
+
+bool rule_matches(const std::vector<std::string>& names,
+                  const std::string& name) {
+  if (names.empty()) return true;
+  for (const auto& n : names) {
+    if (n == "*" || n == name) return true;
+  }
+  return false;
+}
+
+std::string json_escape(const std::string& in) {
+  std::string out;
+  for (char c : in) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      out += buf;
+    } else {
+      out += c;
+    }
+  }
+  return out;
+}
+
+static bool same_hex(const char* a, const std::string& b) {
+  if (strlen(a) != b.size()) return false;
+  for (size_t i = 0; i < b.size(); i++) {
+    if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int32_t progress_callback(void* user_data, const char* partition_name,
+                          uint64_t current_op, uint64_t total_ops,
+                          double percentage, int32_t status,
+                          const char* warning_msg) {
+  Part* info = static_cast<Part*>(user_data);
+
+  if (info->cancel_flag.load() || shutdown_requested.load()) {
+    return 0;
+  }
+
+  info->progress.store(static_cast<float>(percentage));
+
+  switch (status) {
+    case STATUS_STARTED:
+      info->set_status("Starting...");
+      break;
+    case STATUS_IN_PROGRESS:
+      info->set_status("Extracting...");
+      break;
+    case STATUS_COMPLETED:
+      info->set_status("Completed");
+      break;
+    case STATUS_WARNING:
+      if (warning_msg) {
+        info->set_status(std::string("Warning: ") + warning_msg);
+      }
+      break;
+  }
+
+  return 1;
+}
+
+// size of an open file; ftell() returns a long, which is 32 bits on Windows
+// and cannot count past 2 GiB
+static uint64_t file_size_of(FILE* file) {
+#ifdef _WIN32
+  _fseeki64(file, 0, SEEK_END);
+  int64_t size = _ftelli64(file);
+  _fseeki64(file, 0, SEEK_SET);
+#else
+  fseeko(file, 0, SEEK_END);
+  off_t size = ftello(file);
+  fseeko(file, 0, SEEK_SET);
+#endif
+  return size < 0 ? 0 : (uint64_t)size;
+}
+
+void verify_part(Part* info, const std::string& output_path) {
+  info->verifying.store(true);
+  info->verify_progress.store(0.0f);
+  info->set_verify_status("Verifying...");
+
+  FILE* file = fopen(output_path.c_str(), "rb");
+  if (!file) {
+    info->set_verify_status("Error: Cannot open file");
+    info->verification_passed.store(false);
+    info->verifying.store(false);
+    return;
+  }
+
+  uint64_t file_size = file_size_of(file);
+
+  SHA256_CTX ctx;
+  sha256_init(&ctx);
+
+  const size_t BUFFER_SIZE = verify_buffers.buffer_size;
+  std::unique_ptr<uint8_t[]> buffer = verify_buffers.acquire();
+  uint64_t bytes_read = 0;
+
+  while (!feof(file) && !info->cancel_flag.load() &&
+         !shutdown_requested.load()) {
+    size_t n = fread(buffer.get(), 1, BUFFER_SIZE, file);
+    if (n > 0) {
+      sha256_update(&ctx, buffer.get(), n);
+      bytes_read += n;
+      float progress = (bytes_read * 100.0f) / file_size;
+      info->verify_progress.store(progress);
+    }
+    if (n < BUFFER_SIZE) break;
+  }
+
+  verify_buffers.release(std::move(buffer));
+  fclose(file);
+
+  if (info->cancel_flag.load() || shutdown_requested.load()) {
+    info->set_verify_status("Verification cancelled");
+    info->verification_passed.store(false);
+    info->verifying.store(false);
+    return;
+  }
+
+  uint8_t computed_hash[SHA256_DIGEST_SIZE];
+  sha256_final(&ctx, computed_hash);
+
+  char computed_hex[65];
+  sha256_to_hex(computed_hash, computed_hex);
+
+  if (info->hash.empty()) {
+    info->set_verify_status("No hash to verify");
+    info->verification_passed.store(false);
+  } else if (same_hex(computed_hex, info->hash)) {
+    info->set_verify_status("Verified");
+    info->verification_passed.store(true);
+    payload_record_output_digest(output_path.c_str(), computed_hex);
+  } else {
+    info->set_verify_status("Verification FAILED!");
+    info->verification_passed.store(false);
+  }
+
+  info->verify_progress.store(100.0f);
+  info->verifying.store(false);
+}
+
+void VerifyPool::run() {
+  LiveThread live;
+#ifdef _WIN32
+  SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+#endif
+  for (;;) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [this] { return stopping || !queue.empty(); });
+      if (queue.empty()) break;
+      task = std::move(queue.front());
+      queue.pop_front();
+    }
+
+    active++;
+    verify_part(task.part, task.path);
+    active--;
+    if (task.done) task.done();
+  }
+}
+
+VerifyPool verifier(2);
+
+// report how an extraction ended and, unless the image was already checked
+// while it was written, hand it to the verifier
+void finish_part(Part* info, const std::string& output_path, bool ok,
+                 const std::string& error, bool verify,
+                 std::function<void()> done) {
+  if (!ok && !info->cancel_flag.load()) {
+    info->set_status("Error: " + error);
+  } else if (info->cancel_flag.load()) {
+    info->set_status("Cancelled");
+  } else {
+    info->set_status("Completed");
+
+    if (verify && !info->hash.empty() &&
+        payload_is_output_up_to_date(output_path.c_str(), info->hash.c_str()) ==
+            1) {
+      // already checked against the manifest hash while it was written
+      info->verify_progress.store(100.0f);
+      info->set_verify_status("Verified");
+      info->verification_passed.store(true);
+    } else if (verify && !info->hash.empty()) {
+      info->extracting.store(false);
+      verifier.submit({info, output_path, std::move(done)});
+      return;
+    } else if (verify && info->hash.empty()) {
+      info->set_verify_status("No hash available");
+    }
+  }
+
+  info->extracting.store(false);
+  if (done) done();
+}
+
+// true when an earlier run left an image that is unchanged and matches the
+// manifest, so neither extraction nor verification is needed
+bool skip_up_to_date(Part* info, const std::string& output_path, bool verify) {
+  if (info->hash.empty() ||
+      payload_is_output_up_to_date(output_path.c_str(), info->hash.c_str()) !=
+          1) {
+    return false;
+  }
+  info->progress.store(100.0f);
+  info->set_status("Completed (cached)");
+  if (verify) {
+    info->set_verify_status("Verified");
+    info->verification_passed.store(true);
+  }
+  info->extracting.store(false);
+  return true;
+}
+
+void dump_part(Part* info, const std::string& source_path, SourceMode mode,
+               const std::string& output_dir, const std::string& user_agent,
+               bool verify, std::function<void()> done) {
+  std::string output_path = part_output_path(output_dir, info->name);
+
+  if (skip_up_to_date(info, output_path, verify)) {
+    if (done) done();
+    return;
+  }
+
+  PayloadCancelToken* token = payload_cancel_token_new();
+  {
+    std::lock_guard<std::mutex> lock(info->status_mutex);
+    info->cancel_token = token;
+  }
+  if (info->cancel_flag.load() || shutdown_requested.load()) {
+    payload_cancel_token_cancel(token);
+  }
+
+  int32_t result = -1;
+
+  if (mode == SourceMode::SRC_FILE) {
+    result = payload_extract_local_partition_cancellable(
+        source_path.c_str(), info->name.c_str(), output_path.c_str(), nullptr,
+        progress_callback, info, token);
+  } else {
+    result = payload_extract_remote_partition_cancellable(
+        source_path.c_str(), info->name.c_str(), output_path.c_str(),
+        user_agent.c_str(), nullptr, nullptr, progress_callback, info, token);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(info->status_mutex);
+    info->cancel_token = nullptr;
+  }
+  payload_cancel_token_free(token);
+
+  const char* err = result != 0 ? payload_get_last_error() : nullptr;
+  finish_part(info, output_path, result == 0,
+              err ? std::string(err) : "Extraction failed", verify,
+              std::move(done));
+}
+
+// one extraction covering several partitions: callbacks are routed to the
+// matching Part by name and all parts share one cancel token
+struct OnePass {
+  std::map<std::string, Part*> parts;
+  std::mutex mutex;
+  std::set<std::string> completed;
+};
+
+int32_t pass_callback(void* user_data, const char* partition_name,
+                      uint64_t current_op, uint64_t total_ops,
+                      double percentage, int32_t status,
+                      const char* warning_msg) {
+  OnePass* pass = static_cast<OnePass*>(user_data);
+  auto it = pass->parts.find(partition_name);
+  if (it == pass->parts.end()) return 1;
+
+  if (status == STATUS_COMPLETED) {
+    std::lock_guard<std::mutex> lock(pass->mutex);
+    pass->completed.insert(partition_name);
+  }
+  return progress_callback(it->second, partition_name, current_op, total_ops,
+                           percentage, status, warning_msg);
+}
+
+void dump_one_pass(std::vector<Part*> parts, const std::string& source_path,
+                   SourceMode mode, const std::string& output_dir,
+                   const std::string& user_agent, bool verify,
+                   std::function<void(Part*)> done) {
+  OnePass pass;
+  std::vector<const char*> names;
+  for (Part* info : parts) {
+    if (skip_up_to_date(info, part_output_path(output_dir, info->name),
+                         verify)) {
+      if (done) done(info);
+      continue;
+    }
+    pass.parts[info->name] = info;
+    names.push_back(info->name.c_str());
+  }
+  if (names.empty()) return;
+
+  PayloadCancelToken* token = payload_cancel_token_new();
+  bool cancelled = shutdown_requested.load();
+  for (auto& entry : pass.parts) {
+    std::lock_guard<std::mutex> lock(entry.second->status_mutex);
+    entry.second->cancel_token = token;
+    if (entry.second->cancel_flag.load()) cancelled = true;
+  }
+  if (cancelled) payload_cancel_token_cancel(token);
+
+  int32_t result = -1;
+
+  if (mode == SourceMode::SRC_FILE) {
+    result = payload_extract_local_partitions(
+        source_path.c_str(), names.data(), names.size(), output_dir.c_str(),
+        nullptr, pass_callback, &pass, token);
+  } else {
+    result = payload_extract_remote_partitions(
+        source_path.c_str(), names.data(), names.size(), output_dir.c_str(),
+        user_agent.c_str(), nullptr, nullptr, pass_callback, &pass, token);
+  }
+
+  const char* err = result != 0 ? payload_get_last_error() : nullptr;
+  std::string error = err ? err : "Extraction failed";
+
+  // cancelling one part stops the pass for all of them
+  cancelled = shutdown_requested.load();
+  for (auto& entry : pass.parts) {
+    if (entry.second->cancel_flag.load()) cancelled = true;
+  }
+
+  for (auto& entry : pass.parts) {
+    Part* info = entry.second;
+    {
+      std::lock_guard<std::mutex> lock(info->status_mutex);
+      info->cancel_token = nullptr;
+    }
+
+    std::string output_path = part_output_path(output_dir, info->name);
+    bool ok = result == 0 || pass.completed.count(info->name) > 0;
+    if (!ok && cancelled) info->cancel_flag.store(true);
+    std::function<void()> part_done;
+    if (done) part_done = [done, info] { done(info); };
+    finish_part(info, output_path, ok, error, verify, std::move(part_done));
+  }
+  payload_cancel_token_free(token);
+}
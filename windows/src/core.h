@@ -0,0 +1,257 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "payload_dumper.hpp"
+
+// extraction pipeline shared by the GUI and the command-line tool: listing,
+// extraction, one-pass extraction and verification, with no dependency on
+// the window, ImGui or any Windows API
+
+enum class SourceMode { SRC_FILE, SRC_URL };
+
+// set once the process is shutting down; every worker checks it
+extern std::atomic<bool> shutdown_requested;
+
+struct Part {
+  std::string name;
+  uint64_t size_bytes;
+  std::string size_readable;
+  uint64_t operations_count;
+  std::string hash;
+
+  std::atomic<bool> selected;
+  std::atomic<bool> extracting;
+  std::atomic<bool> verifying;
+  std::atomic<float> progress;
+  std::atomic<float> verify_progress;
+  std::atomic<bool> cancel_flag;
+  std::atomic<bool> verification_passed;
+
+  mutable std::mutex status_mutex;
+  std::string status_msg;
+  std::string verify_status_msg;
+  PayloadCancelToken* cancel_token;
+
+  Part()
+      : size_bytes(0),
+        operations_count(0),
+        selected(false),
+        extracting(false),
+        verifying(false),
+        progress(0.0f),
+        verify_progress(0.0f),
+        cancel_flag(false),
+        verification_passed(false),
+        cancel_token(nullptr) {}
+
+  Part(const Part&) = delete;
+  Part& operator=(const Part&) = delete;
+
+  Part(Part&& other) noexcept
+      : name(std::move(other.name)),
+        size_bytes(other.size_bytes),
+        size_readable(std::move(other.size_readable)),
+        operations_count(other.operations_count),
+        hash(std::move(other.hash)),
+        selected(other.selected.load()),
+        extracting(other.extracting.load()),
+        verifying(other.verifying.load()),
+        progress(other.progress.load()),
+        verify_progress(other.verify_progress.load()),
+        cancel_flag(other.cancel_flag.load()),
+        verification_passed(other.verification_passed.load()),
+        status_msg(std::move(other.status_msg)),
+        verify_status_msg(std::move(other.verify_status_msg)),
+        cancel_token(other.cancel_token) {}
+
+  Part& operator=(Part&& other) noexcept {
+    if (this != &other) {
+      name = std::move(other.name);
+      size_bytes = other.size_bytes;
+      size_readable = std::move(other.size_readable);
+      operations_count = other.operations_count;
+      hash = std::move(other.hash);
+      selected.store(other.selected.load());
+      extracting.store(other.extracting.load());
+      verifying.store(other.verifying.load());
+      progress.store(other.progress.load());
+      verify_progress.store(other.verify_progress.load());
+      cancel_flag.store(other.cancel_flag.load());
+      verification_passed.store(other.verification_passed.load());
+      std::lock_guard<std::mutex> lock(status_mutex);
+      status_msg = std::move(other.status_msg);
+      verify_status_msg = std::move(other.verify_status_msg);
+      cancel_token = other.cancel_token;
+    }
+    return *this;
+  }
+
+  // stops a running extraction right away rather than at its next
+  // progress callback
+  void cancel() {
+    cancel_flag.store(true);
+    std::lock_guard<std::mutex> lock(status_mutex);
+    if (cancel_token) payload_cancel_token_cancel(cancel_token);
+  }
+
+  void set_status(const std::string& msg) {
+    std::lock_guard<std::mutex> lock(status_mutex);
+    status_msg = msg;
+  }
+
+  std::string get_status() const {
+    std::lock_guard<std::mutex> lock(status_mutex);
+    return status_msg;
+  }
+
+  void set_verify_status(const std::string& msg) {
+    std::lock_guard<std::mutex> lock(status_mutex);
+    verify_status_msg = msg;
+  }
+
+  std::string get_verify_status() const {
+    std::lock_guard<std::mutex> lock(status_mutex);
+    return verify_status_msg;
+  }
+};
+
+// every worker thread is counted so shutdown can wait for them with a deadline
+extern std::atomic<int> live_threads;
+
+struct LiveThread {
+  LiveThread() { live_threads++; }
+  ~LiveThread() { live_threads--; }
+};
+
+struct BufferPool {
+  const size_t buffer_size;
+  std::mutex mutex;
+  std::vector<std::unique_ptr<uint8_t[]>> free_list;
+
+  explicit BufferPool(size_t size) : buffer_size(size) {}
+
+  std::unique_ptr<uint8_t[]> acquire() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (free_list.empty()) {
+      return std::unique_ptr<uint8_t[]>(new uint8_t[buffer_size]);
+    }
+    std::unique_ptr<uint8_t[]> buffer = std::move(free_list.back());
+    free_list.pop_back();
+    return buffer;
+  }
+
+  void release(std::unique_ptr<uint8_t[]> buffer) {
+    std::lock_guard<std::mutex> lock(mutex);
+    free_list.push_back(std::move(buffer));
+  }
+};
+
+extern BufferPool verify_buffers;
+
+// hashing runs on its own small pool at background priority, so an
+// extraction thread hands the finished image over and returns right away;
+// decoding of the next partition overlaps with hashing of the previous one
+struct VerifyPool {
+  struct Task {
+    Part* part;
+    std::string path;
+    std::function<void()> done;
+  };
+
+  const int worker_count;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<Task> queue;
+  std::vector<std::thread> workers;
+  std::atomic<int> active;
+  bool stopping;
+
+  explicit VerifyPool(int n) : worker_count(n), active(0), stopping(false) {}
+
+  void submit(Task task) {
+    task.part->verifying.store(true);
+    task.part->verify_progress.store(0.0f);
+    task.part->set_verify_status("Queued");
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (workers.empty()) {
+      for (int i = 0; i < worker_count; i++) {
+        workers.emplace_back(&VerifyPool::run, this);
+      }
+    }
+    queue.push_back(std::move(task));
+    cv.notify_one();
+  }
+
+  size_t pending() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return queue.size();
+  }
+
+  void run();
+
+  // drop queued images and let the workers exit once their current one is
+  // cancelled; the threads are joined (or abandoned) by quit()
+  void stop() {
+    std::deque<Task> dropped;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+      dropped.swap(queue);
+    }
+    cv.notify_all();
+
+    for (auto& task : dropped) {
+      task.part->set_verify_status("Verification cancelled");
+      task.part->verifying.store(false);
+      if (task.done) task.done();
+    }
+  }
+};
+
+extern VerifyPool verifier;
+
+// http(s) URLs are remote, anything else is a local file
+SourceMode source_mode(const std::string& source);
+std::string part_output_path(const std::string& output_dir,
+                             const std::string& name);
+
+// partitions of a payload_list_*_partitions() result
+void read_part_list(struct json_array_s* arr, std::deque<Part>& parts);
+bool read_partitions(const char* json_str, std::deque<Part>& parts);
+
+std::vector<std::string> parse_rule(const std::string& rule);
+bool rule_matches(const std::vector<std::string>& names,
+                  const std::string& name);
+std::string json_escape(const std::string& in);
+
+int32_t progress_callback(void* user_data, const char* partition_name,
+                          uint64_t current_op, uint64_t total_ops,
+                          double percentage, int32_t status,
+                          const char* warning_msg);
+void verify_part(Part* info, const std::string& output_path);
+void finish_part(Part* info, const std::string& output_path, bool ok,
+                 const std::string& error, bool verify,
+                 std::function<void()> done);
+bool skip_up_to_date(Part* info, const std::string& output_path, bool verify);
+
+// `done` runs once the partition is finished, including its verification
+void dump_part(Part* info, const std::string& source_path, SourceMode mode,
+               const std::string& output_dir, const std::string& user_agent,
+               bool verify, std::function<void()> done);
+
+// extracts `parts` with a single forward read of the payload rather than one
+// scattered reader per partition; `done` runs once for every part
+void dump_one_pass(std::vector<Part*> parts, const std::string& source_path,
+                   SourceMode mode, const std::string& output_dir,
+                   const std::string& user_agent, bool verify,
+                   std::function<void(Part*)> done);
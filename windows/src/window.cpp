@@ -4,113 +4,64 @@
 #include <shlobj.h>
 #include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
 #include <cstdio>
 #include <cstring>
 #include <deque>
+#include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <string>
 #include <thread>
 #include <vector>
+#include "core.h"
 #include "imgui.h"
 #include "json.h"
 #include "payload_dumper.hpp"
-#include "sha256.h"
-
-struct Part {
-  std::string name;
-  uint64_t size_bytes;
-  std::string size_readable;
-  uint64_t operations_count;
-  std::string hash;
-
-  std::atomic<bool> selected;
-  std::atomic<bool> extracting;
-  std::atomic<bool> verifying;
-  std::atomic<float> progress;
-  std::atomic<float> verify_progress;
-  std::atomic<bool> cancel_flag;
-  std::atomic<bool> verification_passed;
-
-  mutable std::mutex status_mutex;
-  std::string status_msg;
-  std::string verify_status_msg;
-
-  Part()
-      : size_bytes(0),
-        operations_count(0),
-        selected(false),
-        extracting(false),
-        verifying(false),
-        progress(0.0f),
-        verify_progress(0.0f),
-        cancel_flag(false),
-        verification_passed(false) {}
-
-  Part(const Part&) = delete;
-  Part& operator=(const Part&) = delete;
-
-  Part(Part&& other) noexcept
-      : name(std::move(other.name)),
-        size_bytes(other.size_bytes),
-        size_readable(std::move(other.size_readable)),
-        operations_count(other.operations_count),
-        hash(std::move(other.hash)),
-        selected(other.selected.load()),
-        extracting(other.extracting.load()),
-        verifying(other.verifying.load()),
-        progress(other.progress.load()),
-        verify_progress(other.verify_progress.load()),
-        cancel_flag(other.cancel_flag.load()),
-        verification_passed(other.verification_passed.load()),
-        status_msg(std::move(other.status_msg)),
-        verify_status_msg(std::move(other.verify_status_msg)) {}
-
-  Part& operator=(Part&& other) noexcept {
-    if (this != &other) {
-      name = std::move(other.name);
-      size_bytes = other.size_bytes;
-      size_readable = std::move(other.size_readable);
-      operations_count = other.operations_count;
-      hash = std::move(other.hash);
-      selected.store(other.selected.load());
-      extracting.store(other.extracting.load());
-      verifying.store(other.verifying.load());
-      progress.store(other.progress.load());
-      verify_progress.store(other.verify_progress.load());
-      cancel_flag.store(other.cancel_flag.load());
-      verification_passed.store(other.verification_passed.load());
-      std::lock_guard<std::mutex> lock(status_mutex);
-      status_msg = std::move(other.status_msg);
-      verify_status_msg = std::move(other.verify_status_msg);
-    }
-    return *this;
-  }
-
-  void set_status(const std::string& msg) {
-    std::lock_guard<std::mutex> lock(status_mutex);
-    status_msg = msg;
-  }
-
-  std::string get_status() const {
-    std::lock_guard<std::mutex> lock(status_mutex);
-    return status_msg;
-  }
-
-  void set_verify_status(const std::string& msg) {
-    std::lock_guard<std::mutex> lock(status_mutex);
-    verify_status_msg = msg;
-  }
 
-  std::string get_verify_status() const {
-    std::lock_guard<std::mutex> lock(status_mutex);
-    return verify_status_msg;
-  }
+struct EngineStats {
+  uint64_t prefetch_hits;
+  uint64_t prefetch_stalls;
+  double remote_rtt_ms;
+  double remote_list_ms_last;
+  uint64_t remote_open_requests_last;
+  uint64_t memory_limit_bytes;
+  uint64_t memory_in_use_bytes;
+  uint64_t memory_peak_bytes;
+  uint64_t memory_waiting_jobs;
+  uint64_t pool_allocations;
+  uint64_t pool_reuses;
+  uint64_t cache_hits;
+  uint64_t cache_bytes_saved;
+  uint64_t disk_jobs_active;
+  uint64_t disk_jobs_waiting;
+  uint64_t network_jobs_waiting;
+
+  EngineStats()
+      : prefetch_hits(0),
+        prefetch_stalls(0),
+        remote_rtt_ms(0.0),
+        remote_list_ms_last(0.0),
+        remote_open_requests_last(0),
+        memory_limit_bytes(0),
+        memory_in_use_bytes(0),
+        memory_peak_bytes(0),
+        memory_waiting_jobs(0),
+        pool_allocations(0),
+        pool_reuses(0),
+        cache_hits(0),
+        cache_bytes_saved(0),
+        disk_jobs_active(0),
+        disk_jobs_waiting(0),
+        network_jobs_waiting(0) {}
 };
 
 struct Status {
-  enum class Source { SRC_FILE, SRC_URL };
+  using Source = SourceMode;
   enum class SRC_TYPE { TYPE_NONE, TYPE_BIN, TYPE_ZIP };
 
   Source input_mode;
@@ -136,12 +87,33 @@ struct Status {
   bool show_error_popup;
   bool partitions_loaded;
   bool enable_verification;
+  bool one_pass;
+  int memory_budget_mb;
+
+  // bandwidth limits in MB/s, 0 = unlimited; applied live
+  float net_limit_mbs;
+  float disk_limit_mbs;
+  float job_net_limit_mbs;
+  float job_disk_limit_mbs;
+
+  // engine tuning, applied with payload_init_ex(); 0 keeps the default
+  int worker_threads;
+  int blocking_threads;
+  int http_requests;
+  int prefetch_mb;
+  int sequential_read_mb;
+  int buffer_pool_mb;
+
+  bool enable_cache;
+  int cache_size_gb;
+  char cache_dir[512];
+
+  EngineStats engine;
+  double last_stats_poll;
 
   std::atomic<bool> loading_partitions;
   std::thread loading_thread;
 
-  std::atomic<bool> shutdown_requested;
-
   Status()
       : input_mode(Source::SRC_FILE),
         detected_file_type(SRC_TYPE::TYPE_NONE),
@@ -152,8 +124,22 @@ struct Status {
         show_error_popup(false),
         partitions_loaded(false),
         enable_verification(true),
-        loading_partitions(false),
-        shutdown_requested(false) {
+        one_pass(true),
+        memory_budget_mb(0),
+        net_limit_mbs(0.0f),
+        disk_limit_mbs(0.0f),
+        job_net_limit_mbs(0.0f),
+        job_disk_limit_mbs(0.0f),
+        worker_threads(0),
+        blocking_threads(0),
+        http_requests(0),
+        prefetch_mb(0),
+        sequential_read_mb(0),
+        buffer_pool_mb(0),
+        enable_cache(false),
+        cache_size_gb(32),
+        last_stats_poll(-1.0),
+        loading_partitions(false) {
     file_path[0] = '\0';
     url_input[0] = '\0';
     output_dir[0] = '\0';
@@ -161,6 +147,15 @@ struct Status {
              PAYLOAD_DUMPER_MAJOR, PAYLOAD_DUMPER_MINOR, PAYLOAD_DUMPER_PATCH);
 
     GetCurrentDirectoryA(sizeof(output_dir), output_dir);
+
+    char local_app_data[MAX_PATH];
+    if (GetEnvironmentVariableA("LOCALAPPDATA", local_app_data,
+                                sizeof(local_app_data)) > 0) {
+      snprintf(cache_dir, sizeof(cache_dir), "%s\\PayloadDumper\\cache",
+               local_app_data);
+    } else {
+      snprintf(cache_dir, sizeof(cache_dir), "%s\\cache", output_dir);
+    }
   }
 
   void clear_partitions() {
@@ -196,6 +191,206 @@ struct Status {
 
 static Status G;
 
+struct BatchJob {
+  enum class State { QUEUED, LISTING, RUNNING, DONE, FAILED, CANCELLED };
+
+  std::string source;
+  Status::Source mode;
+  std::string rule;
+  std::string output_dir;
+
+  std::deque<Part> parts;
+  std::vector<double> part_seconds;
+  std::atomic<State> state;
+  std::atomic<int> remaining;
+  std::atomic<int> failed;
+
+  std::chrono::steady_clock::time_point queued_at;
+  std::chrono::steady_clock::time_point started_at;
+
+  mutable std::mutex mutex;
+  std::string message;
+
+  BatchJob(const std::string& src, Status::Source m, const std::string& r,
+           const std::string& out)
+      : source(src),
+        mode(m),
+        rule(r),
+        output_dir(out),
+        state(State::QUEUED),
+        remaining(0),
+        failed(0),
+        queued_at(std::chrono::steady_clock::now()) {}
+
+  void set_message(const std::string& msg) {
+    std::lock_guard<std::mutex> lock(mutex);
+    message = msg;
+  }
+
+  std::string get_message() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return message;
+  }
+};
+
+// every payload in the queue feeds one task list; a fixed set of workers
+// drains it while the next payloads are still being listed, and the library
+// scheduler applies the disk, network and decode limits across all of them
+struct Batch {
+  std::deque<std::unique_ptr<BatchJob>> jobs;
+  std::mutex jobs_mutex;
+
+  std::deque<std::pair<BatchJob*, size_t>> tasks;
+  std::mutex tasks_mutex;
+  std::condition_variable tasks_cv;
+  bool listing_done;
+
+  // while a folder is watched the lister waits for new jobs instead of
+  // finishing once the queue is empty
+  std::atomic<bool> watching;
+  std::condition_variable jobs_cv;
+
+  std::thread lister;
+  std::vector<std::thread> workers;
+  std::atomic<bool> running;
+  std::atomic<int> active_workers;
+  std::atomic<bool> cancel;
+
+  char source_input[1024];
+  char rule_input[256];
+  int parallel_jobs;
+  int disk_jobs;
+  int network_jobs;
+  int decode_threads;
+
+  Batch()
+      : listing_done(true),
+        watching(false),
+        running(false),
+        active_workers(0),
+        cancel(false),
+        parallel_jobs(8),
+        disk_jobs(0),
+        network_jobs(0),
+        decode_threads(0) {
+    source_input[0] = '\0';
+    snprintf(rule_input, sizeof(rule_input), "boot, init_boot, vendor_boot");
+  }
+};
+
+static Batch B;
+
+struct Watch {
+  struct Seen {
+    uint64_t size;
+    uint64_t write_time;
+    std::chrono::steady_clock::time_point stable_since;
+    bool queued;
+  };
+
+  char dir[512];
+  int settle_seconds;
+
+  // copied when watching starts, the inputs stay editable meanwhile
+  std::string folder;
+  std::string rule;
+  std::string output_root;
+
+  std::map<std::string, Seen> seen;
+  std::thread thread;
+  std::atomic<uint64_t> arrivals;
+
+  Watch() : settle_seconds(3), arrivals(0) { dir[0] = '\0'; }
+};
+
+static Watch W;
+
+// files inside a partition, read through payload_fs_*() so that browsing a
+// directory or pulling one file decodes only the operations that hold it
+struct Browser {
+  struct Entry {
+    std::string name;
+    std::string type;
+    uint64_t size;
+    std::string target;
+  };
+
+  int part_index;
+  PayloadFs* fs;
+
+  // written by the worker, read by the UI under `mutex`
+  std::mutex mutex;
+  std::string partition;
+  std::string filesystem;
+  std::string path;
+  std::vector<Entry> entries;
+  std::string message;
+
+  std::atomic<bool> busy;
+  std::thread worker;
+
+  Browser() : part_index(0), fs(nullptr), busy(false) {}
+
+  void set_message(const std::string& msg) {
+    std::lock_guard<std::mutex> lock(mutex);
+    message = msg;
+  }
+};
+
+static Browser F;
+
+// manifest-only comparison of two builds; nothing is read but the manifests
+struct Compare {
+  struct Changed {
+    std::string name;
+    uint64_t old_size;
+    uint64_t new_size;
+    std::string changed;  // readable estimate, empty when unknown
+    double percent;
+  };
+
+  char old_input[1024];
+  char new_input[1024];
+
+  // written by the worker, read by the UI under `mutex`
+  std::mutex mutex;
+  std::string source;  // the new build the results belong to
+  std::vector<Changed> changed;
+  std::vector<std::string> added;
+  std::vector<std::string> removed;
+  size_t unchanged;
+  std::string total;
+  std::string message;
+
+  std::atomic<bool> busy;
+  std::thread worker;
+
+  Compare() : unchanged(0), busy(false) {
+    old_input[0] = '\0';
+    new_input[0] = '\0';
+  }
+};
+
+static Compare C;
+
+// listing started in the background once a source is entered, so "Load
+// Partitions" usually finds it done
+struct Warm {
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::string wanted;  // source currently in the inputs
+  double changed_at;   // when `wanted` last changed
+  std::string source;  // source of the last prefetch started, "" for none
+  std::string json;    // its listing, empty while running or on failure
+  bool done;
+  PayloadCancelToken* token;
+  std::thread worker;
+
+  Warm() : changed_at(0.0), done(false), token(nullptr) {}
+};
+
+static Warm P;
+
 bool chooser(char* buffer, size_t buffer_size) {
   OPENFILENAMEA ofn;
   ZeroMemory(&ofn, sizeof(ofn));
@@ -264,238 +459,843 @@ bool read_json(const char* json_str, Status& state) {
       struct json_string_s* str = (struct json_string_s*)elem->value->payload;
       state.security_patch_level = str->string;
     } else if (strcmp(key, "partitions") == 0) {
-      struct json_array_s* arr = (struct json_array_s*)elem->value->payload;
+      read_part_list((struct json_array_s*)elem->value->payload,
+                     state.partitions);
+    }
+  }
 
-      for (struct json_array_element_s* part_elem = arr->start; part_elem;
-           part_elem = part_elem->next) {
-        struct json_object_s* part_obj =
-            (struct json_object_s*)part_elem->value->payload;
+  free(root);
+  state.partitions_loaded = true;
+  return true;
+}
 
-        Part info;
-        for (struct json_object_element_s* field = part_obj->start; field;
-             field = field->next) {
-          const char* field_key = field->name->string;
-
-          if (strcmp(field_key, "name") == 0) {
-            struct json_string_s* str =
-                (struct json_string_s*)field->value->payload;
-            info.name = str->string;
-          } else if (strcmp(field_key, "size_bytes") == 0) {
-            struct json_number_s* num =
-                (struct json_number_s*)field->value->payload;
-            info.size_bytes = strtoull(num->number, nullptr, 10);
-          } else if (strcmp(field_key, "size_readable") == 0) {
-            struct json_string_s* str =
-                (struct json_string_s*)field->value->payload;
-            info.size_readable = str->string;
-          } else if (strcmp(field_key, "operations_count") == 0) {
-            struct json_number_s* num =
-                (struct json_number_s*)field->value->payload;
-            info.operations_count = strtoull(num->number, nullptr, 10);
-          } else if (strcmp(field_key, "hash") == 0) {
-            struct json_string_s* str =
-                (struct json_string_s*)field->value->payload;
-            info.hash = str->string;
-          }
-        }
+bool read_stats(const char* json_str, EngineStats& stats) {
+  struct json_value_s* root = json_parse(json_str, strlen(json_str));
+  if (!root) return false;
 
-        state.partitions.emplace_back(std::move(info));
-      }
+  struct json_object_s* root_obj = (struct json_object_s*)root->payload;
+
+  for (struct json_object_element_s* elem = root_obj->start; elem;
+       elem = elem->next) {
+    if (elem->value->type != json_type_number) continue;
+
+    const char* key = elem->name->string;
+    const char* num = ((struct json_number_s*)elem->value->payload)->number;
+
+    if (strcmp(key, "prefetch_hits") == 0) {
+      stats.prefetch_hits = strtoull(num, nullptr, 10);
+    } else if (strcmp(key, "prefetch_stalls") == 0) {
+      stats.prefetch_stalls = strtoull(num, nullptr, 10);
+    } else if (strcmp(key, "remote_rtt_ms") == 0) {
+      stats.remote_rtt_ms = strtod(num, nullptr);
+    } else if (strcmp(key, "remote_list_ms_last") == 0) {
+      stats.remote_list_ms_last = strtod(num, nullptr);
+    } else if (strcmp(key, "remote_open_requests_last") == 0) {
+      stats.remote_open_requests_last = strtoull(num, nullptr, 10);
+    } else if (strcmp(key, "memory_limit_bytes") == 0) {
+      stats.memory_limit_bytes = strtoull(num, nullptr, 10);
+    } else if (strcmp(key, "memory_in_use_bytes") == 0) {
+      stats.memory_in_use_bytes = strtoull(num, nullptr, 10);
+    } else if (strcmp(key, "memory_peak_bytes") == 0) {
+      stats.memory_peak_bytes = strtoull(num, nullptr, 10);
+    } else if (strcmp(key, "memory_waiting_jobs") == 0) {
+      stats.memory_waiting_jobs = strtoull(num, nullptr, 10);
+    } else if (strcmp(key, "pool_allocations") == 0) {
+      stats.pool_allocations = strtoull(num, nullptr, 10);
+    } else if (strcmp(key, "pool_reuses") == 0) {
+      stats.pool_reuses = strtoull(num, nullptr, 10);
+    } else if (strcmp(key, "cache_hits") == 0) {
+      stats.cache_hits = strtoull(num, nullptr, 10);
+    } else if (strcmp(key, "cache_bytes_saved") == 0) {
+      stats.cache_bytes_saved = strtoull(num, nullptr, 10);
+    } else if (strcmp(key, "disk_jobs_active") == 0) {
+      stats.disk_jobs_active = strtoull(num, nullptr, 10);
+    } else if (strcmp(key, "disk_jobs_waiting") == 0) {
+      stats.disk_jobs_waiting = strtoull(num, nullptr, 10);
+    } else if (strcmp(key, "network_jobs_waiting") == 0) {
+      stats.network_jobs_waiting = strtoull(num, nullptr, 10);
     }
   }
 
   free(root);
-  state.partitions_loaded = true;
   return true;
 }
 
-int32_t progress_callback(void* user_data, const char* partition_name,
-                          uint64_t current_op, uint64_t total_ops,
-                          double percentage, int32_t status,
-                          const char* warning_msg) {
-  Part* info = static_cast<Part*>(user_data);
-
-  if (info->cancel_flag.load() || G.shutdown_requested.load()) {
-    return 0;
-  }
-
-  info->progress.store(static_cast<float>(percentage));
-
-  switch (status) {
-    case STATUS_STARTED:
-      info->set_status("Starting...");
-      break;
-    case STATUS_IN_PROGRESS:
-      info->set_status("Extracting...");
-      break;
-    case STATUS_COMPLETED:
-      info->set_status("Completed");
-      break;
-    case STATUS_WARNING:
-      if (warning_msg) {
-        info->set_status(std::string("Warning: ") + warning_msg);
-      }
-      break;
+void poll_stats() {
+  double now = ImGui::GetTime();
+  if (G.last_stats_poll >= 0.0 && now - G.last_stats_poll < 0.5) return;
+  G.last_stats_poll = now;
+
+  char* json_result = payload_get_stats();
+  if (json_result) {
+    read_stats(json_result, G.engine);
+    payload_free_string(json_result);
+  }
+}
+
+// rebuilds the engine runtime, so it is refused while anything is running
+void apply_tuning() {
+  const uint64_t mb = 1024 * 1024;
+  PayloadConfig config = {};
+  config.worker_threads = G.worker_threads;
+  config.blocking_threads = G.blocking_threads;
+  config.decode_threads = B.decode_threads;
+  config.disk_jobs = B.disk_jobs;
+  config.network_jobs = B.network_jobs;
+  config.http_requests_per_job = G.http_requests;
+  config.prefetch_bytes = G.prefetch_mb * mb;
+  config.sequential_read_bytes = G.sequential_read_mb * mb;
+  config.buffer_pool_bytes = G.buffer_pool_mb * mb;
+  config.memory_budget_bytes = G.memory_budget_mb * mb;
+  if (payload_init_ex(&config) != 0) {
+    G.set_error(payload_get_last_error());
   }
+}
 
-  return 1;
+void apply_cache() {
+  uint64_t cap = static_cast<uint64_t>(G.cache_size_gb) * 1024 * 1024 * 1024;
+  if (payload_configure_output_cache(G.enable_cache ? G.cache_dir : nullptr,
+                                     cap) != 0) {
+    const char* err = payload_get_last_error();
+    G.set_error(err ? err : "Failed to configure output cache");
+    G.enable_cache = false;
+  }
 }
 
-void verify_part(Part* info, const std::string& output_path) {
-  info->verifying.store(true);
-  info->verify_progress.store(0.0f);
-  info->set_verify_status("Verifying...");
+std::string fmt_mb(uint64_t bytes) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.1f MB", bytes / (1024.0 * 1024.0));
+  return buf;
+}
 
-  FILE* file = fopen(output_path.c_str(), "rb");
-  if (!file) {
-    info->set_verify_status("Error: Cannot open file");
+void start_extraction(Part* info) {
+  std::string source =
+      G.input_mode == Status::Source::SRC_FILE ? G.file_path : G.url_input;
+  std::string output = G.output_dir;
+  std::string ua = G.user_agent;
+  auto mode = G.input_mode;
+  bool verify = G.enable_verification;
+
+  info->extracting.store(true);
+  info->progress.store(0);
+  info->cancel_flag.store(false);
+  info->set_status("Starting...");
+  info->verification_passed.store(false);
+  info->set_verify_status("");
+
+  G.extraction_threads.emplace_back([=] {
+    LiveThread live;
+    dump_part(info, source, mode, output, ua, verify, nullptr);
+  });
+}
+
+void start_one_pass(std::vector<Part*> parts) {
+  std::string source =
+      G.input_mode == Status::Source::SRC_FILE ? G.file_path : G.url_input;
+  std::string output = G.output_dir;
+  std::string ua = G.user_agent;
+  auto mode = G.input_mode;
+  bool verify = G.enable_verification;
+
+  for (Part* info : parts) {
+    info->extracting.store(true);
+    info->progress.store(0);
+    info->cancel_flag.store(false);
+    info->set_status("Queued");
     info->verification_passed.store(false);
-    info->verifying.store(false);
-    return;
+    info->set_verify_status("");
   }
 
-  fseek(file, 0, SEEK_END);
-  uint64_t file_size = ftell(file);
-  fseek(file, 0, SEEK_SET);
+  G.extraction_threads.emplace_back([=] {
+    LiveThread live;
+    dump_one_pass(parts, source, mode, output, ua, verify, nullptr);
+  });
+}
 
-  SHA256_CTX ctx;
-  sha256_init(&ctx);
+// output directory per payload, named after the file so OTAs do not collide
+std::string batch_output_dir(const std::string& root,
+                             const std::string& source) {
+  std::string path = source.substr(0, source.find_first_of("?#"));
+  size_t slash = path.find_last_of("/\\");
+  std::string base = slash == std::string::npos ? path : path.substr(slash + 1);
+  size_t dot = base.find_last_of('.');
+  if (dot != std::string::npos && dot > 0) base = base.substr(0, dot);
+  if (base.empty()) base = "payload";
+
+  std::string dir = root + "/" + base;
+  std::lock_guard<std::mutex> lock(B.jobs_mutex);
+  for (int n = 2;; n++) {
+    bool taken = false;
+    for (const auto& job : B.jobs) {
+      if (job->output_dir == dir) taken = true;
+    }
+    if (!taken) return dir;
+    dir = root + "/" + base + "_" + std::to_string(n);
+  }
+}
 
-  const size_t BUFFER_SIZE = 1024 * 1024;
-  uint8_t* buffer = new uint8_t[BUFFER_SIZE];
-  uint64_t bytes_read = 0;
+void batch_list(std::string ua) {
+  LiveThread live;
+  while (!B.cancel.load() && !shutdown_requested.load()) {
+    BatchJob* job = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(B.jobs_mutex);
+      for (auto& j : B.jobs) {
+        if (j->state.load() == BatchJob::State::QUEUED) {
+          job = j.get();
+          break;
+        }
+      }
+    }
+    if (!job) {
+      if (!B.watching.load()) break;
+      std::unique_lock<std::mutex> lock(B.jobs_mutex);
+      B.jobs_cv.wait_for(lock, std::chrono::seconds(1));
+      continue;
+    }
 
-  while (!feof(file) && !info->cancel_flag.load() &&
-         !G.shutdown_requested.load()) {
-    size_t n = fread(buffer, 1, BUFFER_SIZE, file);
-    if (n > 0) {
-      sha256_update(&ctx, buffer, n);
-      bytes_read += n;
-      float progress = (bytes_read * 100.0f) / file_size;
-      info->verify_progress.store(progress);
+    job->started_at = std::chrono::steady_clock::now();
+    job->state.store(BatchJob::State::LISTING);
+    job->set_message("Listing...");
+
+    char* json_result =
+        job->mode == Status::Source::SRC_FILE
+            ? payload_list_local_partitions(job->source.c_str())
+            : payload_list_remote_partitions(job->source.c_str(), ua.c_str(),
+                                             nullptr);
+    if (!json_result) {
+      const char* err = payload_get_last_error();
+      job->set_message(err ? std::string("Error: ") + err
+                           : "Failed to load partitions");
+      job->state.store(BatchJob::State::FAILED);
+      continue;
     }
-    if (n < BUFFER_SIZE) break;
-  }
 
-  delete[] buffer;
-  fclose(file);
+    std::deque<Part> listed;
+    bool ok = read_partitions(json_result, listed);
+    payload_free_string(json_result);
+    if (!ok) {
+      job->set_message("Failed to parse partition information");
+      job->state.store(BatchJob::State::FAILED);
+      continue;
+    }
 
-  if (info->cancel_flag.load() || G.shutdown_requested.load()) {
-    info->set_verify_status("Verification cancelled");
-    info->verification_passed.store(false);
-    info->verifying.store(false);
-    return;
+    std::vector<std::string> names = parse_rule(job->rule);
+    {
+      std::lock_guard<std::mutex> lock(job->mutex);
+      for (auto& part : listed) {
+        if (rule_matches(names, part.name)) {
+          part.set_status("Queued");
+          job->parts.emplace_back(std::move(part));
+        }
+      }
+    }
+
+    if (job->parts.empty()) {
+      job->set_message("No matching partitions");
+      job->state.store(BatchJob::State::FAILED);
+      continue;
+    }
+
+    job->part_seconds.assign(job->parts.size(), 0.0);
+    job->remaining.store(static_cast<int>(job->parts.size()));
+    job->failed.store(0);
+    job->set_message("Extracting...");
+    job->state.store(BatchJob::State::RUNNING);
+
+    {
+      std::lock_guard<std::mutex> lock(B.tasks_mutex);
+      for (size_t i = 0; i < job->parts.size(); i++) {
+        B.tasks.emplace_back(job, i);
+      }
+    }
+    B.tasks_cv.notify_all();
   }
 
-  uint8_t computed_hash[SHA256_DIGEST_SIZE];
-  sha256_final(&ctx, computed_hash);
+  {
+    std::lock_guard<std::mutex> lock(B.tasks_mutex);
+    B.listing_done = true;
+  }
+  B.tasks_cv.notify_all();
+}
 
-  char computed_hex[65];
-  sha256_to_hex(computed_hash, computed_hex);
+// summary.json next to the extracted images, one per payload
+void write_summary(BatchJob* job, const char* result) {
+  using seconds = std::chrono::duration<double>;
+  auto now = std::chrono::steady_clock::now();
+  double waited = seconds(job->started_at - job->queued_at).count();
+  double total = seconds(now - job->started_at).count();
+
+  std::string path = job->output_dir + "/summary.json";
+  FILE* f = fopen(path.c_str(), "w");
+  if (!f) return;
+
+  fprintf(f, "{\n");
+  fprintf(f, "  \"source\": \"%s\",\n", json_escape(job->source).c_str());
+  fprintf(f, "  \"rule\": \"%s\",\n", json_escape(job->rule).c_str());
+  fprintf(f, "  \"result\": \"%s\",\n", result);
+  fprintf(f, "  \"queued_seconds\": %.3f,\n", waited);
+  fprintf(f, "  \"total_seconds\": %.3f,\n", total);
+  fprintf(f, "  \"partitions\": [\n");
+
+  std::lock_guard<std::mutex> lock(job->mutex);
+  for (size_t i = 0; i < job->parts.size(); i++) {
+    const Part& part = job->parts[i];
+    fprintf(f,
+            "    {\"name\": \"%s\", \"size_bytes\": %llu, "
+            "\"status\": \"%s\", \"verify\": \"%s\", \"seconds\": %.3f}%s\n",
+            json_escape(part.name).c_str(),
+            (unsigned long long)part.size_bytes,
+            json_escape(part.get_status()).c_str(),
+            json_escape(part.get_verify_status()).c_str(),
+            job->part_seconds[i], i + 1 < job->parts.size() ? "," : "");
+  }
 
-  if (info->hash.empty()) {
-    info->set_verify_status("No hash to verify");
-    info->verification_passed.store(false);
-  } else if (_stricmp(computed_hex, info->hash.c_str()) == 0) {
-    info->set_verify_status("Verified");
-    info->verification_passed.store(true);
+  fprintf(f, "  ]\n}\n");
+  fclose(f);
+}
+
+void finish_job(BatchJob* job) {
+  int total = static_cast<int>(job->parts.size());
+  int failed = job->failed.load();
+  char msg[64];
+  snprintf(msg, sizeof(msg), "%d/%d partitions", total - failed, total);
+  job->set_message(msg);
+
+  if (B.cancel.load() || shutdown_requested.load()) {
+    write_summary(job, "cancelled");
+    job->state.store(BatchJob::State::CANCELLED);
+  } else if (failed > 0) {
+    write_summary(job, "failed");
+    job->state.store(BatchJob::State::FAILED);
   } else {
-    info->set_verify_status("Verification FAILED!");
-    info->verification_passed.store(false);
+    write_summary(job, "completed");
+    job->state.store(BatchJob::State::DONE);
   }
+}
 
-  info->verify_progress.store(100.0f);
-  info->verifying.store(false);
+void batch_work(std::string ua, bool verify) {
+  LiveThread live;
+  for (;;) {
+    std::pair<BatchJob*, size_t> task;
+    {
+      std::unique_lock<std::mutex> lock(B.tasks_mutex);
+      B.tasks_cv.wait(lock, [] { return !B.tasks.empty() || B.listing_done; });
+      if (B.tasks.empty()) break;
+      task = B.tasks.front();
+      B.tasks.pop_front();
+    }
+
+    BatchJob* job = task.first;
+    Part* part = &job->parts[task.second];
+
+    auto finished = [job, part] {
+      if (part->get_status().rfind("Completed", 0) != 0 ||
+          part->get_verify_status().find("FAILED") != std::string::npos) {
+        job->failed++;
+      }
+      if (--job->remaining == 0) finish_job(job);
+    };
+
+    if (B.cancel.load() || shutdown_requested.load()) {
+      part->set_status("Cancelled");
+      finished();
+      continue;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    part->extracting.store(true);
+    part->progress.store(0);
+    part->cancel_flag.store(false);
+    part->set_status("Starting...");
+
+    // timed until the image is extracted and verified, the worker itself
+    // moves on as soon as the image is handed to the verifier
+    size_t index = task.second;
+    dump_part(part, job->source, job->mode, job->output_dir, ua, verify,
+              [job, index, start, finished] {
+                std::chrono::duration<double> took =
+                    std::chrono::steady_clock::now() - start;
+                {
+                  std::lock_guard<std::mutex> lock(job->mutex);
+                  job->part_seconds[index] = took.count();
+                }
+                finished();
+              });
+  }
+
+  if (--B.active_workers == 0) B.running.store(false);
 }
 
-void dump_part(Part* info, const std::string& source_path, Status::Source mode,
-               Status::SRC_TYPE file_type, const std::string& output_dir,
-               const std::string& user_agent, bool verify) {
-  char output_path[512];
-  snprintf(output_path, sizeof(output_path), "%s/%s.img", output_dir.c_str(),
-           info->name.c_str());
+void queue_batch_job(const std::string& source, const std::string& rule,
+                     const std::string& output_root) {
+  Status::Source mode = source_mode(source);
+  std::string out = batch_output_dir(output_root, source);
+  {
+    std::lock_guard<std::mutex> lock(B.jobs_mutex);
+    B.jobs.emplace_back(std::make_unique<BatchJob>(source, mode, rule, out));
+  }
+  B.jobs_cv.notify_all();
+}
 
-  int32_t result = -1;
+// a writer that still has the file open for writing denies this open
+bool write_finished(const std::string& path) {
+  HANDLE h = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                         OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (h == INVALID_HANDLE_VALUE) return false;
+  CloseHandle(h);
+  return true;
+}
 
-  if (mode == Status::Source::SRC_FILE) {
-    if (file_type == Status::SRC_TYPE::TYPE_ZIP) {
-      result =
-          payload_extract_partition_zip(source_path.c_str(), info->name.c_str(),
-                                        output_path, progress_callback, info);
-    } else {
-      result =
-          payload_extract_partition(source_path.c_str(), info->name.c_str(),
-                                    output_path, progress_callback, info);
+// files count as arrived once size and write time have been unchanged for
+// settle_seconds and nobody holds them open for writing. a file renamed into
+// place is complete already and only waits out the settle period.
+void scan_folder(bool initial) {
+  std::string pattern = W.folder + "\\*";
+  WIN32_FIND_DATAA fd;
+  HANDLE h = FindFirstFileA(pattern.c_str(), &fd);
+  if (h == INVALID_HANDLE_VALUE) return;
+
+  auto now = std::chrono::steady_clock::now();
+  auto settle = std::chrono::seconds(std::max(0, W.settle_seconds));
+
+  do {
+    if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+    if (G.detect_file_type(fd.cFileName) == Status::SRC_TYPE::TYPE_NONE)
+      continue;
+
+    uint64_t size = (static_cast<uint64_t>(fd.nFileSizeHigh) << 32) |
+                    fd.nFileSizeLow;
+    uint64_t write_time =
+        (static_cast<uint64_t>(fd.ftLastWriteTime.dwHighDateTime) << 32) |
+        fd.ftLastWriteTime.dwLowDateTime;
+
+    auto it = W.seen.find(fd.cFileName);
+    if (it == W.seen.end()) {
+      // files already there when watching starts are not new arrivals
+      W.seen[fd.cFileName] = {size, write_time, now, initial};
+      continue;
     }
-  } else {
-    if (file_type == Status::SRC_TYPE::TYPE_ZIP) {
-      result = payload_extract_partition_remote_zip(
-          source_path.c_str(), info->name.c_str(), output_path,
-          user_agent.c_str(), nullptr, progress_callback, info);
-    } else {
-      result = payload_extract_partition_remote_bin(
-          source_path.c_str(), info->name.c_str(), output_path,
-          user_agent.c_str(), nullptr, progress_callback, info);
+
+    Watch::Seen& seen = it->second;
+    if (seen.size != size || seen.write_time != write_time) {
+      seen.size = size;
+      seen.write_time = write_time;
+      seen.stable_since = now;
+      seen.queued = false;
+      continue;
     }
-  }
+    if (seen.queued || now - seen.stable_since < settle) continue;
 
-  if (result != 0 && !info->cancel_flag.load()) {
-    const char* err = payload_get_last_error();
-    info->set_status(err ? std::string("Error: ") + err : "Extraction failed");
-  } else if (info->cancel_flag.load()) {
-    info->set_status("Cancelled");
-  } else {
-    info->set_status("Completed");
+    std::string path = W.folder + "\\" + fd.cFileName;
+    if (!write_finished(path)) continue;
+
+    seen.queued = true;
+    W.arrivals++;
+    queue_batch_job(path, W.rule, W.output_root);
+  } while (FindNextFileA(h, &fd));
 
-    if (verify && !info->hash.empty()) {
-      verify_part(info, output_path);
-    } else if (verify && info->hash.empty()) {
-      info->set_verify_status("No hash available");
+  FindClose(h);
+}
+
+void watch_loop() {
+  LiveThread live;
+  while (B.watching.load() && !shutdown_requested.load()) {
+    scan_folder(false);
+    for (int i = 0; i < 10 && B.watching.load(); i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
   }
+}
 
-  info->extracting.store(false);
+void join_batch() {
+  if (B.lister.joinable()) B.lister.join();
+  for (auto& t : B.workers) {
+    if (t.joinable()) t.join();
+  }
+  B.workers.clear();
 }
 
-void start_extraction(Part* info) {
-  std::string source =
-      G.input_mode == Status::Source::SRC_FILE ? G.file_path : G.url_input;
-  std::string output = G.output_dir;
+void start_batch() {
+  join_batch();
+
+  B.cancel.store(false);
+  {
+    std::lock_guard<std::mutex> lock(B.tasks_mutex);
+    B.tasks.clear();
+    B.listing_done = false;
+  }
+
   std::string ua = G.user_agent;
-  auto mode = G.input_mode;
-  auto ftype = G.detected_file_type;
   bool verify = G.enable_verification;
+  int workers = std::max(1, B.parallel_jobs);
 
-  info->extracting.store(true);
-  info->progress.store(0);
-  info->cancel_flag.store(false);
-  info->set_status("Starting...");
-  info->verification_passed.store(false);
-  info->set_verify_status("");
+  B.running.store(true);
+  B.active_workers.store(workers);
+  B.lister = std::thread(batch_list, ua);
+  for (int i = 0; i < workers; i++) {
+    B.workers.emplace_back(batch_work, ua, verify);
+  }
+}
+
+void start_watch() {
+  W.folder = W.dir;
+  W.rule = B.rule_input;
+  W.output_root = G.output_dir;
+  W.seen.clear();
+  W.arrivals.store(0);
+  scan_folder(true);
+
+  B.watching.store(true);
+  start_batch();
+  W.thread = std::thread(watch_loop);
+}
+
+void stop_watch() {
+  B.watching.store(false);
+  B.jobs_cv.notify_all();
+  if (W.thread.joinable()) W.thread.join();
+}
+
+void cancel_batch() {
+  B.cancel.store(true);
+  {
+    std::lock_guard<std::mutex> lock(B.jobs_mutex);
+    for (auto& job : B.jobs) {
+      std::lock_guard<std::mutex> job_lock(job->mutex);
+      for (auto& part : job->parts) {
+        if (part.extracting.load() || part.verifying.load()) part.cancel();
+      }
+    }
+  }
+  B.tasks_cv.notify_all();
+}
+
+bool read_listing(const char* json_str, std::string& filesystem,
+                  std::string& path, std::vector<Browser::Entry>& entries) {
+  struct json_value_s* root = json_parse(json_str, strlen(json_str));
+  if (!root) return false;
+
+  struct json_object_s* root_obj = (struct json_object_s*)root->payload;
+  entries.clear();
+
+  for (struct json_object_element_s* elem = root_obj->start; elem;
+       elem = elem->next) {
+    const char* key = elem->name->string;
+
+    if (strcmp(key, "filesystem") == 0) {
+      filesystem = ((struct json_string_s*)elem->value->payload)->string;
+    } else if (strcmp(key, "path") == 0) {
+      path = ((struct json_string_s*)elem->value->payload)->string;
+    } else if (strcmp(key, "entries") == 0) {
+      struct json_array_s* arr = (struct json_array_s*)elem->value->payload;
+      for (struct json_array_element_s* item = arr->start; item;
+           item = item->next) {
+        struct json_object_s* obj = (struct json_object_s*)item->value->payload;
+        Browser::Entry entry;
+        entry.size = 0;
+        for (struct json_object_element_s* field = obj->start; field;
+             field = field->next) {
+          const char* name = field->name->string;
+          void* value = field->value->payload;
+          if (strcmp(name, "name") == 0) {
+            entry.name = ((struct json_string_s*)value)->string;
+          } else if (strcmp(name, "type") == 0) {
+            entry.type = ((struct json_string_s*)value)->string;
+          } else if (strcmp(name, "size") == 0) {
+            entry.size =
+                strtoull(((struct json_number_s*)value)->number, nullptr, 10);
+          } else if (strcmp(name, "target") == 0) {
+            entry.target = ((struct json_string_s*)value)->string;
+          }
+        }
+        entries.push_back(std::move(entry));
+      }
+    }
+  }
+
+  free(root);
+  return true;
+}
+
+// runs on F.worker; F.fs is only touched from there
+void browse_list(const std::string& path) {
+  char* json_result = payload_fs_list(F.fs, path.c_str());
+  if (!json_result) {
+    const char* err = payload_get_last_error();
+    F.set_message(err ? err : "Failed to list directory");
+    return;
+  }
 
-  G.extraction_threads.emplace_back(dump_part, info, source, mode, ftype,
-                                    output, ua, verify);
+  std::string filesystem, listed;
+  std::vector<Browser::Entry> entries;
+  bool ok = read_listing(json_result, filesystem, listed, entries);
+  payload_free_string(json_result);
+  if (!ok) {
+    F.set_message("Failed to parse directory listing");
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(F.mutex);
+  F.filesystem = filesystem;
+  F.path = listed;
+  F.entries = std::move(entries);
+  F.message = std::to_string(F.entries.size()) + " entries";
+}
+
+void browse_open(std::string name, std::string source, Status::Source mode,
+                 std::string ua) {
+  if (F.fs) {
+    payload_fs_close(F.fs);
+    F.fs = nullptr;
+  }
+  {
+    std::lock_guard<std::mutex> lock(F.mutex);
+    F.partition = name;
+    F.filesystem.clear();
+    F.path.clear();
+    F.entries.clear();
+    F.message = "Opening " + name + "...";
+  }
+
+  PayloadPartition* part =
+      mode == Status::Source::SRC_FILE
+          ? payload_partition_open_local(source.c_str(), name.c_str(), 0)
+          : payload_partition_open_remote(source.c_str(), name.c_str(),
+                                          ua.c_str(), nullptr, 0);
+  if (part) {
+    // the filesystem keeps the partition's reads alive on its own
+    F.fs = payload_fs_open(part);
+    payload_partition_close(part);
+  }
+  if (!F.fs) {
+    const char* err = payload_get_last_error();
+    F.set_message(err ? err : "Failed to open partition");
+    return;
+  }
+  browse_list("/");
+}
+
+void browse_extract(std::string path, std::string output) {
+  F.set_message("Extracting " + path + "...");
+  if (payload_fs_extract(F.fs, path.c_str(), output.c_str()) != 0) {
+    const char* err = payload_get_last_error();
+    F.set_message(err ? err : "Failed to extract file");
+    return;
+  }
+  F.set_message("Saved " + output);
+}
+
+// one request at a time, the UI disables everything while F.busy is set
+void browse_start(std::function<void()> task) {
+  if (F.busy.exchange(true)) return;
+  if (F.worker.joinable()) F.worker.join();
+  F.worker = std::thread([task] {
+    LiveThread live;
+    task();
+    F.busy.store(false);
+  });
+}
+
+std::string json_str(struct json_value_s* value) {
+  if (value->type != json_type_string) return "";
+  return ((struct json_string_s*)value->payload)->string;
+}
+
+uint64_t json_u64(struct json_value_s* value) {
+  if (value->type != json_type_number) return 0;
+  return strtoull(((struct json_number_s*)value->payload)->number, nullptr,
+                  10);
+}
+
+// names of the "added" or "removed" objects of a diff
+void read_names(struct json_value_s* value, std::vector<std::string>& names) {
+  struct json_array_s* arr = (struct json_array_s*)value->payload;
+  for (struct json_array_element_s* item = arr->start; item;
+       item = item->next) {
+    struct json_object_s* obj = (struct json_object_s*)item->value->payload;
+    for (struct json_object_element_s* f = obj->start; f; f = f->next) {
+      if (strcmp(f->name->string, "name") == 0) {
+        names.push_back(json_str(f->value));
+      }
+    }
+  }
+}
+
+bool read_diff(const char* json_str_in, Compare& out) {
+  struct json_value_s* root = json_parse(json_str_in, strlen(json_str_in));
+  if (!root) return false;
+
+  struct json_object_s* root_obj = (struct json_object_s*)root->payload;
+  std::lock_guard<std::mutex> lock(out.mutex);
+  out.changed.clear();
+  out.added.clear();
+  out.removed.clear();
+  out.unchanged = 0;
+
+  for (struct json_object_element_s* elem = root_obj->start; elem;
+       elem = elem->next) {
+    const char* key = elem->name->string;
+
+    if (strcmp(key, "changed") == 0) {
+      struct json_array_s* arr = (struct json_array_s*)elem->value->payload;
+      for (struct json_array_element_s* item = arr->start; item;
+           item = item->next) {
+        struct json_object_s* obj = (struct json_object_s*)item->value->payload;
+        Compare::Changed c = {"", 0, 0, "", 0.0};
+        for (struct json_object_element_s* f = obj->start; f; f = f->next) {
+          const char* name = f->name->string;
+          if (strcmp(name, "name") == 0) {
+            c.name = json_str(f->value);
+          } else if (strcmp(name, "old_size_bytes") == 0) {
+            c.old_size = json_u64(f->value);
+          } else if (strcmp(name, "new_size_bytes") == 0) {
+            c.new_size = json_u64(f->value);
+          } else if (strcmp(name, "changed_readable") == 0) {
+            c.changed = json_str(f->value);
+          } else if (strcmp(name, "changed_percent") == 0 &&
+                     f->value->type == json_type_number) {
+            c.percent = strtod(
+                ((struct json_number_s*)f->value->payload)->number, nullptr);
+          }
+        }
+        out.changed.push_back(std::move(c));
+      }
+    } else if (strcmp(key, "added") == 0) {
+      read_names(elem->value, out.added);
+    } else if (strcmp(key, "removed") == 0) {
+      read_names(elem->value, out.removed);
+    } else if (strcmp(key, "unchanged") == 0) {
+      out.unchanged = ((struct json_array_s*)elem->value->payload)->length;
+    } else if (strcmp(key, "changed_readable") == 0) {
+      out.total = json_str(elem->value);
+    }
+  }
+
+  free(root);
+  return true;
+}
+
+void compare_run(std::string old_source, std::string new_source,
+                 std::string ua) {
+  LiveThread live;
+  auto started = std::chrono::steady_clock::now();
+
+  char* json_result = payload_diff_payloads(
+      old_source.c_str(), new_source.c_str(), ua.c_str(), nullptr);
+  if (!json_result) {
+    const char* err = payload_get_last_error();
+    std::lock_guard<std::mutex> lock(C.mutex);
+    C.message = err ? err : "Failed to compare payloads";
+    C.busy.store(false);
+    return;
+  }
+
+  bool ok = read_diff(json_result, C);
+  payload_free_string(json_result);
+
+  std::chrono::duration<double> took =
+      std::chrono::steady_clock::now() - started;
+  char msg[128];
+  snprintf(msg, sizeof(msg), "Compared in %.1f s", took.count());
+
+  std::lock_guard<std::mutex> lock(C.mutex);
+  C.source = new_source;
+  C.message = ok ? msg : "Failed to parse comparison";
+  C.busy.store(false);
+}
+
+// quiet time after the last keystroke before a typed source is fetched
+const double WARM_DEBOUNCE_S = 0.6;
+
+void warm_run(std::string source, bool remote, PayloadCancelToken* token) {
+  LiveThread live;
+  char* json = payload_prefetch_source(
+      source.c_str(), remote ? G.user_agent : nullptr, nullptr, token);
+
+  std::lock_guard<std::mutex> lock(P.mutex);
+  if (source == P.source) {
+    P.json = json ? json : "";
+    P.done = true;
+  }
+  if (json) payload_free_string(json);
+  P.ready.notify_all();
+}
+
+bool warm_ready_source(const std::string& source, bool remote) {
+  if (remote) {
+    const char* s = source.c_str();
+    return source.size() > 10 && (_strnicmp(s, "http://", 7) == 0 ||
+                                  _strnicmp(s, "https://", 8) == 0);
+  }
+  DWORD attr = GetFileAttributesA(source.c_str());
+  return attr != INVALID_FILE_ATTRIBUTES && !(attr & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+// called every frame: follow the source inputs, drop a prefetch as soon as
+// they change and start a new one once they have been still for a moment
+void warm_poll() {
+  bool remote = G.input_mode == Status::Source::SRC_URL;
+  std::string wanted = remote ? G.url_input : G.file_path;
+  double now = ImGui::GetTime();
+
+  if (wanted != P.wanted) {
+    P.wanted = wanted;
+    P.changed_at = now;
+    std::lock_guard<std::mutex> lock(P.mutex);
+    if (P.token && P.source != wanted) {
+      payload_cancel_token_cancel(P.token);
+      P.source.clear();
+      P.json.clear();
+      P.ready.notify_all();
+    }
+    return;
+  }
+  if (wanted == P.source || now - P.changed_at < WARM_DEBOUNCE_S) return;
+  if (!warm_ready_source(wanted, remote)) return;
+
+  // the previous prefetch was cancelled when the input changed
+  if (P.worker.joinable()) P.worker.join();
+  if (P.token) payload_cancel_token_free(P.token);
+  P.token = payload_cancel_token_new();
+  {
+    std::lock_guard<std::mutex> lock(P.mutex);
+    P.source = wanted;
+    P.json.clear();
+    P.done = false;
+  }
+  P.worker = std::thread(warm_run, wanted, remote, P.token);
+}
+
+// listing of `source` from the prefetch, waiting for one still running;
+// empty when there is none or it failed
+std::string warm_take(const std::string& source) {
+  std::unique_lock<std::mutex> lock(P.mutex);
+  P.ready.wait(lock, [&] { return P.source != source || P.done; });
+  return P.source == source ? P.json : std::string();
 }
 
 void load_it() {
+  LiveThread live;
   G.loading_partitions.store(true);
 
+  std::string warmed = warm_take(
+      G.input_mode == Status::Source::SRC_FILE ? G.file_path : G.url_input);
+  if (!warmed.empty()) {
+    if (!read_json(warmed.c_str(), G)) {
+      G.set_error("Failed to parse partition information");
+    }
+    G.loading_partitions.store(false);
+    return;
+  }
+
   char* json_result = nullptr;
 
   if (G.input_mode == Status::Source::SRC_FILE) {
-    if (G.detected_file_type == Status::SRC_TYPE::TYPE_ZIP) {
-      json_result = payload_list_partitions_zip(G.file_path);
-    } else {
-      json_result = payload_list_partitions(G.file_path);
-    }
+    json_result = payload_list_local_partitions(G.file_path);
   } else {
-    if (G.detected_file_type == Status::SRC_TYPE::TYPE_ZIP) {
-      json_result = payload_list_partitions_remote_zip(
-          G.url_input, G.user_agent, nullptr, nullptr);
-    } else {
-      json_result = payload_list_partitions_remote_bin(
-          G.url_input, G.user_agent, nullptr, nullptr);
-    }
+    json_result =
+        payload_list_remote_partitions(G.url_input, G.user_agent, nullptr);
   }
 
   if (json_result) {
@@ -516,6 +1316,7 @@ void top_box() {
                     ImGuiWindowFlags_NoScrollbar);
 
   ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(8, 6));
+  warm_poll();
 
   ImGui::Text("Source Type:");
   ImGui::SameLine(120);
@@ -638,31 +1439,143 @@ void top_box() {
 }
 
 char* fetch_jsn() {
-  if (G.input_mode == Status::Source::SRC_FILE) {
-    if (G.detected_file_type == Status::SRC_TYPE::TYPE_ZIP)
-      return payload_list_partitions_zip(G.file_path);
-    return payload_list_partitions(G.file_path);
-  } else {
-    if (G.detected_file_type == Status::SRC_TYPE::TYPE_ZIP)
-      return payload_list_partitions_remote_zip(G.url_input, G.user_agent,
-                                                nullptr, nullptr);
-    return payload_list_partitions_remote_bin(G.url_input, G.user_agent,
-                                              nullptr, nullptr);
-  }
+  if (G.input_mode == Status::Source::SRC_FILE)
+    return payload_list_local_partitions(G.file_path);
+  return payload_list_remote_partitions(G.url_input, G.user_agent, nullptr);
+}
+
+void apply_rate_limits() {
+  float* limits[] = {&G.net_limit_mbs, &G.disk_limit_mbs,
+                     &G.job_net_limit_mbs, &G.job_disk_limit_mbs};
+  for (float* limit : limits) *limit = std::max(0.0f, *limit);
+
+  auto bps = [](float mbs) { return (uint64_t)(mbs * 1024.0 * 1024.0); };
+  payload_set_rate_limits(bps(G.net_limit_mbs), bps(G.disk_limit_mbs),
+                          bps(G.job_net_limit_mbs),
+                          bps(G.job_disk_limit_mbs));
 }
 
 void right_box() {
   ImGui::BeginChild("RightPanel", ImVec2(200, 0), true);
 
-  ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(8, 6));
+  ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(8, 6));
+
+  ImGui::Text("Actions");
+  ImGui::Separator();
+  ImGui::Spacing();
+
+  ImGui::Checkbox("Output Verification", &G.enable_verification);
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip("Verify SHA-256 hash after extraction");
+  }
+  ImGui::Spacing();
+
+  ImGui::Checkbox("Single Pass", &G.one_pass);
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip(
+        "Read the payload once, front to back, for all selected partitions.\n"
+        "Much faster on HDDs, USB sticks, network shares and URLs.\n"
+        "Cancelling one partition stops the whole pass.");
+  }
+  ImGui::Spacing();
+
+  ImGui::Text("Memory Budget (MB):");
+  ImGui::SetNextItemWidth(-1);
+  if (ImGui::InputInt("##memorybudget", &G.memory_budget_mb, 256, 1024)) {
+    if (G.memory_budget_mb < 0) G.memory_budget_mb = 0;
+    payload_set_memory_budget(static_cast<uint64_t>(G.memory_budget_mb) *
+                              1024 * 1024);
+  }
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip(
+        "Limit for buffers of all running extractions (0 = unlimited).\n"
+        "Extractions wait for memory instead of exceeding it.");
+  }
+  ImGui::Spacing();
 
-  ImGui::Text("Actions");
-  ImGui::Separator();
+  if (ImGui::CollapsingHeader("Rate Limits (MB/s)")) {
+    bool changed = false;
+    ImGui::Text("Download, all jobs:");
+    ImGui::SetNextItemWidth(-1);
+    changed |= ImGui::InputFloat("##netlimit", &G.net_limit_mbs, 1.0f,
+                                 10.0f, "%.1f");
+    ImGui::Text("Download, per job:");
+    ImGui::SetNextItemWidth(-1);
+    changed |= ImGui::InputFloat("##jobnetlimit", &G.job_net_limit_mbs, 1.0f,
+                                 10.0f, "%.1f");
+    ImGui::Text("Write, all jobs:");
+    ImGui::SetNextItemWidth(-1);
+    changed |= ImGui::InputFloat("##disklimit", &G.disk_limit_mbs, 10.0f,
+                                 100.0f, "%.1f");
+    ImGui::Text("Write, per job:");
+    ImGui::SetNextItemWidth(-1);
+    changed |= ImGui::InputFloat("##jobdisklimit", &G.job_disk_limit_mbs,
+                                 10.0f, 100.0f, "%.1f");
+    if (changed) apply_rate_limits();
+    if (ImGui::IsItemHovered()) {
+      ImGui::SetTooltip(
+          "0 = unlimited. Running extractions follow changes at once;\n"
+          "concurrent partitions share a limit evenly.");
+    }
+  }
   ImGui::Spacing();
 
-  ImGui::Checkbox("Output Verification", &G.enable_verification);
+  if (ImGui::Checkbox("Reuse Identical Images", &G.enable_cache)) {
+    apply_cache();
+  }
   if (ImGui::IsItemHovered()) {
-    ImGui::SetTooltip("Verify SHA-256 hash after extraction");
+    ImGui::SetTooltip(
+        "Keep extracted images by SHA-256 and clone them when a later\n"
+        "payload ships the same partition, instead of decoding it again.\n"
+        "Cache: %s",
+        G.cache_dir);
+  }
+  if (G.enable_cache) {
+    ImGui::Text("Cache Size (GB):");
+    ImGui::SetNextItemWidth(-1);
+    if (ImGui::InputInt("##cachesize", &G.cache_size_gb, 8, 64)) {
+      if (G.cache_size_gb < 0) G.cache_size_gb = 0;
+      apply_cache();
+    }
+    if (ImGui::IsItemHovered()) {
+      ImGui::SetTooltip("Least recently used images are evicted (0 = no cap)");
+    }
+  }
+  ImGui::Spacing();
+
+  if (ImGui::CollapsingHeader("Performance")) {
+    struct Field {
+      const char* label;
+      const char* id;
+      int* value;
+      const char* tip;
+    };
+    const Field fields[] = {
+        {"Worker Threads:", "##workers", &G.worker_threads,
+         "Async I/O threads (0 = one per core)"},
+        {"Blocking Threads:", "##blocking", &G.blocking_threads,
+         "Upper bound on decoder and writer threads (0 = 512)"},
+        {"HTTP Requests/Partition:", "##httpreq", &G.http_requests,
+         "Parallel ranged requests per remote partition (0 = 16)"},
+        {"Read-Ahead (MB):", "##prefetch", &G.prefetch_mb,
+         "Data fetched ahead per remote partition (0 = 64)"},
+        {"Sequential Read (MB):", "##seqread", &G.sequential_read_mb,
+         "Size of the reads of a single pass (0 = 16)"},
+        {"Buffer Pool (MB):", "##bufpool", &G.buffer_pool_mb,
+         "Idle buffers kept for reuse (0 = 256)"},
+    };
+    for (const Field& f : fields) {
+      ImGui::Text("%s", f.label);
+      ImGui::SetNextItemWidth(-1);
+      if (ImGui::InputInt(f.id, f.value) && *f.value < 0) *f.value = 0;
+      if (ImGui::IsItemHovered()) ImGui::SetTooltip("%s", f.tip);
+    }
+    if (ImGui::Button("Apply", ImVec2(-1, 0))) apply_tuning();
+    if (ImGui::IsItemHovered()) {
+      ImGui::SetTooltip(
+          "Restarts the engine with these settings.\n"
+          "Only possible while nothing is being extracted.");
+    }
   }
   ImGui::Spacing();
   ImGui::Separator();
@@ -671,6 +1584,7 @@ void right_box() {
   bool has_partitions = false;
   bool any_selected = false;
   bool any_extracting = false;
+  bool any_verifying = false;
 
   {
     std::lock_guard<std::mutex> lock(G.partitions_mutex);
@@ -678,6 +1592,7 @@ void right_box() {
     for (auto& part : G.partitions) {
       if (part.selected.load()) any_selected = true;
       if (part.extracting.load()) any_extracting = true;
+      if (part.verifying.load()) any_verifying = true;
     }
   }
 
@@ -706,24 +1621,31 @@ void right_box() {
   if (!any_selected || any_extracting) ImGui::BeginDisabled();
   if (ImGui::Button("Extract Selected##extractselected", ImVec2(-1, 35))) {
     std::lock_guard<std::mutex> lock(G.partitions_mutex);
+    std::vector<Part*> selected;
     for (auto& part : G.partitions) {
       if (part.selected.load() && !part.extracting.load()) {
-        start_extraction(&part);
+        selected.push_back(&part);
       }
     }
+    if (G.one_pass && selected.size() > 1) {
+      start_one_pass(selected);
+    } else {
+      for (Part* part : selected) start_extraction(part);
+    }
   }
   if (!any_selected || any_extracting) ImGui::EndDisabled();
 
-  if (!any_extracting) ImGui::BeginDisabled();
+  bool any_busy = any_extracting || any_verifying;
+  if (!any_busy) ImGui::BeginDisabled();
   if (ImGui::Button("Cancel All##cancelall", ImVec2(-1, 35))) {
     std::lock_guard<std::mutex> lock(G.partitions_mutex);
     for (auto& part : G.partitions) {
-      if (part.extracting.load()) {
-        part.cancel_flag.store(true);
+      if (part.extracting.load() || part.verifying.load()) {
+        part.cancel();
       }
     }
   }
-  if (!any_extracting) ImGui::EndDisabled();
+  if (!any_busy) ImGui::EndDisabled();
 
   ImGui::Spacing();
   ImGui::Separator();
@@ -787,6 +1709,85 @@ void right_box() {
     ImGui::TextWrapped("%s", G.security_patch_level.c_str());
   }
 
+  ImGui::Spacing();
+  ImGui::Separator();
+  ImGui::Spacing();
+  ImGui::Text("Engine");
+  ImGui::Separator();
+  ImGui::Spacing();
+
+  size_t batch_pending = 0;
+  {
+    std::lock_guard<std::mutex> lock(B.tasks_mutex);
+    batch_pending = B.tasks.size();
+  }
+
+  ImGui::Text("Extract Active/Queued:");
+  ImGui::TextColored(ImVec4(0.6f, 0.8f, 1.0f, 1.0f), "%llu / %llu",
+                     G.engine.disk_jobs_active,
+                     (uint64_t)batch_pending + G.engine.disk_jobs_waiting +
+                         G.engine.network_jobs_waiting);
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip("Partitions being decoded / waiting to start");
+  }
+
+  ImGui::Text("Verify Active/Queued:");
+  ImGui::TextColored(ImVec4(0.6f, 0.8f, 1.0f, 1.0f), "%d / %llu",
+                     verifier.active.load(), (uint64_t)verifier.pending());
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip("Images being hashed / waiting to be hashed");
+  }
+
+  ImGui::Text("Memory In Use:");
+  ImGui::TextWrapped("%s", fmt_mb(G.engine.memory_in_use_bytes).c_str());
+
+  ImGui::Text("Memory Peak:");
+  ImGui::TextWrapped("%s", fmt_mb(G.engine.memory_peak_bytes).c_str());
+
+  ImGui::Text("Waiting Jobs:");
+  ImGui::TextColored(G.engine.memory_waiting_jobs > 0
+                         ? ImVec4(0.9f, 0.6f, 0.2f, 1.0f)
+                         : ImVec4(0.6f, 0.8f, 1.0f, 1.0f),
+                     "%llu", G.engine.memory_waiting_jobs);
+
+  ImGui::Text("Buffers Reused:");
+  ImGui::TextColored(ImVec4(0.6f, 0.8f, 1.0f, 1.0f), "%llu / %llu",
+                     G.engine.pool_reuses,
+                     G.engine.pool_reuses + G.engine.pool_allocations);
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip("Decode buffers served from the pool / requested");
+  }
+
+  if (G.enable_cache) {
+    ImGui::Text("Cache Hits:");
+    ImGui::TextColored(ImVec4(0.6f, 0.8f, 1.0f, 1.0f), "%llu (%s)",
+                       G.engine.cache_hits,
+                       fmt_mb(G.engine.cache_bytes_saved).c_str());
+  }
+
+  if (G.input_mode == Status::Source::SRC_URL) {
+    ImGui::Text("Prefetch Hits/Stalls:");
+    ImGui::TextColored(ImVec4(0.6f, 0.8f, 1.0f, 1.0f), "%llu / %llu",
+                       G.engine.prefetch_hits, G.engine.prefetch_stalls);
+
+    ImGui::Text("RTT:");
+    ImGui::TextColored(ImVec4(0.6f, 0.8f, 1.0f, 1.0f), "%.0f ms",
+                       G.engine.remote_rtt_ms);
+
+    if (G.engine.remote_list_ms_last > 0.0) {
+      ImGui::Text("Last Listing:");
+      if (G.engine.remote_open_requests_last > 0) {
+        ImGui::TextColored(ImVec4(0.6f, 0.8f, 1.0f, 1.0f),
+                           "%.0f ms (%llu requests)",
+                           G.engine.remote_list_ms_last,
+                           G.engine.remote_open_requests_last);
+      } else {
+        ImGui::TextColored(ImVec4(0.6f, 0.8f, 1.0f, 1.0f), "%.0f ms",
+                           G.engine.remote_list_ms_last);
+      }
+    }
+  }
+
   ImGui::PopStyleVar();
   ImGui::EndChild();
 }
@@ -916,7 +1917,8 @@ void table() {
           ImGui::ProgressBar(verify_progress / 100.0f, ImVec2(-1, 0), "");
           ImGui::SameLine(0, 5);
           ImGui::Text("%.0f%%", verify_progress);
-          ImGui::TextColored(ImVec4(0.7f, 0.7f, 0.7f, 1.0f), "Verifying...");
+          ImGui::TextColored(ImVec4(0.7f, 0.7f, 0.7f, 1.0f), "%s",
+                             verify_status.c_str());
         } else if (!verify_status.empty()) {
           if (verified) {
             ImGui::TextColored(ImVec4(0.4f, 0.9f, 0.4f, 1.0f), "%s",
@@ -933,10 +1935,10 @@ void table() {
         }
 
         ImGui::TableNextColumn();
-        if (extracting) {
+        if (extracting || verifying) {
           if (ImGui::Button("Cancel##cancel", ImVec2(-1, 0))) {
             std::lock_guard<std::mutex> lock(G.partitions_mutex);
-            G.partitions[i].cancel_flag.store(true);
+            G.partitions[i].cancel();
           }
         } else {
           if (ImGui::Button("Extract##extract", ImVec2(-1, 0))) {
@@ -955,6 +1957,538 @@ void table() {
   ImGui::EndChild();
 }
 
+void batch_box() {
+  ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(8, 6));
+
+  ImGui::Text("Source:");
+  ImGui::SameLine(120);
+  ImGui::SetNextItemWidth(-120);
+  ImGui::InputText("##batchsource", B.source_input, sizeof(B.source_input));
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip("Local .bin/.zip path or http(s) URL");
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Browse...##batchbrowse", ImVec2(110, 0))) {
+    chooser(B.source_input, sizeof(B.source_input));
+  }
+
+  ImGui::Text("Partitions:");
+  ImGui::SameLine(120);
+  ImGui::SetNextItemWidth(-120);
+  ImGui::InputText("##batchrule", B.rule_input, sizeof(B.rule_input));
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip("Comma separated partition names, empty for all");
+  }
+  ImGui::SameLine();
+  bool can_add = strlen(B.source_input) > 0 && strlen(G.output_dir) > 0;
+  if (!can_add) ImGui::BeginDisabled();
+  if (ImGui::Button("Add##batchadd", ImVec2(110, 0))) {
+    queue_batch_job(B.source_input, B.rule_input, G.output_dir);
+    B.source_input[0] = '\0';
+  }
+  if (!can_add) ImGui::EndDisabled();
+
+  ImGui::Text("Output Dir:");
+  ImGui::SameLine(120);
+  ImGui::SetNextItemWidth(-120);
+  ImGui::InputText("##batchoutput", G.output_dir, sizeof(G.output_dir));
+  ImGui::SameLine();
+  if (ImGui::Button("Browse...##batchdirbrowse", ImVec2(110, 0))) {
+    out_chooser(G.output_dir, sizeof(G.output_dir));
+  }
+
+  ImGui::Spacing();
+  ImGui::Separator();
+  ImGui::Spacing();
+
+  bool limits_changed = false;
+  ImGui::SetNextItemWidth(90);
+  ImGui::InputInt("Parallel Jobs##batchparallel", &B.parallel_jobs);
+  if (B.parallel_jobs < 1) B.parallel_jobs = 1;
+  ImGui::SameLine();
+  ImGui::SetNextItemWidth(90);
+  limits_changed |= ImGui::InputInt("Disk##batchdisk", &B.disk_jobs);
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip("Partitions written at once (0 = unlimited)");
+  }
+  ImGui::SameLine();
+  ImGui::SetNextItemWidth(90);
+  limits_changed |= ImGui::InputInt("Network##batchnet", &B.network_jobs);
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip("Remote partitions downloaded at once (0 = unlimited)");
+  }
+  ImGui::SameLine();
+  ImGui::SetNextItemWidth(90);
+  limits_changed |= ImGui::InputInt("CPU##batchcpu", &B.decode_threads);
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip("Operations decoded at once (0 = one per core)");
+  }
+  if (limits_changed) {
+    B.disk_jobs = std::max(0, B.disk_jobs);
+    B.network_jobs = std::max(0, B.network_jobs);
+    B.decode_threads = std::max(0, B.decode_threads);
+    payload_set_scheduler_limits(B.disk_jobs, B.network_jobs,
+                                 B.decode_threads);
+  }
+
+  bool running = B.running.load();
+  bool watching = B.watching.load();
+
+  ImGui::Text("Watch Folder:");
+  ImGui::SameLine(120);
+  ImGui::SetNextItemWidth(-240);
+  if (watching) ImGui::BeginDisabled();
+  ImGui::InputText("##watchdir", W.dir, sizeof(W.dir));
+  ImGui::SameLine();
+  if (ImGui::Button("Browse...##watchbrowse", ImVec2(110, 0))) {
+    out_chooser(W.dir, sizeof(W.dir));
+  }
+  if (watching) ImGui::EndDisabled();
+  ImGui::SameLine();
+  if (watching) {
+    if (ImGui::Button("Stop Watching##watchstop", ImVec2(110, 0))) {
+      stop_watch();
+    }
+  } else {
+    bool can_watch =
+        !running && strlen(W.dir) > 0 && strlen(G.output_dir) > 0;
+    if (!can_watch) ImGui::BeginDisabled();
+    if (ImGui::Button("Watch##watchstart", ImVec2(110, 0))) {
+      start_watch();
+    }
+    if (!can_watch) ImGui::EndDisabled();
+  }
+
+  ImGui::SetCursorPosX(120);
+  ImGui::SetNextItemWidth(90);
+  if (watching) ImGui::BeginDisabled();
+  ImGui::InputInt("Settle (s)##watchsettle", &W.settle_seconds);
+  if (W.settle_seconds < 0) W.settle_seconds = 0;
+  if (watching) ImGui::EndDisabled();
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip(
+        "New .zip/.bin files are extracted once their size has not changed\n"
+        "for this long, using the partition rule above");
+  }
+  if (watching) {
+    ImGui::SameLine();
+    ImGui::TextColored(ImVec4(0.4f, 0.8f, 0.4f, 1.0f), "Watching, %llu arrived",
+                       (unsigned long long)W.arrivals.load());
+  }
+
+  ImGui::Spacing();
+  ImGui::Separator();
+  ImGui::Spacing();
+
+  bool any_queued = false;
+  {
+    std::lock_guard<std::mutex> lock(B.jobs_mutex);
+    for (auto& job : B.jobs) {
+      if (job->state.load() == BatchJob::State::QUEUED) any_queued = true;
+    }
+  }
+
+  if (running || !any_queued) ImGui::BeginDisabled();
+  if (ImGui::Button("Start Queue##batchstart", ImVec2(150, 30))) {
+    start_batch();
+  }
+  if (running || !any_queued) ImGui::EndDisabled();
+  ImGui::SameLine();
+  if (!running) ImGui::BeginDisabled();
+  if (ImGui::Button("Cancel Queue##batchcancel", ImVec2(150, 30))) {
+    if (watching) stop_watch();
+    cancel_batch();
+  }
+  if (!running) ImGui::EndDisabled();
+  ImGui::SameLine();
+  if (running) ImGui::BeginDisabled();
+  if (ImGui::Button("Clear Finished##batchclear", ImVec2(150, 30))) {
+    std::lock_guard<std::mutex> lock(B.jobs_mutex);
+    B.jobs.erase(std::remove_if(B.jobs.begin(), B.jobs.end(),
+                                [](const std::unique_ptr<BatchJob>& job) {
+                                  auto st = job->state.load();
+                                  return st != BatchJob::State::QUEUED &&
+                                         st != BatchJob::State::LISTING &&
+                                         st != BatchJob::State::RUNNING;
+                                }),
+                 B.jobs.end());
+  }
+  if (running) ImGui::EndDisabled();
+
+  ImGui::PopStyleVar();
+  ImGui::Spacing();
+
+  if (ImGui::BeginTable("BatchJobs", 4,
+                        ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                            ImGuiTableFlags_ScrollY |
+                            ImGuiTableFlags_Resizable)) {
+    ImGui::TableSetupColumn("Source", ImGuiTableColumnFlags_WidthStretch);
+    ImGui::TableSetupColumn("Partitions", ImGuiTableColumnFlags_WidthFixed,
+                            180);
+    ImGui::TableSetupColumn("Progress", ImGuiTableColumnFlags_WidthStretch);
+    ImGui::TableSetupColumn("Status", ImGuiTableColumnFlags_WidthFixed, 200);
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableHeadersRow();
+
+    std::lock_guard<std::mutex> lock(B.jobs_mutex);
+    for (size_t i = 0; i < B.jobs.size(); i++) {
+      BatchJob* job = B.jobs[i].get();
+      auto state = job->state.load();
+
+      float progress = 0.0f;
+      size_t count = 0;
+      {
+        std::lock_guard<std::mutex> job_lock(job->mutex);
+        count = job->parts.size();
+        for (auto& part : job->parts) progress += part.progress.load();
+      }
+      if (count > 0) progress /= count;
+
+      ImGui::TableNextRow();
+      ImGui::PushID((int)i);
+
+      ImGui::TableNextColumn();
+      ImGui::TextWrapped("%s", job->source.c_str());
+      if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Output: %s", job->output_dir.c_str());
+      }
+
+      ImGui::TableNextColumn();
+      ImGui::TextWrapped("%s", job->rule.empty() ? "(all)" : job->rule.c_str());
+
+      ImGui::TableNextColumn();
+      if (state == BatchJob::State::RUNNING ||
+          state == BatchJob::State::DONE) {
+        ImGui::ProgressBar(progress / 100.0f, ImVec2(-1, 0), "");
+      } else {
+        ImGui::TextDisabled("-");
+      }
+
+      ImGui::TableNextColumn();
+      std::string msg = job->get_message();
+      switch (state) {
+        case BatchJob::State::QUEUED:
+          ImGui::TextDisabled("Queued");
+          break;
+        case BatchJob::State::LISTING:
+        case BatchJob::State::RUNNING:
+          ImGui::Text("%s", msg.c_str());
+          break;
+        case BatchJob::State::DONE:
+          ImGui::TextColored(ImVec4(0.4f, 0.8f, 0.4f, 1.0f), "Completed: %s",
+                             msg.c_str());
+          break;
+        case BatchJob::State::FAILED:
+          ImGui::TextColored(ImVec4(0.9f, 0.3f, 0.3f, 1.0f), "%s",
+                             msg.c_str());
+          break;
+        case BatchJob::State::CANCELLED:
+          ImGui::TextColored(ImVec4(0.9f, 0.6f, 0.2f, 1.0f), "Cancelled: %s",
+                             msg.c_str());
+          break;
+      }
+      if (ImGui::IsItemHovered() && !msg.empty()) {
+        ImGui::SetTooltip("%s", msg.c_str());
+      }
+
+      ImGui::PopID();
+    }
+
+    ImGui::EndTable();
+  }
+}
+
+void files_box() {
+  ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(8, 6));
+
+  std::vector<std::string> names;
+  {
+    std::lock_guard<std::mutex> lock(G.partitions_mutex);
+    for (auto& part : G.partitions) names.push_back(part.name);
+  }
+  if (F.part_index >= (int)names.size()) F.part_index = 0;
+
+  bool busy = F.busy.load();
+
+  ImGui::Text("Partition:");
+  ImGui::SameLine(120);
+  ImGui::SetNextItemWidth(-120);
+  if (names.empty()) ImGui::BeginDisabled();
+  if (ImGui::BeginCombo("##browsepart",
+                        names.empty() ? "Load partitions in the Single tab"
+                                      : names[F.part_index].c_str())) {
+    for (int i = 0; i < (int)names.size(); i++) {
+      if (ImGui::Selectable(names[i].c_str(), i == F.part_index)) {
+        F.part_index = i;
+      }
+    }
+    ImGui::EndCombo();
+  }
+  ImGui::SameLine();
+  if (busy) ImGui::BeginDisabled();
+  if (ImGui::Button("Open##browseopen", ImVec2(110, 0)) && !names.empty()) {
+    std::string name = names[F.part_index];
+    std::string source =
+        G.input_mode == Status::Source::SRC_FILE ? G.file_path : G.url_input;
+    auto mode = G.input_mode;
+    std::string ua = G.user_agent;
+    browse_start([=] { browse_open(name, source, mode, ua); });
+  }
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip(
+        "Read the EROFS or ext4 filesystem of the partition in place.
+"
+        "Only the blocks a listing or file needs are decoded.");
+  }
+  if (busy) ImGui::EndDisabled();
+  if (names.empty()) ImGui::EndDisabled();
+
+  std::string partition, filesystem, path, message;
+  std::vector<Browser::Entry> entries;
+  {
+    std::lock_guard<std::mutex> lock(F.mutex);
+    partition = F.partition;
+    filesystem = F.filesystem;
+    path = F.path;
+    message = F.message;
+    entries = F.entries;
+  }
+  bool opened = !path.empty();
+
+  ImGui::Text("Path:");
+  ImGui::SameLine(120);
+  if (opened) {
+    ImGui::Text("%s:%s (%s)", partition.c_str(), path.c_str(),
+                filesystem.c_str());
+  } else {
+    ImGui::TextDisabled("-");
+  }
+  ImGui::SameLine(ImGui::GetWindowWidth() - 126);
+  if (!opened || path == "/" || busy) ImGui::BeginDisabled();
+  if (ImGui::Button("Up##browseup", ImVec2(110, 0))) {
+    std::string parent = path.substr(0, path.find_last_of('/'));
+    browse_start([=] { browse_list(parent.empty() ? "/" : parent); });
+  }
+  if (!opened || path == "/" || busy) ImGui::EndDisabled();
+
+  if (!message.empty()) {
+    ImGui::TextColored(ImVec4(0.7f, 0.7f, 0.7f, 1.0f), "%s", message.c_str());
+  }
+
+  ImGui::PopStyleVar();
+  ImGui::Spacing();
+
+  if (ImGui::BeginTable("Files", 4,
+                        ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                            ImGuiTableFlags_ScrollY |
+                            ImGuiTableFlags_Resizable)) {
+    ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthStretch);
+    ImGui::TableSetupColumn("Type", ImGuiTableColumnFlags_WidthFixed, 80);
+    ImGui::TableSetupColumn("Size", ImGuiTableColumnFlags_WidthFixed, 100);
+    ImGui::TableSetupColumn("Actions", ImGuiTableColumnFlags_WidthFixed, 80);
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableHeadersRow();
+
+    std::string base = path == "/" ? "" : path;
+    for (size_t i = 0; i < entries.size(); i++) {
+      const Browser::Entry& entry = entries[i];
+      std::string full = base + "/" + entry.name;
+
+      ImGui::TableNextRow();
+      ImGui::PushID((int)i);
+
+      ImGui::TableNextColumn();
+      if (entry.type == "dir") {
+        if (ImGui::Selectable((entry.name + "/").c_str(), false,
+                              ImGuiSelectableFlags_AllowDoubleClick) &&
+            ImGui::IsMouseDoubleClicked(0) && !busy) {
+          browse_start([=] { browse_list(full); });
+        }
+      } else if (entry.type == "symlink") {
+        ImGui::Text("%s -> %s", entry.name.c_str(), entry.target.c_str());
+      } else {
+        ImGui::Text("%s", entry.name.c_str());
+      }
+
+      ImGui::TableNextColumn();
+      ImGui::Text("%s", entry.type.c_str());
+
+      ImGui::TableNextColumn();
+      if (entry.type == "file") {
+        ImGui::Text("%s", fmt_mb(entry.size).c_str());
+      } else {
+        ImGui::TextDisabled("-");
+      }
+
+      ImGui::TableNextColumn();
+      if (entry.type == "file") {
+        if (busy) ImGui::BeginDisabled();
+        if (ImGui::Button("Extract##fileextract", ImVec2(-1, 0))) {
+          std::string output = std::string(G.output_dir) + "\\" + entry.name;
+          browse_start([=] { browse_extract(full, output); });
+        }
+        if (busy) ImGui::EndDisabled();
+      }
+
+      ImGui::PopID();
+    }
+
+    ImGui::EndTable();
+  }
+}
+
+void compare_box() {
+  ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(8, 6));
+
+  bool busy = C.busy.load();
+
+  ImGui::Text("Previous Build:");
+  ImGui::SameLine(120);
+  ImGui::SetNextItemWidth(-120);
+  ImGui::InputText("##compareold", C.old_input, sizeof(C.old_input));
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip("Local .bin/.zip path or http(s) URL");
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Browse...##compareoldbrowse", ImVec2(110, 0))) {
+    chooser(C.old_input, sizeof(C.old_input));
+  }
+
+  ImGui::Text("New Build:");
+  ImGui::SameLine(120);
+  ImGui::SetNextItemWidth(-120);
+  ImGui::InputText("##comparenew", C.new_input, sizeof(C.new_input));
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip("Local .bin/.zip path or http(s) URL");
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Browse...##comparenewbrowse", ImVec2(110, 0))) {
+    chooser(C.new_input, sizeof(C.new_input));
+  }
+
+  ImGui::Spacing();
+  ImGui::Separator();
+  ImGui::Spacing();
+
+  bool can_compare =
+      !busy && strlen(C.old_input) > 0 && strlen(C.new_input) > 0;
+  if (!can_compare) ImGui::BeginDisabled();
+  if (ImGui::Button("Compare##comparerun", ImVec2(150, 30))) {
+    C.busy.store(true);
+    {
+      std::lock_guard<std::mutex> lock(C.mutex);
+      C.message = "Fetching manifests...";
+    }
+    if (C.worker.joinable()) C.worker.join();
+    C.worker = std::thread(compare_run, std::string(C.old_input),
+                           std::string(C.new_input),
+                           std::string(G.user_agent));
+  }
+  if (!can_compare) ImGui::EndDisabled();
+
+  std::string source, total, message;
+  std::vector<Compare::Changed> changed;
+  std::vector<std::string> added, removed;
+  size_t unchanged = 0;
+  {
+    std::lock_guard<std::mutex> lock(C.mutex);
+    source = C.source;
+    total = C.total;
+    message = C.message;
+    changed = C.changed;
+    added = C.added;
+    removed = C.removed;
+    unchanged = C.unchanged;
+  }
+
+  ImGui::SameLine();
+  bool any_changes = !changed.empty() || !added.empty();
+  bool can_extract = !busy && any_changes && strlen(G.output_dir) > 0;
+  if (!can_extract) ImGui::BeginDisabled();
+  if (ImGui::Button("Extract Changed##compareextract", ImVec2(150, 30))) {
+    std::string rule;
+    for (const auto& c : changed) rule += (rule.empty() ? "" : ",") + c.name;
+    for (const auto& name : added) rule += (rule.empty() ? "" : ",") + name;
+    queue_batch_job(source, rule, G.output_dir);
+    if (!B.running.load()) start_batch();
+  }
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip(
+        "Queue the changed and added partitions of the new build\n"
+        "in the Batch tab");
+  }
+  if (!can_extract) ImGui::EndDisabled();
+
+  ImGui::SameLine();
+  ImGui::TextColored(ImVec4(0.7f, 0.7f, 0.7f, 1.0f), "%s", message.c_str());
+
+  if (!source.empty()) {
+    ImGui::Text("%zu changed, %zu added, %zu removed, %zu unchanged (~%s)",
+                changed.size(), added.size(), removed.size(), unchanged,
+                total.c_str());
+  }
+
+  ImGui::PopStyleVar();
+  ImGui::Spacing();
+
+  if (ImGui::BeginTable("CompareResults", 4,
+                        ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                            ImGuiTableFlags_ScrollY |
+                            ImGuiTableFlags_Resizable)) {
+    ImGui::TableSetupColumn("Partition", ImGuiTableColumnFlags_WidthStretch);
+    ImGui::TableSetupColumn("State", ImGuiTableColumnFlags_WidthFixed, 90);
+    ImGui::TableSetupColumn("Size", ImGuiTableColumnFlags_WidthFixed, 200);
+    ImGui::TableSetupColumn("Changed", ImGuiTableColumnFlags_WidthFixed, 180);
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableHeadersRow();
+
+    for (const auto& c : changed) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::Text("%s", c.name.c_str());
+      ImGui::TableNextColumn();
+      ImGui::TextColored(ImVec4(0.9f, 0.6f, 0.2f, 1.0f), "Changed");
+      ImGui::TableNextColumn();
+      if (c.old_size == c.new_size) {
+        ImGui::Text("%s", fmt_mb(c.new_size).c_str());
+      } else {
+        ImGui::Text("%s -> %s", fmt_mb(c.old_size).c_str(),
+                    fmt_mb(c.new_size).c_str());
+      }
+      ImGui::TableNextColumn();
+      if (c.changed.empty()) {
+        ImGui::TextDisabled("unknown");
+      } else {
+        ImGui::Text("~%s (%.1f%%)", c.changed.c_str(), c.percent);
+      }
+    }
+    for (const auto& name : added) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::Text("%s", name.c_str());
+      ImGui::TableNextColumn();
+      ImGui::TextColored(ImVec4(0.4f, 0.8f, 0.4f, 1.0f), "Added");
+      ImGui::TableNextColumn();
+      ImGui::TextDisabled("-");
+      ImGui::TableNextColumn();
+      ImGui::TextDisabled("all");
+    }
+    for (const auto& name : removed) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::Text("%s", name.c_str());
+      ImGui::TableNextColumn();
+      ImGui::TextColored(ImVec4(0.9f, 0.3f, 0.3f, 1.0f), "Removed");
+      ImGui::TableNextColumn();
+      ImGui::TextDisabled("-");
+      ImGui::TableNextColumn();
+      ImGui::TextDisabled("-");
+    }
+
+    ImGui::EndTable();
+  }
+}
+
 void err_box() {
   if (G.show_error_popup) {
     ImGui::OpenPopup("Error");
@@ -985,6 +2519,8 @@ void err_box() {
 }
 
 void draw() {
+  poll_stats();
+
   ImGui::SetNextWindowPos(ImVec2(0, 0));
   ImGui::SetNextWindowSize(ImGui::GetIO().DisplaySize);
   ImGui::Begin("Payload Dumper", nullptr,
@@ -992,17 +2528,35 @@ void draw() {
                    ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoTitleBar |
                    ImGuiWindowFlags_NoBringToFrontOnFocus);
 
-  top_box();
+  if (ImGui::BeginTabBar("##modes")) {
+    if (ImGui::BeginTabItem("Single")) {
+      top_box();
 
-  ImGui::Spacing();
+      ImGui::Spacing();
 
-  ImGui::BeginGroup();
-  table();
-  ImGui::EndGroup();
+      ImGui::BeginGroup();
+      table();
+      ImGui::EndGroup();
 
-  ImGui::SameLine();
+      ImGui::SameLine();
 
-  right_box();
+      right_box();
+      ImGui::EndTabItem();
+    }
+    if (ImGui::BeginTabItem("Batch")) {
+      batch_box();
+      ImGui::EndTabItem();
+    }
+    if (ImGui::BeginTabItem("Compare")) {
+      compare_box();
+      ImGui::EndTabItem();
+    }
+    if (ImGui::BeginTabItem("Files")) {
+      files_box();
+      ImGui::EndTabItem();
+    }
+    ImGui::EndTabBar();
+  }
 
   ImGui::End();
 
@@ -1011,27 +2565,56 @@ void draw() {
 
 void begin() { payload_init(); }
 
-void quit() {
-  G.shutdown_requested.store(true);
-
-  if (G.loading_thread.joinable()) {
-    G.loading_thread.join();
+void settle_thread(std::thread& t, bool clean) {
+  if (!t.joinable()) return;
+  if (clean) {
+    t.join();
+  } else {
+    t.detach();
   }
+}
+
+void quit() {
+  shutdown_requested.store(true);
 
+  // signal everything first, so all workers wind down in parallel
   {
     std::lock_guard<std::mutex> lock(G.partitions_mutex);
     for (auto& part : G.partitions) {
-      part.cancel_flag.store(true);
+      part.cancel();
     }
   }
-
-  for (auto& t : G.extraction_threads) {
-    if (t.joinable()) {
-      t.join();
-    }
+  B.watching.store(false);
+  cancel_batch();
+  verifier.stop();
+  if (P.token) payload_cancel_token_cancel(P.token);
+
+  // cancelled extractions return within milliseconds; anything still stuck
+  // after the deadline (e.g. a listing blocked on the network) is left to
+  // process exit instead of holding the window open
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+  while (live_threads.load() > 0 &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
   }
+  bool clean = live_threads.load() == 0;
 
+  settle_thread(G.loading_thread, clean);
+  settle_thread(F.worker, clean);
+  settle_thread(C.worker, clean);
+  settle_thread(P.worker, clean);
+  for (auto& t : G.extraction_threads) settle_thread(t, clean);
   G.extraction_threads.clear();
-
-  payload_cleanup();
-}
\ No newline at end of file
+  settle_thread(W.thread, clean);
+  settle_thread(B.lister, clean);
+  for (auto& t : B.workers) settle_thread(t, clean);
+  B.workers.clear();
+  for (auto& t : verifier.workers) settle_thread(t, clean);
+  verifier.workers.clear();
+
+  if (clean) {
+    if (F.fs) payload_fs_close(F.fs);
+    if (P.token) payload_cancel_token_free(P.token);
+    payload_cleanup();
+  }
+}